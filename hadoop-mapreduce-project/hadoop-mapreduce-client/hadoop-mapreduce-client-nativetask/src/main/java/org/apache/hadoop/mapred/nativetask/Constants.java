@@ -35,6 +35,29 @@ public class Constants {
   public static final String NATIVE_STATUS_UPDATE_INTERVAL = "native.update.interval";
   public static final int NATIVE_STATUS_UPDATE_INTERVAL_DEFVAL = 3000;
 
+  /**
+   * write the partition/key/value length headers of map output records in
+   * the native byte order, so the native collector does not need to swap them
+   */
+  public static final String NATIVE_COLLECTOR_NATIVE_ENDIAN = "native.collector.native.endian";
+  public static final boolean NATIVE_COLLECTOR_NATIVE_ENDIAN_DEFAULT = false;
+
+  /**
+   * serialize map output records straight into buffers of the native sort
+   * memory, instead of copying them over from a java side direct buffer;
+   * record headers are then always in the native byte order
+   */
+  public static final String NATIVE_COLLECTOR_SHARED_BUFFER = "native.collector.shared.buffer";
+  public static final boolean NATIVE_COLLECTOR_SHARED_BUFFER_DEFAULT = false;
+
+  /**
+   * secondary sort: byte length of the group field at the start of each
+   * Text/BytesWritable map output key. Keys are still sorted by all their
+   * bytes, native combiners combine the records of a group field; requires
+   * the built-in key comparator
+   */
+  public static final String NATIVE_SORT_GROUP_FIELD_LENGTH = "native.sort.group.field.length";
+
   public static final String SERIALIZATION_FRAMEWORK = "SerializationFramework";
   public static final int SIZEOF_PARTITION_LENGTH = 4;
   public static final int SIZEOF_KEY_LENGTH = 4;
@@ -18,6 +18,7 @@
 package org.apache.hadoop.mapred.nativetask;
 
 import java.io.IOException;
+import java.nio.ByteBuffer;
 
 import org.apache.hadoop.classification.InterfaceAudience;
 import org.apache.hadoop.conf.Configuration;
@@ -48,6 +49,15 @@ public interface INativeHandler extends NativeDataTarget, NativeDataSource {
    */
   public ReadWriteBuffer call(Command command, ReadWriteBuffer parameter) throws IOException;
 
+  /**
+   * hand the first length bytes of the shared buffer returned by the previous
+   * call to native side, and get a new one of at least minLength bytes, which
+   * is native memory that data is written to directly
+   *
+   * @return null if native side has no shared buffers, or minLength is 0
+   */
+  public ByteBuffer swapSharedBuffer(int length, int minLength) throws IOException;
+
   void setCommandDispatcher(CommandDispatcher handler);
 
 }
@@ -149,6 +149,11 @@ public ReadWriteBuffer call(Command command, ReadWriteBuffer parameter)
     return result;
   }
 
+  @Override
+  public ByteBuffer swapSharedBuffer(int length, int minLength) throws IOException {
+    return nativeSwapSharedBuffer(nativeHandlerAddr, length, minLength);
+  }
+
   @Override
   public void sendData() throws IOException {
     nativeProcessInput(nativeHandlerAddr, rawOutputBuffer.position());
@@ -238,6 +243,11 @@ private void flushOutput(int length) throws IOException {
    */
   private native void nativeFinish(long handler);
 
+  /**
+   * Hand a filled shared buffer to native side and get the next one
+   */
+  private native ByteBuffer nativeSwapSharedBuffer(long handler, int length, int minLength);
+
   /**
    * Send control message to native side
    */
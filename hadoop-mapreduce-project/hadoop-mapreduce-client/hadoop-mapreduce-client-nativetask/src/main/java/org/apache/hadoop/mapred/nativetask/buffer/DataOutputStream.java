@@ -36,4 +36,16 @@ public abstract class DataOutputStream extends OutputStream implements DataOutpu
    * Check whether there is unflushed data stored in the stream
    */
   public abstract boolean hasUnFlushedData();
+
+  /**
+   * Make room for the next length bytes, so they are passed downstream in
+   * one piece if they fit in the buffer
+   *
+   * @param length length of bytes
+   */
+  public void reserve(int length) throws IOException {
+    if (hasUnFlushedData() && shortOfSpace(length)) {
+      flush();
+    }
+  }
 }
@@ -0,0 +1,188 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package org.apache.hadoop.mapred.nativetask.buffer;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+import org.apache.hadoop.classification.InterfaceAudience;
+import org.apache.hadoop.mapred.nativetask.INativeHandler;
+
+import com.google.common.base.Preconditions;
+
+/**
+ * DataOutputStream implementation which writes into native memory shared
+ * by a native handler, see {@link INativeHandler#swapSharedBuffer}.
+ * Data is never copied to the native side, so each block of data given to
+ * {@link #reserve(int)} must fit in the current buffer; a full buffer is
+ * handed to the native side and swapped for a new one before the block is
+ * written.
+ */
+@InterfaceAudience.Private
+public class SharedBufferDataWriter extends DataOutputStream {
+  private final INativeHandler handler;
+  private ByteBuffer buffer;
+
+  private final static byte TRUE = (byte) 1;
+  private final static byte FALSE = (byte) 0;
+  private final java.io.DataOutputStream javaWriter;
+
+  /**
+   * @return null if the handler has no shared buffers
+   */
+  public static SharedBufferDataWriter create(INativeHandler handler) throws IOException {
+    Preconditions.checkNotNull(handler);
+    final ByteBuffer buffer = handler.swapSharedBuffer(0, 1);
+    if (null == buffer) {
+      return null;
+    }
+    return new SharedBufferDataWriter(handler, buffer);
+  }
+
+  private SharedBufferDataWriter(INativeHandler handler, ByteBuffer buffer) {
+    this.handler = handler;
+    this.buffer = buffer;
+    this.javaWriter = new java.io.DataOutputStream(this);
+  }
+
+  private void swap(int minLength) throws IOException {
+    final int length = buffer.position();
+    // the old buffer belongs to the native side from now on
+    buffer = null;
+    buffer = handler.swapSharedBuffer(length, minLength);
+    if (null == buffer && minLength > 0) {
+      throw new IOException("Native handler " + handler.name() + " returned no shared buffer");
+    }
+  }
+
+  private void checkSpace(int length) throws IOException {
+    if (null == buffer) {
+      throw new IOException("Shared buffer is closed");
+    }
+    if (buffer.remaining() < length) {
+      throw new IOException("Write beyond the reserved length, remaining: "
+          + buffer.remaining() + ", length: " + length);
+    }
+  }
+
+  @Override
+  public void reserve(int length) throws IOException {
+    checkSpace(0);
+    if (buffer.remaining() < length) {
+      swap(length);
+    }
+  }
+
+  @Override
+  public boolean shortOfSpace(int dataLength) throws IOException {
+    return null == buffer || buffer.remaining() < dataLength;
+  }
+
+  @Override
+  public boolean hasUnFlushedData() {
+    return null != buffer && buffer.position() > 0;
+  }
+
+  @Override
+  public synchronized void write(int v) throws IOException {
+    checkSpace(1);
+    buffer.put((byte) v);
+  }
+
+  @Override
+  public synchronized void write(byte b[], int off, int len) throws IOException {
+    checkSpace(len);
+    buffer.put(b, off, len);
+  }
+
+  @Override
+  public void flush() throws IOException {
+    checkSpace(0);
+    swap(1);
+  }
+
+  @Override
+  public void close() throws IOException {
+    if (null != buffer) {
+      swap(0);
+    }
+    handler.finishSendData();
+  }
+
+  @Override
+  public final void writeBoolean(boolean v) throws IOException {
+    checkSpace(1);
+    buffer.put(v ? TRUE : FALSE);
+  }
+
+  @Override
+  public final void writeByte(int v) throws IOException {
+    checkSpace(1);
+    buffer.put((byte) v);
+  }
+
+  @Override
+  public final void writeShort(int v) throws IOException {
+    checkSpace(2);
+    buffer.putShort((short) v);
+  }
+
+  @Override
+  public final void writeChar(int v) throws IOException {
+    checkSpace(2);
+    buffer.put((byte) ((v >>> 8) & 0xFF));
+    buffer.put((byte) ((v >>> 0) & 0xFF));
+  }
+
+  @Override
+  public final void writeInt(int v) throws IOException {
+    checkSpace(4);
+    buffer.putInt(v);
+  }
+
+  @Override
+  public final void writeLong(long v) throws IOException {
+    checkSpace(8);
+    buffer.putLong(v);
+  }
+
+  @Override
+  public final void writeFloat(float v) throws IOException {
+    writeInt(Float.floatToIntBits(v));
+  }
+
+  @Override
+  public final void writeDouble(double v) throws IOException {
+    writeLong(Double.doubleToLongBits(v));
+  }
+
+  @Override
+  public final void writeBytes(String s) throws IOException {
+    javaWriter.writeBytes(s);
+  }
+
+  @Override
+  public final void writeChars(String s) throws IOException {
+    javaWriter.writeChars(s);
+  }
+
+  @Override
+  public final void writeUTF(String str) throws IOException {
+    javaWriter.writeUTF(str);
+  }
+}
@@ -24,6 +24,7 @@
 import org.apache.hadoop.mapred.OutputCollector;
 import org.apache.hadoop.mapred.nativetask.NativeDataTarget;
 import org.apache.hadoop.mapred.nativetask.buffer.ByteBufferDataWriter;
+import org.apache.hadoop.mapred.nativetask.buffer.DataOutputStream;
 import org.apache.hadoop.mapred.nativetask.serde.IKVSerializer;
 import org.apache.hadoop.mapred.nativetask.serde.KVSerializer;
 import org.apache.hadoop.mapred.nativetask.util.SizedWritable;
@@ -40,19 +41,35 @@
 
   private final SizedWritable<K> tmpInputKey;
   private final SizedWritable<V> tmpInputValue;
-  private ByteBufferDataWriter out;
+  private DataOutputStream out;
   IKVSerializer serializer;
   private boolean closed = false;
 
   public BufferPusher(Class<K> iKClass, Class<V> iVClass,
                       NativeDataTarget target) throws IOException {
+    this(iKClass, iVClass, target, false);
+  }
+
+  public BufferPusher(Class<K> iKClass, Class<V> iVClass,
+                      NativeDataTarget target, boolean nativeEndianHeader) throws IOException {
+    this(iKClass, iVClass, new ByteBufferDataWriter(target), nativeEndianHeader);
+  }
+
+  /**
+   * @param out stream the records are serialized to, it passes them to the
+   *            native side
+   */
+  public BufferPusher(Class<K> iKClass, Class<V> iVClass,
+                      DataOutputStream out, boolean nativeEndianHeader) throws IOException {
     tmpInputKey = new SizedWritable<K>(iKClass);
     tmpInputValue = new SizedWritable<V>(iVClass);
 
     if (null != iKClass && null != iVClass) {
-      this.serializer = new KVSerializer<K, V>(iKClass, iVClass);
+      KVSerializer<K, V> kvSerializer = new KVSerializer<K, V>(iKClass, iVClass);
+      kvSerializer.setNativeEndianHeader(nativeEndianHeader);
+      this.serializer = kvSerializer;
     }
-    this.out = new ByteBufferDataWriter(target);
+    this.out = out;
   }
 
   public void collect(K key, V value, int partition) throws IOException {
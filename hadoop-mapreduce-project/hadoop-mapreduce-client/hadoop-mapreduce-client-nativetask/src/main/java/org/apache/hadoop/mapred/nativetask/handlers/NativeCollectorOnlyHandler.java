@@ -27,11 +27,15 @@
 import org.apache.hadoop.mapred.TaskAttemptID;
 import org.apache.hadoop.mapred.nativetask.Command;
 import org.apache.hadoop.mapred.nativetask.CommandDispatcher;
+import org.apache.hadoop.mapred.nativetask.Constants;
 import org.apache.hadoop.mapred.nativetask.DataChannel;
 import org.apache.hadoop.mapred.nativetask.ICombineHandler;
 import org.apache.hadoop.mapred.nativetask.INativeHandler;
 import org.apache.hadoop.mapred.nativetask.NativeBatchProcessor;
 import org.apache.hadoop.mapred.nativetask.TaskContext;
+import org.apache.hadoop.mapred.nativetask.buffer.ByteBufferDataWriter;
+import org.apache.hadoop.mapred.nativetask.buffer.DataOutputStream;
+import org.apache.hadoop.mapred.nativetask.buffer.SharedBufferDataWriter;
 import org.apache.hadoop.mapred.nativetask.util.NativeTaskOutput;
 import org.apache.hadoop.mapred.nativetask.util.OutputUtil;
 import org.apache.hadoop.mapred.nativetask.util.ReadWriteBuffer;
@@ -85,10 +89,28 @@ public static <K, V> NativeCollectorOnlyHandler<K, V> create(TaskContext context
 
     final INativeHandler nativeHandler = NativeBatchProcessor.create(
       NAME, context.getConf(), DataChannel.OUT);
+    boolean nativeEndian = context.getConf().getBoolean(
+        Constants.NATIVE_COLLECTOR_NATIVE_ENDIAN,
+        Constants.NATIVE_COLLECTOR_NATIVE_ENDIAN_DEFAULT);
+    DataOutputStream out = null;
+    if (context.getConf().getBoolean(Constants.NATIVE_COLLECTOR_SHARED_BUFFER,
+        Constants.NATIVE_COLLECTOR_SHARED_BUFFER_DEFAULT)) {
+      out = SharedBufferDataWriter.create(nativeHandler);
+      if (null == out) {
+        LOG.info("[NativeCollectorOnlyHandler] native collector has no shared buffers, "
+            + "records are copied");
+      } else {
+        // the native side reads shared records in place
+        nativeEndian = true;
+      }
+    }
+    if (null == out) {
+      out = new ByteBufferDataWriter(nativeHandler);
+    }
     final BufferPusher<K, V> kvPusher = new BufferPusher<K, V>(
         (Class<K>)context.getOutputKeyClass(),
         (Class<V>)context.getOutputValueClass(),
-        nativeHandler);
+        out, nativeEndian);
 
     return new NativeCollectorOnlyHandler<K, V>(context, nativeHandler, kvPusher, combinerHandler);
   }
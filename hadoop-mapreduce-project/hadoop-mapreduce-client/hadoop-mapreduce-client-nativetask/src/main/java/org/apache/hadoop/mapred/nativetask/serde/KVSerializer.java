@@ -19,6 +19,7 @@
 package org.apache.hadoop.mapred.nativetask.serde;
 
 import java.io.IOException;
+import java.nio.ByteOrder;
 
 import org.apache.hadoop.classification.InterfaceAudience;
 import org.apache.hadoop.io.Writable;
@@ -37,8 +38,12 @@
   
   public static final int KV_HEAD_LENGTH = Constants.SIZEOF_KV_LENGTH;
 
+  private static final boolean NATIVE_LITTLE_ENDIAN =
+      ByteOrder.nativeOrder() == ByteOrder.LITTLE_ENDIAN;
+
   private final INativeSerializer<Writable> keySerializer;
   private final INativeSerializer<Writable> valueSerializer;
+  private boolean nativeEndianHeader = false;
 
   public KVSerializer(Class<K> kclass, Class<V> vclass) throws IOException {
     
@@ -46,6 +51,14 @@ public KVSerializer(Class<K> kclass, Class<V> vclass) throws IOException {
     this.valueSerializer = NativeSerialization.getInstance().getSerializer(vclass);
   }
 
+  /**
+   * write the length headers in native byte order instead of big endian,
+   * only valid when the receiving side is configured the same way
+   */
+  public void setNativeEndianHeader(boolean nativeEndianHeader) {
+    this.nativeEndianHeader = nativeEndianHeader;
+  }
+
   @Override
   public void updateLength(SizedWritable<?> key, SizedWritable<?> value) throws IOException {
     key.length = keySerializer.getLength(key.v);
@@ -77,16 +90,14 @@ public int serializePartitionKV(DataOutputStream out, int partitionId,
       bytesWritten += Constants.SIZEOF_PARTITION_LENGTH;
     }
 
-    if (out.hasUnFlushedData() && out.shortOfSpace(bytesWritten)) {
-      out.flush();
-    }
+    out.reserve(bytesWritten);
 
     if (partitionId != -1) {
-      out.writeInt(partitionId);
+      writeHeader(out, partitionId);
     }
-        
-    out.writeInt(keyLength);
-    out.writeInt(valueLength);
+
+    writeHeader(out, keyLength);
+    writeHeader(out, valueLength);
     
     keySerializer.serialize(key.v, out);
     valueSerializer.serialize(value.v, out);
@@ -94,6 +105,14 @@ public int serializePartitionKV(DataOutputStream out, int partitionId,
     return bytesWritten;
   }
 
+  private void writeHeader(DataOutputStream out, int v) throws IOException {
+    if (nativeEndianHeader && NATIVE_LITTLE_ENDIAN) {
+      out.writeInt(Integer.reverseBytes(v));
+    } else {
+      out.writeInt(v);
+    }
+  }
+
   @Override
   public int deserializeKV(DataInputStream in, SizedWritable<?> key,
       SizedWritable<?> value) throws IOException {
@@ -38,6 +38,7 @@ using std::pair;
 enum NativeObjectType {
   UnknownObjectType = 0,
   BatchHandlerType = 1,
+  CombinerType = 2,
 };
 
 /**
@@ -71,14 +72,35 @@ enum Endium {
 
 #define NATIVE_SORT_TYPE "native.sort.type"
 #define MAPRED_SORT_AVOID "mapreduce.sort.avoidance"
+#define NATIVE_SORT_GROUP_FIELD_LENGTH "native.sort.group.field.length"
 #define NATIVE_SORT_MAX_BLOCK_SIZE "native.sort.blocksize.max"
+#define NATIVE_SORT_KEY_PREFIX "native.sort.key.prefix"
+#define NATIVE_SORT_WHOLE_PARTITION "native.sort.whole.partition"
+#define NATIVE_MERGE_TYPE "native.merge.type"
+#define NATIVE_MERGE_THREADS "native.merge.threads"
+#define NATIVE_MERGE_READ_AHEAD "native.merge.readahead"
+#define NATIVE_MERGE_MMAP "native.merge.mmap"
+#define NATIVE_SORT_SPILL_THREADS "native.sort.spill.threads"
+#define NATIVE_SPILL_ASYNC "native.spill.async"
+#define NATIVE_SPILL_DIRECT_IO "native.spill.direct.io"
+#define NATIVE_SORT_MEMORY_POLICY "native.sort.memory.policy"
+#define NATIVE_SORT_MEMORY_NUMA_LOCAL "native.sort.memory.numa.local"
+#define NATIVE_SORT_MEMORY_PREFAULT "native.sort.memory.prefault"
+#define NATIVE_COMBINE_HASH_MB "native.combine.hash.mb"
+#define NATIVE_COLLECTOR_NATIVE_ENDIAN "native.collector.native.endian"
+#define NATIVE_PROCESSOR_BUFFER_KB "native.processor.buffer.kb"
+#define NATIVE_COLLECTOR_METRICS "native.collector.metrics"
 #define MAPRED_COMPRESS_MAP_OUTPUT "mapreduce.map.output.compress"
 #define MAPRED_MAP_OUTPUT_COMPRESSION_CODEC "mapreduce.map.output.compress.codec"
+#define ZSTD_COMPRESSION_LEVEL "io.compression.codec.zstd.level"
+#define NATIVE_COMPRESS_THREADS "native.compress.threads"
 #define MAPRED_MAPOUTPUT_KEY_CLASS "mapreduce.map.output.key.class"
 #define MAPRED_OUTPUT_KEY_CLASS "mapreduce.job.output.key.class"
 #define MAPRED_MAPOUTPUT_VALUE_CLASS "mapreduce.map.output.value.class"
 #define MAPRED_OUTPUT_VALUE_CLASS "mapreduce.job.output.value.class"
 #define MAPRED_IO_SORT_MB "mapreduce.task.io.sort.mb"
+#define MAPRED_IO_SORT_FACTOR "mapreduce.task.io.sort.factor"
+#define MAPRED_SORT_SPILL_PERCENT "mapreduce.map.sort.spill.percent"
 #define MAPRED_NUM_REDUCES "mapreduce.job.reduces"
 #define MAPRED_COMBINE_CLASS_OLD "mapred.combiner.class"
 #define MAPRED_COMBINE_CLASS_NEW "mapreduce.job.combine.class"
@@ -340,8 +362,6 @@ public:
 
 class Counter {
 private:
-  // not thread safe
-  // TODO: use atomic
   volatile uint64_t _count;
 
   string _group;
@@ -363,11 +383,11 @@ public:
   }
 
   void increase() {
-    _count++;
+    __sync_fetch_and_add(&_count, 1);
   }
 
   void increase(uint64_t cnt) {
-    _count += cnt;
+    __sync_fetch_and_add(&_count, cnt);
   }
 };
 
@@ -22,8 +22,50 @@
 
 namespace NativeTask {
 
+BlockCodecTask::BlockCodecTask()
+    : input(NULL), inputCapacity(0), inputLength(0), output(NULL), outputCapacity(0),
+        outputLength(0) {
+}
+
+BlockCodecTask::~BlockCodecTask() {
+  free(input);
+  input = NULL;
+  free(output);
+  output = NULL;
+}
+
+void BlockCodecTask::reserve(uint32_t inputSize, uint32_t outputSize) {
+  if (inputSize > inputCapacity) {
+    char * newBuffer = (char *)realloc(input, inputSize);
+    if (newBuffer == NULL) {
+      THROW_EXCEPTION(OutOfMemoryException, "realloc failed");
+    }
+    input = newBuffer;
+    inputCapacity = inputSize;
+  }
+  if (outputSize > outputCapacity) {
+    char * newBuffer = (char *)realloc(output, outputSize);
+    if (newBuffer == NULL) {
+      THROW_EXCEPTION(OutOfMemoryException, "realloc failed");
+    }
+    output = newBuffer;
+    outputCapacity = outputSize;
+  }
+}
+
+//////////////////////////////////////////////////////////////
+
+void BlockCompressStream::CompressTask::execute() {
+  uint32_t compressedLength = owner->compressBlock(input, inputLength, output + 8,
+      outputCapacity - 8);
+  ((uint32_t*)output)[0] = bswap(inputLength);
+  ((uint32_t*)output)[1] = bswap(compressedLength);
+  outputLength = compressedLength + 8;
+}
+
 BlockCompressStream::BlockCompressStream(OutputStream * stream, uint32_t bufferSizeHint)
-    : CompressStream(stream), _tempBuffer(NULL), _tempBufferSize(0), _compressedBytesWritten(0) {
+    : CompressStream(stream), _tempBuffer(NULL), _tempBufferSize(0), _compressedBytesWritten(0),
+        _pool(NULL), _maxPending(0) {
   _hint = bufferSizeHint;
   _blockMax = bufferSizeHint / 2 * 3;
 }
@@ -34,21 +76,88 @@ void BlockCompressStream::init() {
 }
 
 BlockCompressStream::~BlockCompressStream() {
+  waitPending();
+  for (size_t i = 0; i < _freeTasks.size(); i++) {
+    delete _freeTasks[i];
+  }
+  _freeTasks.clear();
   delete[] _tempBuffer;
   _tempBuffer = NULL;
   _tempBufferSize = 0;
 }
 
+void BlockCompressStream::setThreadPool(ThreadPool * pool, uint32_t maxPending) {
+  drainPending(0);
+  _pool = pool;
+  _maxPending = maxPending > 0 ? maxPending : 1;
+}
+
 void BlockCompressStream::write(const void * buff, uint32_t length) {
   while (length > 0) {
     uint32_t take = length < _blockMax ? length : _hint;
-    compressOneBlock(buff, take);
+    if (NULL != _pool) {
+      submitBlock(buff, take);
+    } else {
+      compressOneBlock(buff, take);
+    }
     buff = ((const char *)buff) + take;
     length -= take;
   }
 }
 
+void BlockCompressStream::compressOneBlock(const void * buff, uint32_t length) {
+  uint32_t compressedLength = compressBlock(buff, length, _tempBuffer + 8, _tempBufferSize - 8);
+  ((uint32_t*)_tempBuffer)[0] = bswap(length);
+  ((uint32_t*)_tempBuffer)[1] = bswap(compressedLength);
+  _stream->write(_tempBuffer, compressedLength + 8);
+  _compressedBytesWritten += (compressedLength + 8);
+}
+
+void BlockCompressStream::submitBlock(const void * buff, uint32_t length) {
+  if (_pending.size() >= _maxPending) {
+    drainPending(_maxPending - 1);
+  }
+  CompressTask * task;
+  if (_freeTasks.empty()) {
+    task = new CompressTask(this);
+  } else {
+    task = _freeTasks.back();
+    _freeTasks.pop_back();
+    task->reset();
+  }
+  task->reserve(_blockMax, _tempBufferSize);
+  // the caller may reuse buff as soon as write() returns
+  simple_memcpy(task->input, buff, length);
+  task->inputLength = length;
+  _pending.push_back(task);
+  _pool->submit(task);
+}
+
+void BlockCompressStream::drainPending(size_t keep) {
+  while (_pending.size() > keep) {
+    CompressTask * task = _pending.front();
+    _pending.pop_front();
+    _freeTasks.push_back(task);
+    task->waitFinish();
+    _stream->write(task->output, task->outputLength);
+    _compressedBytesWritten += task->outputLength;
+  }
+}
+
+void BlockCompressStream::waitPending() {
+  while (!_pending.empty()) {
+    CompressTask * task = _pending.front();
+    _pending.pop_front();
+    try {
+      task->waitFinish();
+    } catch (std::exception & e) {
+    }
+    delete task;
+  }
+}
+
 void BlockCompressStream::flush() {
+  drainPending(0);
   _stream->flush();
 }
 
@@ -57,18 +166,28 @@ void BlockCompressStream::close() {
 }
 
 void BlockCompressStream::writeDirect(const void * buff, uint32_t length) {
+  drainPending(0);
   _stream->write(buff, length);
   _compressedBytesWritten += length;
 }
 
 uint64_t BlockCompressStream::compressedBytesWritten() {
+  drainPending(0);
   return _compressedBytesWritten;
 }
 
 //////////////////////////////////////////////////////////////
 
+void BlockDecompressStream::DecompressTask::execute() {
+  uint32_t len = owner->decompressBlock(input, inputLength, output, outputLength);
+  if (len != outputLength) {
+    THROW_EXCEPTION(IOException, "Block decompress data error, length not match");
+  }
+}
+
 BlockDecompressStream::BlockDecompressStream(InputStream * stream, uint32_t bufferSizeHint)
-    : DecompressStream(stream), _tempBuffer(NULL), _tempBufferSize(0) {
+    : DecompressStream(stream), _tempBuffer(NULL), _tempBufferSize(0), _pool(NULL),
+        _maxPending(0), _current(NULL), _currentUsed(0) {
   _hint = bufferSizeHint;
   _blockMax = bufferSizeHint / 2 * 3;
   _tempDecompressBuffer = NULL;
@@ -85,6 +204,11 @@ void BlockDecompressStream::init() {
 
 BlockDecompressStream::~BlockDecompressStream() {
   close();
+  waitPending();
+  for (size_t i = 0; i < _freeTasks.size(); i++) {
+    delete _freeTasks[i];
+  }
+  _freeTasks.clear();
   if (NULL != _tempBuffer) {
     free(_tempBuffer);
     _tempBuffer = NULL;
@@ -92,7 +216,36 @@ BlockDecompressStream::~BlockDecompressStream() {
   _tempBufferSize = 0;
 }
 
+void BlockDecompressStream::setThreadPool(ThreadPool * pool, uint32_t maxPending) {
+  if (_tempDecompressBufferSize > 0 || NULL != _current || !_pending.empty()) {
+    THROW_EXCEPTION(IOException, "setThreadPool() called after read()");
+  }
+  _pool = pool;
+  _maxPending = maxPending > 0 ? maxPending : 1;
+}
+
+uint32_t BlockDecompressStream::decompressOneBlock(uint32_t compressedSize, void * buff,
+    uint32_t length) {
+  if (compressedSize > _tempBufferSize) {
+    char * newBuffer = (char *)realloc(_tempBuffer, compressedSize);
+    if (newBuffer == NULL) {
+      THROW_EXCEPTION(OutOfMemoryException, "realloc failed");
+    }
+    _tempBuffer = newBuffer;
+    _tempBufferSize = compressedSize;
+  }
+  uint32_t rd = _stream->readFully(_tempBuffer, compressedSize);
+  if (rd != compressedSize) {
+    THROW_EXCEPTION(IOException, "readFully reach EOF");
+  }
+  _compressedBytesRead += rd;
+  return decompressBlock(_tempBuffer, compressedSize, buff, length);
+}
+
 int32_t BlockDecompressStream::read(void * buff, uint32_t length) {
+  if (NULL != _pool) {
+    return readPipelined(buff, length);
+  }
   if (_tempDecompressBufferSize == 0) {
     uint32_t sizes[2];
     int32_t rd = _stream->readFully(&sizes, sizeof(uint32_t) * 2);
@@ -147,6 +300,85 @@ int32_t BlockDecompressStream::read(void * buff, uint32_t length) {
   return -1;
 }
 
+int32_t BlockDecompressStream::readPipelined(void * buff, uint32_t length) {
+  if (NULL == _current) {
+    fillPending();
+    if (_pending.empty()) {
+      // EOF
+      return -1;
+    }
+    _current = _pending.front();
+    _pending.pop_front();
+    _currentUsed = 0;
+    _current->waitFinish();
+    // keep the pool busy while the caller consumes this block
+    fillPending();
+  }
+  uint32_t left = _current->outputLength - _currentUsed;
+  uint32_t cp = length < left ? length : left;
+  simple_memcpy(buff, _current->output + _currentUsed, cp);
+  _currentUsed += cp;
+  if (_currentUsed == _current->outputLength) {
+    recycle(_current);
+    _current = NULL;
+  }
+  return cp;
+}
+
+void BlockDecompressStream::fillPending() {
+  while (_pending.size() < _maxPending) {
+    uint32_t sizes[2];
+    int32_t rd = _stream->readFully(&sizes, sizeof(uint32_t) * 2);
+    if (rd <= 0) {
+      // EOF, or the end of a segment limited source
+      return;
+    }
+    if (rd != sizeof(uint32_t) * 2) {
+      THROW_EXCEPTION(IOException, "readFully get incomplete data");
+    }
+    _compressedBytesRead += rd;
+    sizes[0] = bswap(sizes[0]);
+    sizes[1] = bswap(sizes[1]);
+    DecompressTask * task;
+    if (_freeTasks.empty()) {
+      task = new DecompressTask(this);
+    } else {
+      task = _freeTasks.back();
+      _freeTasks.pop_back();
+      task->reset();
+    }
+    task->reserve(sizes[1], sizes[0]);
+    rd = _stream->readFully(task->input, sizes[1]);
+    if ((uint32_t)rd != sizes[1]) {
+      recycle(task);
+      THROW_EXCEPTION(IOException, "readFully reach EOF");
+    }
+    _compressedBytesRead += rd;
+    task->inputLength = sizes[1];
+    task->outputLength = sizes[0];
+    _pending.push_back(task);
+    _pool->submit(task);
+  }
+}
+
+void BlockDecompressStream::recycle(DecompressTask * task) {
+  _freeTasks.push_back(task);
+}
+
+void BlockDecompressStream::waitPending() {
+  while (!_pending.empty()) {
+    DecompressTask * task = _pending.front();
+    _pending.pop_front();
+    try {
+      task->waitFinish();
+    } catch (std::exception & e) {
+    }
+    delete task;
+  }
+  delete _current;
+  _current = NULL;
+}
+
 void BlockDecompressStream::close() {
   if (_tempDecompressBufferSize > 0) {
     LOG("[BlockDecompressStream] Some data left in the _tempDecompressBuffer when close()");
@@ -161,7 +393,7 @@ void BlockDecompressStream::close() {
 }
 
 int32_t BlockDecompressStream::readDirect(void * buff, uint32_t length) {
-  if (_tempDecompressBufferSize > 0) {
+  if (_tempDecompressBufferSize > 0 || NULL != _current || !_pending.empty()) {
     THROW_EXCEPTION(IOException, "temp decompress data exists when call readDirect()");
   }
   int32_t ret = _stream->readFully(buff, length);
@@ -19,17 +19,58 @@
 #ifndef BLOCKCODEC_H_
 #define BLOCKCODEC_H_
 
+#include <deque>
 #include "lib/Compressions.h"
+#include "util/SyncUtils.h"
 
 namespace NativeTask {
 
+class BlockCompressStream;
+class BlockDecompressStream;
+
+/**
+ * One block compressed or decompressed on a pool thread, input and
+ * output buffers are owned by the task and reused across blocks
+ */
+class BlockCodecTask : public AsyncTask {
+public:
+  char * input;
+  uint32_t inputCapacity;
+  uint32_t inputLength;
+  char * output;
+  uint32_t outputCapacity;
+  uint32_t outputLength;
+
+  BlockCodecTask();
+
+  virtual ~BlockCodecTask();
+
+  void reserve(uint32_t inputSize, uint32_t outputSize);
+};
+
 class BlockCompressStream : public CompressStream {
 protected:
+  class CompressTask : public BlockCodecTask {
+  public:
+    BlockCompressStream * owner;
+
+    CompressTask(BlockCompressStream * owner)
+        : owner(owner) {
+    }
+
+  protected:
+    virtual void execute();
+  };
+
   uint32_t _hint;
   uint32_t _blockMax;
   char * _tempBuffer;
   uint32_t _tempBufferSize;
   uint64_t _compressedBytesWritten;
+  ThreadPool * _pool;
+  uint32_t _maxPending;
+  std::deque<CompressTask *> _pending;
+  std::vector<CompressTask *> _freeTasks;
 public:
   BlockCompressStream(OutputStream * stream, uint32_t bufferSizeHint);
 
@@ -47,17 +88,53 @@ public:
 
   void init();
 
+  /**
+   * Compress blocks on pool threads, keeping at most maxPending
+   * blocks in flight; blocks are still written in order and the
+   * on disk format is unchanged
+   */
+  void setThreadPool(ThreadPool * pool, uint32_t maxPending);
+
 protected:
   virtual uint64_t maxCompressedLength(uint64_t origLength) {
     return origLength;
   }
 
-  virtual void compressOneBlock(const void * buff, uint32_t length) {
+  /**
+   * Compress one raw block into dest, return the compressed length;
+   * may run on any thread so must not touch stream state
+   */
+  virtual uint32_t compressBlock(const void * buff, uint32_t length, char * dest,
+      uint32_t capacity) {
+    THROW_EXCEPTION(UnsupportException, "compressBlock not support");
   }
+
+  void compressOneBlock(const void * buff, uint32_t length);
+
+  void submitBlock(const void * buff, uint32_t length);
+
+  /**
+   * Write out completed blocks in order until at most keep remain
+   */
+  void drainPending(size_t keep);
+
+  void waitPending();
 };
 
 class BlockDecompressStream : public DecompressStream {
 protected:
+  class DecompressTask : public BlockCodecTask {
+  public:
+    BlockDecompressStream * owner;
+
+    DecompressTask(BlockDecompressStream * owner)
+        : owner(owner) {
+    }
+
+  protected:
+    virtual void execute();
+  };
+
   uint32_t _hint;
   uint32_t _blockMax;
   char * _tempBuffer;
@@ -67,6 +144,12 @@ protected:
   uint32_t _tempDecompressBufferUsed;
   uint32_t _tempDecompressBufferCapacity;
   uint64_t _compressedBytesRead;
+  ThreadPool * _pool;
+  uint32_t _maxPending;
+  std::deque<DecompressTask *> _pending;
+  std::vector<DecompressTask *> _freeTasks;
+  DecompressTask * _current;
+  uint32_t _currentUsed;
 public:
   BlockDecompressStream(InputStream * stream, uint32_t bufferSizeHint);
 
@@ -82,15 +165,40 @@ public:
 
   void init();
 
+  /**
+   * Read ahead up to maxPending blocks and decompress them on pool
+   * threads while the caller consumes the current one
+   */
+  void setThreadPool(ThreadPool * pool, uint32_t maxPending);
+
 protected:
   virtual uint64_t maxCompressedLength(uint64_t origLength) {
     return origLength;
   }
 
-  virtual uint32_t decompressOneBlock(uint32_t compressedSize, void * buff, uint32_t length) {
-    //TODO: add implementation
-    return 0;
+  /**
+   * Decompress one block of compressedSize bytes into buff, return the
+   * uncompressed length; may run on any thread so must not touch
+   * stream state
+   */
+  virtual uint32_t decompressBlock(const char * compressed, uint32_t compressedSize, void * buff,
+      uint32_t length) {
+    THROW_EXCEPTION(UnsupportException, "decompressBlock not support");
   }
+
+  uint32_t decompressOneBlock(uint32_t compressedSize, void * buff, uint32_t length);
+
+  int32_t readPipelined(void * buff, uint32_t length);
+
+  /**
+   * Read and submit blocks until maxPending are in flight or the
+   * underlying stream returns EOF
+   */
+  void fillPending();
+
+  void recycle(DecompressTask * task);
+
+  void waitPending();
 };
 
 } // namespace NativeTask
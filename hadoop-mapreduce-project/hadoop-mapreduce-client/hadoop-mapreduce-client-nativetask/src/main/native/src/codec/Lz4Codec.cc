@@ -33,15 +33,11 @@ Lz4CompressStream::Lz4CompressStream(OutputStream * stream, uint32_t bufferSizeH
   init();
 }
 
-void Lz4CompressStream::compressOneBlock(const void * buff, uint32_t length) {
-  size_t compressedLength = _tempBufferSize - 8;
-  int ret = LZ4_compress((char*)buff, _tempBuffer + 8, length);
+uint32_t Lz4CompressStream::compressBlock(const void * buff, uint32_t length, char * dest,
+    uint32_t capacity) {
+  int ret = LZ4_compress((char*)buff, dest, length);
   if (ret > 0) {
-    compressedLength = ret;
-    ((uint32_t*)_tempBuffer)[0] = bswap(length);
-    ((uint32_t*)_tempBuffer)[1] = bswap((uint32_t)compressedLength);
-    _stream->write(_tempBuffer, compressedLength + 8);
-    _compressedBytesWritten += (compressedLength + 8);
+    return ret;
   } else {
     THROW_EXCEPTION(IOException, "compress LZ4 failed");
   }
@@ -58,22 +54,9 @@ Lz4DecompressStream::Lz4DecompressStream(InputStream * stream, uint32_t bufferSi
   init();
 }
 
-uint32_t Lz4DecompressStream::decompressOneBlock(uint32_t compressedSize, void * buff,
-    uint32_t length) {
-  if (compressedSize > _tempBufferSize) {
-    char * newBuffer = (char *)realloc(_tempBuffer, compressedSize);
-    if (newBuffer == NULL) {
-      THROW_EXCEPTION(OutOfMemoryException, "realloc failed");
-    }
-    _tempBuffer = newBuffer;
-    _tempBufferSize = compressedSize;
-  }
-  uint32_t rd = _stream->readFully(_tempBuffer, compressedSize);
-  if (rd != compressedSize) {
-    THROW_EXCEPTION(IOException, "readFully reach EOF");
-  }
-  _compressedBytesRead += rd;
-  uint32_t ret = LZ4_decompress_fast(_tempBuffer, (char*)buff, length);
+uint32_t Lz4DecompressStream::decompressBlock(const char * compressed, uint32_t compressedSize,
+    void * buff, uint32_t length) {
+  uint32_t ret = LZ4_decompress_fast(compressed, (char*)buff, length);
   if (ret == compressedSize) {
     return length;
   } else {
@@ -29,7 +29,8 @@ public:
   Lz4CompressStream(OutputStream * stream, uint32_t bufferSizeHint);
 protected:
   virtual uint64_t maxCompressedLength(uint64_t origLength);
-  virtual void compressOneBlock(const void * buff, uint32_t length);
+  virtual uint32_t compressBlock(const void * buff, uint32_t length, char * dest,
+      uint32_t capacity);
 };
 
 class Lz4DecompressStream : public BlockDecompressStream {
@@ -37,7 +38,8 @@ public:
   Lz4DecompressStream(InputStream * stream, uint32_t bufferSizeHint);
 protected:
   virtual uint64_t maxCompressedLength(uint64_t origLength);
-  virtual uint32_t decompressOneBlock(uint32_t compressedSize, void * buff, uint32_t length);
+  virtual uint32_t decompressBlock(const char * compressed, uint32_t compressedSize, void * buff,
+      uint32_t length);
 };
 
 } // namespace NativeTask
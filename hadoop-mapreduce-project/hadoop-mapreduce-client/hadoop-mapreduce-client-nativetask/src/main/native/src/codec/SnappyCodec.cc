@@ -32,15 +32,12 @@ SnappyCompressStream::SnappyCompressStream(OutputStream * stream, uint32_t buffe
   init();
 }
 
-void SnappyCompressStream::compressOneBlock(const void * buff, uint32_t length) {
-  size_t compressedLength = _tempBufferSize - 8;
-  snappy_status ret = snappy_compress((const char*)buff, length, _tempBuffer + 8,
-      &compressedLength);
+uint32_t SnappyCompressStream::compressBlock(const void * buff, uint32_t length, char * dest,
+    uint32_t capacity) {
+  size_t compressedLength = capacity;
+  snappy_status ret = snappy_compress((const char*)buff, length, dest, &compressedLength);
   if (ret == SNAPPY_OK) {
-    ((uint32_t*)_tempBuffer)[0] = bswap(length);
-    ((uint32_t*)_tempBuffer)[1] = bswap((uint32_t)compressedLength);
-    _stream->write(_tempBuffer, compressedLength + 8);
-    _compressedBytesWritten += (compressedLength + 8);
+    return compressedLength;
   } else if (ret == SNAPPY_INVALID_INPUT) {
     THROW_EXCEPTION(IOException, "compress SNAPPY_INVALID_INPUT");
   } else if (ret == SNAPPY_BUFFER_TOO_SMALL) {
@@ -61,23 +58,10 @@ SnappyDecompressStream::SnappyDecompressStream(InputStream * stream, uint32_t bu
   init();
 }
 
-uint32_t SnappyDecompressStream::decompressOneBlock(uint32_t compressedSize, void * buff,
-    uint32_t length) {
-  if (compressedSize > _tempBufferSize) {
-    char * newBuffer = (char *)realloc(_tempBuffer, compressedSize);
-    if (newBuffer == NULL) {
-      THROW_EXCEPTION(OutOfMemoryException, "realloc failed");
-    }
-    _tempBuffer = newBuffer;
-    _tempBufferSize = compressedSize;
-  }
-  uint32_t rd = _stream->readFully(_tempBuffer, compressedSize);
-  if (rd != compressedSize) {
-    THROW_EXCEPTION(IOException, "readFully reach EOF");
-  }
-  _compressedBytesRead += rd;
+uint32_t SnappyDecompressStream::decompressBlock(const char * compressed,
+    uint32_t compressedSize, void * buff, uint32_t length) {
   size_t uncompressedLength = length;
-  snappy_status ret = snappy_uncompress(_tempBuffer, compressedSize, (char *)buff,
+  snappy_status ret = snappy_uncompress(compressed, compressedSize, (char *)buff,
       &uncompressedLength);
   if (ret == SNAPPY_OK) {
     return uncompressedLength;
@@ -29,7 +29,8 @@ public:
   SnappyCompressStream(OutputStream * stream, uint32_t bufferSizeHint);
 protected:
   virtual uint64_t maxCompressedLength(uint64_t origLength);
-  virtual void compressOneBlock(const void * buff, uint32_t length);
+  virtual uint32_t compressBlock(const void * buff, uint32_t length, char * dest,
+      uint32_t capacity);
 };
 
 class SnappyDecompressStream : public BlockDecompressStream {
@@ -38,7 +39,8 @@ public:
 
 protected:
   virtual uint64_t maxCompressedLength(uint64_t origLength);
-  virtual uint32_t decompressOneBlock(uint32_t compressedSize, void * buff, uint32_t length);
+  virtual uint32_t decompressBlock(const char * compressed, uint32_t compressedSize, void * buff,
+      uint32_t length);
 };
 
 } // namespace NativeTask
@@ -0,0 +1,186 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <zstd.h>
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "ZstdCodec.h"
+
+namespace NativeTask {
+
+ZstdCompressStream::ZstdCompressStream(OutputStream * stream, uint32_t bufferSizeHint,
+    int level)
+    : CompressStream(stream), _compressedBytesWritten(0), _cstream(NULL), _level(level),
+        _finished(false) {
+  _capacity = std::max(bufferSizeHint, (uint32_t)ZSTD_CStreamOutSize());
+  _buffer = new char[_capacity];
+  _cstream = ZSTD_createCStream();
+  if (NULL == _cstream) {
+    delete[] _buffer;
+    _buffer = NULL;
+    THROW_EXCEPTION(OutOfMemoryException, "ZSTD_createCStream failed");
+  }
+  size_t ret = ZSTD_initCStream((ZSTD_CStream*)_cstream, _level);
+  if (ZSTD_isError(ret)) {
+    ZSTD_freeCStream((ZSTD_CStream*)_cstream);
+    _cstream = NULL;
+    delete[] _buffer;
+    _buffer = NULL;
+    THROW_EXCEPTION_EX(IOException, "ZSTD_initCStream failed: %s", ZSTD_getErrorName(ret));
+  }
+}
+
+ZstdCompressStream::~ZstdCompressStream() {
+  if (_cstream != NULL) {
+    ZSTD_freeCStream((ZSTD_CStream*)_cstream);
+    _cstream = NULL;
+  }
+  delete[] _buffer;
+  _buffer = NULL;
+}
+
+void ZstdCompressStream::writeOut(uint32_t length) {
+  if (length > 0) {
+    _stream->write(_buffer, length);
+    _compressedBytesWritten += length;
+  }
+}
+
+void ZstdCompressStream::write(const void * buff, uint32_t length) {
+  ZSTD_inBuffer input = {buff, length, 0};
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output = {_buffer, _capacity, 0};
+    size_t ret = ZSTD_compressStream((ZSTD_CStream*)_cstream, &output, &input);
+    if (ZSTD_isError(ret)) {
+      THROW_EXCEPTION_EX(IOException, "ZSTD_compressStream failed: %s", ZSTD_getErrorName(ret));
+    }
+    writeOut(output.pos);
+  }
+  _finished = false;
+}
+
+void ZstdCompressStream::flush() {
+  while (true) {
+    ZSTD_outBuffer output = {_buffer, _capacity, 0};
+    size_t remain = ZSTD_endStream((ZSTD_CStream*)_cstream, &output);
+    if (ZSTD_isError(remain)) {
+      THROW_EXCEPTION_EX(IOException, "ZSTD_endStream failed: %s", ZSTD_getErrorName(remain));
+    }
+    writeOut(output.pos);
+    if (remain == 0) {
+      break;
+    }
+  }
+  _finished = true;
+  _stream->flush();
+}
+
+void ZstdCompressStream::resetState() {
+  size_t ret = ZSTD_initCStream((ZSTD_CStream*)_cstream, _level);
+  if (ZSTD_isError(ret)) {
+    THROW_EXCEPTION_EX(IOException, "ZSTD_initCStream failed: %s", ZSTD_getErrorName(ret));
+  }
+}
+
+void ZstdCompressStream::close() {
+  if (!_finished) {
+    flush();
+  }
+}
+
+void ZstdCompressStream::writeDirect(const void * buff, uint32_t length) {
+  if (!_finished) {
+    flush();
+  }
+  _stream->write(buff, length);
+  _compressedBytesWritten += length;
+}
+
+//////////////////////////////////////////////////////////////
+
+ZstdDecompressStream::ZstdDecompressStream(InputStream * stream, uint32_t bufferSizeHint)
+    : DecompressStream(stream), _compressedBytesRead(0), _pos(0), _size(0), _dstream(NULL),
+        _eof(false) {
+  _capacity = std::max(bufferSizeHint, (uint32_t)ZSTD_DStreamInSize());
+  _buffer = new char[_capacity];
+  _dstream = ZSTD_createDStream();
+  if (NULL == _dstream) {
+    delete[] _buffer;
+    _buffer = NULL;
+    THROW_EXCEPTION(OutOfMemoryException, "ZSTD_createDStream failed");
+  }
+  size_t ret = ZSTD_initDStream((ZSTD_DStream*)_dstream);
+  if (ZSTD_isError(ret)) {
+    ZSTD_freeDStream((ZSTD_DStream*)_dstream);
+    _dstream = NULL;
+    delete[] _buffer;
+    _buffer = NULL;
+    THROW_EXCEPTION_EX(IOException, "ZSTD_initDStream failed: %s", ZSTD_getErrorName(ret));
+  }
+}
+
+ZstdDecompressStream::~ZstdDecompressStream() {
+  if (_dstream != NULL) {
+    ZSTD_freeDStream((ZSTD_DStream*)_dstream);
+    _dstream = NULL;
+  }
+  delete[] _buffer;
+  _buffer = NULL;
+}
+
+int32_t ZstdDecompressStream::read(void * buff, uint32_t length) {
+  ZSTD_outBuffer output = {buff, length, 0};
+  while (true) {
+    // drain whatever the decoder still holds before asking for more input,
+    // a segment limited source returns EOF once its frame is consumed
+    ZSTD_inBuffer input = {_buffer, _size, _pos};
+    size_t ret = ZSTD_decompressStream((ZSTD_DStream*)_dstream, &output, &input);
+    if (ZSTD_isError(ret)) {
+      THROW_EXCEPTION_EX(IOException, "ZSTD_decompressStream failed: %s",
+          ZSTD_getErrorName(ret));
+    }
+    _pos = input.pos;
+    if (output.pos == output.size) {
+      return length;
+    }
+    if (_pos == _size) {
+      int32_t rd = _stream->read(_buffer, _capacity);
+      if (rd <= 0) {
+        _eof = true;
+        return output.pos > 0 ? output.pos : -1;
+      }
+      _compressedBytesRead += rd;
+      _pos = 0;
+      _size = rd;
+    }
+  }
+  return -1;
+}
+
+void ZstdDecompressStream::close() {
+}
+
+int32_t ZstdDecompressStream::readDirect(void * buff, uint32_t length) {
+  int32_t ret = _stream->readFully(buff, length);
+  if (ret > 0) {
+    _compressedBytesRead += ret;
+  }
+  return ret;
+}
+
+} // namespace NativeTask
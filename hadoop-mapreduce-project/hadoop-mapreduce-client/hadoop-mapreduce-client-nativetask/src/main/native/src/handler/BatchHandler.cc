@@ -300,6 +300,43 @@ void JNICALL Java_org_apache_hadoop_mapred_nativetask_NativeBatchProcessor_nativ
   }
 }
 
+/*
+ * Class:     org_apache_hadoop_mapred_nativetask_NativeBatchProcessor
+ * Method:    nativeSwapSharedBuffer
+ * Signature: (JII)Ljava/nio/ByteBuffer;
+ */
+jobject JNICALL Java_org_apache_hadoop_mapred_nativetask_NativeBatchProcessor_nativeSwapSharedBuffer(
+    JNIEnv * jenv, jobject processor, jlong handler, jint length, jint minLength) {
+  try {
+    NativeTask::BatchHandler * batchHandler = (NativeTask::BatchHandler *)((void*)handler);
+    if (NULL == batchHandler) {
+      JNU_ThrowByName(jenv, "java/lang/IllegalArgumentException",
+          "handler not instance of BatchHandler");
+      return NULL;
+    }
+    uint32_t capacity = 0;
+    char * buffer = batchHandler->onSwapSharedBuffer(length, minLength, capacity);
+    if (NULL == buffer) {
+      return NULL;
+    }
+    return jenv->NewDirectByteBuffer(buffer, capacity);
+  } catch (NativeTask::UnsupportException & e) {
+    JNU_ThrowByName(jenv, "java/lang/UnsupportedOperationException", e.what());
+  } catch (NativeTask::OutOfMemoryException & e) {
+    JNU_ThrowByName(jenv, "java/lang/OutOfMemoryError", e.what());
+  } catch (NativeTask::IOException & e) {
+    JNU_ThrowByName(jenv, "java/io/IOException", e.what());
+  } catch (NativeTask::JavaException & e) {
+    LOG("JavaException: %s", e.what());
+    // Do nothing, let java side handle
+  } catch (std::exception & e) {
+    JNU_ThrowByName(jenv, "java/io/IOException", e.what());
+  } catch (...) {
+    JNU_ThrowByName(jenv, "java/io/IOException", "Unknown exception");
+  }
+  return NULL;
+}
+
 /*
  * Class:     org_apache_hadoop_mapred_nativetask_NativeBatchProcessor
  * Method:    nativeCommand
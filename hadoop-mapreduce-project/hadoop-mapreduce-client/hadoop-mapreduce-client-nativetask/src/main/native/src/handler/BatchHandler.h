@@ -66,6 +66,20 @@ public:
   virtual void onLoadData() {
   }
 
+  /**
+   * Called by java side to hand back the first length bytes of the
+   * shared buffer returned by the previous call, and to get a new one
+   * of at least minLength bytes, which java writes input into directly
+   * instead of into the input buffer.
+   * BatchHandler has no shared buffers by default
+   * @param capacity size of the returned buffer
+   * @return NULL if shared buffers are not supported, or if minLength
+   *         is 0, i.e. input is finished
+   */
+  virtual char * onSwapSharedBuffer(uint32_t length, uint32_t minLength, uint32_t & capacity) {
+    return NULL;
+  }
+
   /**
    * Called by java side to notice that input has finished
    */
@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 #include "CombineHandler.h"
+#include "lib/NativeObjectFactory.h"
 
 namespace NativeTask {
 const char * REFILL = "refill";
@@ -23,10 +24,19 @@ const int LENGTH_OF_REFILL_STRING = 6;
 
 const Command CombineHandler::COMBINE(4, "Combine");
 
+const char * CombineHandler::COUNTER_GROUP = "NativeTask Combine";
+const char * CombineHandler::LOAD_CALLS = "JNI_LOAD_CALLS";
+const char * CombineHandler::BATCHES = "JNI_BATCHES";
+const char * CombineHandler::BYTES = "JNI_BYTES";
+
 CombineHandler::CombineHandler()
     : _combineContext(NULL), _kvIterator(NULL), _writer(NULL), _kType(UnknownType),
         _vType(UnknownType), _config(NULL), _kvCached(false), _combineInputRecordCount(0),
-        _combineInputBytes(0), _combineOutputRecordCount(0), _combineOutputBytes(0) {
+        _combineInputBytes(0), _combineOutputRecordCount(0), _combineOutputBytes(0),
+        _combineLoadCount(0), _combineBatchCount(0) {
+  _loadCalls = NativeObjectFactory::GetCounter(COUNTER_GROUP, LOAD_CALLS);
+  _batches = NativeObjectFactory::GetCounter(COUNTER_GROUP, BATCHES);
+  _bytes = NativeObjectFactory::GetCounter(COUNTER_GROUP, BYTES);
 }
 
 CombineHandler::~CombineHandler() {
@@ -48,10 +58,7 @@ uint32_t CombineHandler::feedDataToJavaInWritableSerialization() {
 
   if (_kvCached) {
     uint32_t kvLength = _key.outerLength + _value.outerLength + KVBuffer::headerLength();
-    outputInt(bswap(_key.outerLength));
-    outputInt(bswap(_value.outerLength));
-    outputKeyOrValue(_key, _kType);
-    outputKeyOrValue(_value, _vType);
+    outputKeyValue(kvLength);
 
     written += kvLength;
     _kvCached = false;
@@ -72,11 +79,7 @@ uint32_t CombineHandler::feedDataToJavaInWritableSerialization() {
       break;
     } else {
       firstKV = false;
-      //write final key length and final value length
-      outputInt(bswap(_key.outerLength));
-      outputInt(bswap(_value.outerLength));
-      outputKeyOrValue(_key, _kType);
-      outputKeyOrValue(_value, _vType);
+      outputKeyValue(kvLength);
 
       written += kvLength;
     }
@@ -91,6 +94,48 @@ uint32_t CombineHandler::feedDataToJavaInWritableSerialization() {
   return written;
 }
 
+/**
+ * KV: key or value, returns the end of the written bytes
+ */
+static inline char * copyKeyOrValue(char * dest, SerializeInfo & KV, KeyValueType type) {
+  uint32_t length = KV.buffer.length();
+  switch (type) {
+  case TextType:
+    simple_memcpy(dest, KV.varBytes, KV.outerLength - length);
+    dest += KV.outerLength - length;
+    break;
+  case BytesType:
+    *(uint32_t *)dest = bswap(length);
+    dest += 4;
+    break;
+  default:
+    break;
+  }
+  simple_memcpy(dest, KV.buffer.data(), length);
+  return dest + length;
+}
+
+/**
+ * write final key length, final value length, key and value; records
+ * fitting the output buffer are copied in place without per field checks
+ */
+void CombineHandler::outputKeyValue(uint32_t kvLength) {
+  if (kvLength > _out.remain()) {
+    outputInt(bswap(_key.outerLength));
+    outputInt(bswap(_value.outerLength));
+    outputKeyOrValue(_key, _kType);
+    outputKeyOrValue(_value, _vType);
+    return;
+  }
+
+  char * pos = _out.current();
+  *(uint32_t *)pos = bswap(_key.outerLength);
+  *(uint32_t *)(pos + 4) = bswap(_value.outerLength);
+  pos = copyKeyOrValue(pos + KVBuffer::headerLength(), _key, _kType);
+  copyKeyOrValue(pos, _value, _vType);
+  _out.advance(kvLength);
+}
+
 /**
  * KV: key or value
  */
@@ -204,7 +249,7 @@ void CombineHandler::write(char * buf, uint32_t length) {
     kv = (KVBuffer *)pos;
     kv->keyLength = bswap(kv->keyLength);
     kv->valueLength = bswap(kv->valueLength);
-    _writer->write(kv->getKey(), kv->keyLength, kv->getValue(), kv->valueLength);
+    _writer->collect(kv->getKey(), kv->keyLength, kv->getValue(), kv->valueLength);
     outputRecordCount++;
     remain -= kv->length();
     pos += kv->length();
@@ -222,29 +267,45 @@ string toString(uint32_t length) {
 }
 
 void CombineHandler::onLoadData() {
+  _combineLoadCount++;
   feedDataToJava(WRITABLE_SERIALIZATION);
 }
 
+void CombineHandler::flushOutput() {
+  if (_out.position() > 0) {
+    _combineBatchCount++;
+  }
+  BatchHandler::flushOutput();
+}
+
 ResultBuffer * CombineHandler::onCall(const Command& command, ParameterBuffer * param) {
   THROW_EXCEPTION(UnsupportException, "Command not supported by RReducerHandler");
 }
 
-void CombineHandler::combine(CombineContext type, KVIterator * kvIterator, IFileWriter * writer) {
+void CombineHandler::combine(CombineContext type, KVIterator * kvIterator, Collector * writer) {
 
   _combineInputRecordCount = 0;
   _combineOutputRecordCount = 0;
   _combineInputBytes = 0;
   _combineOutputBytes = 0;
+  _combineLoadCount = 0;
+  _combineBatchCount = 0;
 
   this->_combineContext = &type;
   this->_kvIterator = kvIterator;
   this->_writer = writer;
   call(COMBINE, NULL);
+  _loadCalls->increase(_combineLoadCount);
+  _batches->increase(_combineBatchCount);
+  _bytes->increase(_combineInputBytes);
 
   LOG("[CombineHandler] input Record Count: %d, input Bytes: %d, "
-      "output Record Count: %d, output Bytes: %d",
+      "output Record Count: %d, output Bytes: %d, "
+      "load calls: %d, batches: %d, avg batch Bytes: %d",
       _combineInputRecordCount, _combineInputBytes,
-      _combineOutputRecordCount, _combineOutputBytes);
+      _combineOutputRecordCount, _combineOutputBytes,
+      _combineLoadCount, _combineBatchCount,
+      _combineBatchCount > 0 ? _combineInputBytes / _combineBatchCount : 0);
   return;
 }
 
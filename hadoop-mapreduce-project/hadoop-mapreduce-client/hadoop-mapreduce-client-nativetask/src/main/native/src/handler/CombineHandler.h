@@ -35,14 +35,22 @@ struct SerializeInfo {
 };
 
 class CombineHandler : public NativeTask::ICombineRunner, public NativeTask::BatchHandler {
+  friend class TestCombineHandler;
+
 public:
   static const Command COMBINE;
 
+  // JNI round trips of all combines of the task are counters of this group
+  static const char * COUNTER_GROUP;
+  static const char * LOAD_CALLS;
+  static const char * BATCHES;
+  static const char * BYTES;
+
 private:
 
   CombineContext * _combineContext;
   KVIterator * _kvIterator;
-  IFileWriter * _writer;
+  Collector * _writer;
   SerializeInfo _key;
   SerializeInfo _value;
 
@@ -58,6 +66,13 @@ private:
   uint32_t _combineOutputRecordCount;
   uint32_t _combineOutputBytes;
 
+  // JNI round trips of one combine: loads requested by java, batches pushed back
+  uint32_t _combineLoadCount;
+  uint32_t _combineBatchCount;
+  Counter * _loadCalls;
+  Counter * _batches;
+  Counter * _bytes;
+
   FixSizeContainer _asideBuffer;
   ByteArray _asideBytes;
 
@@ -72,12 +87,16 @@ public:
 
   void configure(Config * config);
 
-  void combine(CombineContext type, KVIterator * kvIterator, IFileWriter * writer);
+  void combine(CombineContext type, KVIterator * kvIterator, Collector * writer);
 
   virtual void onLoadData();
 
+protected:
+  virtual void flushOutput();
+
 private:
   void flushDataToWriter();
+  void outputKeyValue(uint32_t kvLength);
   void outputKeyOrValue(SerializeInfo & info, KeyValueType type);
   bool nextKeyValue(SerializeInfo & key, SerializeInfo & value);
   uint32_t feedDataToJava(SerializationFramework serializationType);
@@ -30,7 +30,8 @@ using std::vector;
 namespace NativeTask {
 
 MCollectorOutputHandler::MCollectorOutputHandler()
-    : _collector(NULL), _dest(NULL), _endium(LARGE_ENDIUM) {
+    : _collector(NULL), _dest(NULL), _endium(LARGE_ENDIUM), _sharedBuffer(NULL),
+        _sharedCapacity(0), _sharedBufferSize(0) {
 }
 
 MCollectorOutputHandler::~MCollectorOutputHandler() {
@@ -46,6 +47,12 @@ void MCollectorOutputHandler::configure(Config * config) {
 
   uint32_t partition = config->getInt(MAPRED_NUM_REDUCES, 1);
 
+  // Java writes native order length headers when asked to, saving a bswap
+  // per header for every collected record
+  _endium = config->getBool(NATIVE_COLLECTOR_NATIVE_ENDIAN, false) ? LITTLE_ENDIUM : LARGE_ENDIUM;
+  // shared buffers are as large as the java side buffer would be
+  _sharedBufferSize = (uint32_t)config->getInt(NATIVE_PROCESSOR_BUFFER_KB, 1024) * 1024;
+
   _collector = new MapOutputCollector(partition, this);
   _collector->configure(config);
 }
@@ -67,29 +74,51 @@ void MCollectorOutputHandler::handleInput(ByteBuffer & in) {
   }
 
   while (end - pos > 0) {
-    KVBufferWithParititionId * kvBuffer = (KVBufferWithParititionId *)pos;
+    const KVBufferWithParititionId * kvBuffer = (const KVBufferWithParititionId *)pos;
 
-    if (unlikely(end - pos < KVBuffer::headerLength())) {
+    if (unlikely(end - pos < KVBufferWithParititionId::minLength())) {
       THROW_EXCEPTION(IOException, "k/v meta information incomplete");
     }
 
+    uint32_t partitionId = kvBuffer->partitionId;
+    uint32_t keyLength = kvBuffer->buffer.keyLength;
+    uint32_t valueLength = kvBuffer->buffer.valueLength;
     if (_endium == LARGE_ENDIUM) {
-      kvBuffer->partitionId = bswap(kvBuffer->partitionId);
-      kvBuffer->buffer.keyLength = bswap(kvBuffer->buffer.keyLength);
-      kvBuffer->buffer.valueLength = bswap(kvBuffer->buffer.valueLength);
+      partitionId = bswap(partitionId);
+      keyLength = bswap(keyLength);
+      valueLength = bswap(valueLength);
     }
 
-    uint32_t kvLength = kvBuffer->buffer.length();
-
-    KVBuffer * dest = allocateKVBuffer(kvBuffer->partitionId, kvLength);
-    _kvContainer.wrap((char *)dest, kvLength);
+    // the header is written straight into the bucket, the input buffer is
+    // left untouched, and only the key/value bytes go through the container
+    uint32_t contentLength = keyLength + valueLength;
+    KVBuffer * dest = allocateKVBuffer(partitionId, contentLength + KVBuffer::headerLength());
+    dest->keyLength = keyLength;
+    dest->valueLength = valueLength;
+    _kvContainer.wrap(dest->getKey(), contentLength);
 
-    pos += 4; //skip the partition length
+    pos += KVBufferWithParititionId::minLength();
     uint32_t filledLength = _kvContainer.fill(pos, end - pos);
     pos += filledLength;
   }
 }
 
+char * MCollectorOutputHandler::onSwapSharedBuffer(uint32_t length, uint32_t minLength,
+    uint32_t & capacity) {
+  if (NULL != _sharedBuffer) {
+    char * buffer = _sharedBuffer;
+    _sharedBuffer = NULL;
+    _collector->commitSharedBuffer(buffer, _sharedCapacity, length);
+  }
+  if (0 == minLength) {
+    return NULL;
+  }
+  _sharedBuffer = _collector->allocateSharedBuffer(minLength, _sharedBufferSize,
+      _sharedCapacity);
+  capacity = _sharedCapacity;
+  return _sharedBuffer;
+}
+
 KVBuffer * MCollectorOutputHandler::allocateKVBuffer(uint32_t partitionId, uint32_t kvlength) {
   KVBuffer * dest = _collector->allocateKVBuffer(partitionId, kvlength);
   return dest;
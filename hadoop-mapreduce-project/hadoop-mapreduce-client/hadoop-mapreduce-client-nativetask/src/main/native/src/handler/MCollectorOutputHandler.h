@@ -37,6 +37,11 @@ private:
 
   Endium _endium;
 
+  // shared buffer java is writing to, see onSwapSharedBuffer
+  char * _sharedBuffer;
+  uint32_t _sharedCapacity;
+  uint32_t _sharedBufferSize;
+
 public:
   MCollectorOutputHandler();
   virtual ~MCollectorOutputHandler();
@@ -44,6 +49,12 @@ public:
   virtual void configure(Config * config);
   virtual void finish();
   virtual void handleInput(ByteBuffer & byteBuffer);
+
+  /**
+   * java serializes records into pool memory of the collector, with
+   * native order headers, the records are sorted and spilled in place
+   */
+  virtual char * onSwapSharedBuffer(uint32_t length, uint32_t minLength, uint32_t & capacity);
 private:
   KVBuffer * allocateKVBuffer(uint32_t partition, uint32_t kvlength);
 };
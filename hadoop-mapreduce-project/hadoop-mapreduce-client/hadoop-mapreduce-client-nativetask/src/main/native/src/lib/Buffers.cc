@@ -20,6 +20,7 @@
 
 #include "lib/commons.h"
 #include "util/StringUtil.h"
+#include "util/Timer.h"
 #include "util/WritableUtils.h"
 #include "lib/Buffers.h"
 
@@ -27,7 +28,19 @@ namespace NativeTask {
 
 
 ReadBuffer::ReadBuffer()
-    : _buff(NULL), _remain(0), _size(0), _capacity(0), _stream(NULL), _source(NULL) {
+    : _buff(NULL), _remain(0), _size(0), _capacity(0), _stream(NULL), _source(NULL),
+        _wrapped(false) {
+}
+
+void ReadBuffer::wrap(const char * data, uint32_t length) {
+  if (NULL != _buff && !_wrapped) {
+    THROW_EXCEPTION(IOException, "ReadBuffer already initialized with a stream");
+  }
+  _wrapped = true;
+  _buff = (char *)data;
+  _capacity = length;
+  _remain = length;
+  _size = length;
 }
 
 void ReadBuffer::init(uint32_t size, InputStream * stream, const string & codec) {
@@ -57,7 +70,9 @@ ReadBuffer::~ReadBuffer() {
     _source = NULL;
   }
   if (NULL != _buff) {
-    free(_buff);
+    if (!_wrapped) {
+      free(_buff);
+    }
     _buff = NULL;
     _capacity = 0;
     _remain = 0;
@@ -66,6 +81,9 @@ ReadBuffer::~ReadBuffer() {
 }
 
 char * ReadBuffer::fillGet(uint32_t count) {
+  if (unlikely(_wrapped)) {
+    THROW_EXCEPTION(IOException, "read reach EOF");
+  }
 
   if (unlikely(count > _capacity)) {
     uint32_t newcap = _capacity * 2 > count ? _capacity * 2 : count;
@@ -111,6 +129,9 @@ int32_t ReadBuffer::fillRead(char * buff, uint32_t len) {
     memcpy(buff, current(), cp);
     _remain = 0;
   }
+  if (_wrapped) {
+    return cp > 0 ? (int32_t)cp : -1;
+  }
   // TODO: read to buffer first
   int32_t ret = _source->readFully(buff + cp, len - cp);
   if (ret < 0 && cp == 0) {
@@ -122,6 +143,9 @@ int32_t ReadBuffer::fillRead(char * buff, uint32_t len) {
 
 int64_t ReadBuffer::fillReadVLong() {
   if (_remain == 0) {
+    if (unlikely(_wrapped)) {
+      THROW_EXCEPTION(IOException, "fillReadVLong reach EOF");
+    }
     int32_t rd = _source->read(_buff, _capacity);
     if (rd <= 0) {
       THROW_EXCEPTION(IOException, "fillReadVLong reach EOF");
@@ -149,7 +173,7 @@ int64_t ReadBuffer::fillReadVLong() {
 
 AppendBuffer::AppendBuffer()
     : _buff(NULL), _remain(0), _capacity(0), _counter(0), _stream(NULL), _dest(NULL),
-        _compression(false) {
+        _compression(false), _compressTime(0) {
 }
 
 void AppendBuffer::init(uint32_t size, OutputStream * stream, const string & codec) {
@@ -194,17 +218,26 @@ AppendBuffer::~AppendBuffer() {
   }
 }
 
+void AppendBuffer::writeDest(const void * data, uint32_t len) {
+  if (_compression) {
+    Timer timer;
+    _dest->write(data, len);
+    _compressTime += timer.now() - timer.last();
+  } else {
+    _dest->write(data, len);
+  }
+  _counter += len;
+}
+
 void AppendBuffer::flushd() {
-  _dest->write(_buff, _capacity - _remain);
-  _counter += _capacity - _remain;
+  writeDest(_buff, _capacity - _remain);
   _remain = _capacity;
 }
 
 void AppendBuffer::write_inner(const void * data, uint32_t len) {
   flushd();
   if (len >= _capacity / 2) {
-    _dest->write(data, len);
-    _counter += len;
+    writeDest(data, len);
   } else {
     simple_memcpy(_buff, data, len);
     _remain -= len;
@@ -38,6 +38,8 @@ protected:
 
   InputStream * _stream;
   InputStream * _source;
+  // _buff points into memory owned by the caller, see wrap()
+  bool _wrapped;
 
 protected:
   inline char * current() {
@@ -52,8 +54,19 @@ public:
 
   void init(uint32_t size, InputStream * stream, const string & codec);
 
+  /**
+   * read straight from length bytes at data, e.g. a mapped file, instead
+   * of a stream: pointers returned by get() then point into data, and
+   * reading past its end is an EOF error
+   */
+  void wrap(const char * data, uint32_t length);
+
   ~ReadBuffer();
 
+  uint32_t remain() {
+    return _remain;
+  }
+
   /**
    * use get() to get inplace continuous memory of small object
    */
@@ -132,10 +145,13 @@ protected:
   OutputStream * _stream;
   OutputStream * _dest;
   bool _compression;
+  uint64_t _compressTime;
 
 protected:
   void flushd();
 
+  void writeDest(const void * data, uint32_t len);
+
   inline char * current() {
     return _buff + _capacity - _remain;
   }
@@ -156,6 +172,13 @@ public:
     return _counter;
   }
 
+  /**
+   * nanoseconds spent in the compression stream's write()
+   */
+  uint64_t getCompressTime() {
+    return _compressTime;
+  }
+
   inline char * borrowUnsafe(uint32_t len) {
     if (likely(_remain >= len)) {
       return current();
@@ -60,11 +60,28 @@ public:
   ICombineRunner() {
   }
 
-  virtual void combine(CombineContext type, KVIterator * kvIterator, IFileWriter * writer) = 0;
+  /**
+   * combine the sorted records of kvIterator and collect the output
+   * into writer, an IFileWriter when spilling or merging
+   */
+  virtual void combine(CombineContext type, KVIterator * kvIterator, Collector * writer) = 0;
 
   virtual ~ICombineRunner() {
   }
 };
 
+/**
+ * Base class of combiners implemented in native code, registered with
+ * REGISTER_CLASS and selected by native.combiner.class, e.g.
+ * NativeTask.LongSumCombiner. configure() gets the job config before
+ * the first combine().
+ */
+class NativeCombiner : public ICombineRunner, public Configurable {
+public:
+  virtual NativeObjectType type() {
+    return CombinerType;
+  }
+};
+
 } /* namespace NativeTask */
 #endif /* COMBINER_H_ */
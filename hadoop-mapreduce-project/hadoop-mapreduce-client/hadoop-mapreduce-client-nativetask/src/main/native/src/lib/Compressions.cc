@@ -23,6 +23,8 @@
 #include "codec/GzipCodec.h"
 #include "codec/SnappyCodec.h"
 #include "codec/Lz4Codec.h"
+#include "codec/ZstdCodec.h"
+#include "lib/NativeObjectFactory.h"
 
 namespace NativeTask {
 
@@ -50,9 +52,35 @@ const Compressions::Codec Compressions::SnappyCodec = Compressions::Codec(
     "org.apache.hadoop.io.compress.SnappyCodec", ".snappy");
 const Compressions::Codec Compressions::Lz4Codec = Compressions::Codec(
     "org.apache.hadoop.io.compress.Lz4Codec", ".lz4");
+const Compressions::Codec Compressions::ZstdCodec = Compressions::Codec(
+    "org.apache.hadoop.io.compress.ZStandardCodec", ".zst");
 
 vector<Compressions::Codec> Compressions::SupportedCodecs = vector<Compressions::Codec>();
 
+ThreadPool * Compressions::getBlockCodecPool() {
+  static Lock lock;
+  static ThreadPool * pool = NULL;
+  uint32_t threads = NativeObjectFactory::GetConfig().getInt(NATIVE_COMPRESS_THREADS, 0);
+  if (threads == 0) {
+    return NULL;
+  }
+  ScopeLock<Lock> autolock(lock);
+  if (NULL == pool) {
+    // shared by every stream of the task and never released
+    pool = new ThreadPool(threads);
+  }
+  return pool;
+}
+
+template<typename _Stream>
+static _Stream * EnablePipeline(_Stream * stream) {
+  ThreadPool * pool = Compressions::getBlockCodecPool();
+  if (NULL != pool) {
+    stream->setThreadPool(pool, pool->getThreadCount() * 2);
+  }
+  return stream;
+}
+
 void Compressions::initCodecs() {
   static Lock lock;
   ScopeLock<Lock> autolock(lock);
@@ -60,6 +88,9 @@ void Compressions::initCodecs() {
     SupportedCodecs.push_back(GzipCodec);
     SupportedCodecs.push_back(SnappyCodec);
     SupportedCodecs.push_back(Lz4Codec);
+#if defined HADOOP_ZSTD_LIBRARY
+    SupportedCodecs.push_back(ZstdCodec);
+#endif
   }
 }
 
@@ -112,13 +143,21 @@ CompressStream * Compressions::getCompressionStream(const string & codec, Output
   }
   if (codec == SnappyCodec.name) {
 #if defined HADOOP_SNAPPY_LIBRARY
-    return new SnappyCompressStream(stream, bufferSizeHint);
+    return EnablePipeline(new SnappyCompressStream(stream, bufferSizeHint));
 #else
     THROW_EXCEPTION(UnsupportException, "Snappy library is not loaded");
 #endif
   }
   if (codec == Lz4Codec.name) {
-    return new Lz4CompressStream(stream, bufferSizeHint);
+    return EnablePipeline(new Lz4CompressStream(stream, bufferSizeHint));
+  }
+  if (codec == ZstdCodec.name) {
+#if defined HADOOP_ZSTD_LIBRARY
+    int level = NativeObjectFactory::GetConfig().getInt(ZSTD_COMPRESSION_LEVEL, 3);
+    return new ZstdCompressStream(stream, bufferSizeHint, level);
+#else
+    THROW_EXCEPTION(UnsupportException, "ZStandard library is not loaded");
+#endif
   }
   return NULL;
 }
@@ -130,13 +169,20 @@ DecompressStream * Compressions::getDecompressionStream(const string & codec, In
   }
   if (codec == SnappyCodec.name) {
 #if defined HADOOP_SNAPPY_LIBRARY
-    return new SnappyDecompressStream(stream, bufferSizeHint);
+    return EnablePipeline(new SnappyDecompressStream(stream, bufferSizeHint));
 #else
     THROW_EXCEPTION(UnsupportException, "Snappy library is not loaded");
 #endif
   }
   if (codec == Lz4Codec.name) {
-    return new Lz4DecompressStream(stream, bufferSizeHint);
+    return EnablePipeline(new Lz4DecompressStream(stream, bufferSizeHint));
+  }
+  if (codec == ZstdCodec.name) {
+#if defined HADOOP_ZSTD_LIBRARY
+    return new ZstdDecompressStream(stream, bufferSizeHint);
+#else
+    THROW_EXCEPTION(UnsupportException, "ZStandard library is not loaded");
+#endif
   }
   return NULL;
 }
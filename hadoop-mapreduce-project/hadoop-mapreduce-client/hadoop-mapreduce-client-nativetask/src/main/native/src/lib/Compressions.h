@@ -28,6 +28,8 @@ namespace NativeTask {
 using std::vector;
 using std::string;
 
+class ThreadPool;
+
 class CompressStream : public FilterOutputStream {
 public:
   CompressStream(OutputStream * stream)
@@ -86,6 +88,7 @@ public:
   static const Codec GzipCodec;
   static const Codec SnappyCodec;
   static const Codec Lz4Codec;
+  static const Codec ZstdCodec;
 
 public:
   static bool support(const string & codec);
@@ -101,6 +104,13 @@ public:
 
   static DecompressStream * getDecompressionStream(const string & codec, InputStream * stream,
       uint32_t bufferSizeHint);
+
+  /**
+   * Pool shared by all block codec streams for pipelined compression
+   * and read ahead decompression, NULL unless native.compress.threads
+   * is positive
+   */
+  static ThreadPool * getBlockCodecPool();
 };
 
 } // namespace NativeTask
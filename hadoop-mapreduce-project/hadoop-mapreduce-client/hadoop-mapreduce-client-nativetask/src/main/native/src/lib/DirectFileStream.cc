@@ -0,0 +1,280 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "lib/TaskCounters.h"
+#include "lib/NativeObjectFactory.h"
+#include "lib/DirectFileStream.h"
+
+namespace NativeTask {
+
+static const uint32_t DIRECT_IO_ALIGNMENT = 4096;
+static const uint32_t DIRECT_IO_BUFFER_SIZE = DirectFileOutputStream::BUFFER_SIZE;
+static const uint32_t WRITE_BEHIND_THREADS = 2;
+
+const uint32_t DirectFileOutputStream::BUFFER_SIZE;
+const uint32_t DirectFileOutputStream::MAX_BUFFERS;
+
+class WriteBehindTask : public AsyncTask {
+public:
+  int fd;
+  bool direct;
+  const char * buffer;
+  uint32_t length;
+  uint64_t offset;
+
+  WriteBehindTask(int fd, bool direct)
+      : fd(fd), direct(direct), buffer(NULL), length(0), offset(0) {
+  }
+
+protected:
+  virtual void execute() {
+    uint32_t written = 0;
+    while (written < length) {
+      ssize_t ret = ::pwrite(fd, buffer + written, length - written, offset + written);
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        THROW_EXCEPTION_EX(IOException, "pwrite failed: %s", strerror(errno));
+      }
+      written += ret;
+    }
+#ifdef __linux__
+    if (!direct) {
+      // push the chunk to disk now and drop it from the page cache
+      ::sync_file_range(fd, offset, length,
+          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+      ::posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+    }
+#endif
+  }
+};
+
+/**
+ * Aligned buffers of DIRECT_IO_BUFFER_SIZE, at most MAX_BUFFERS are
+ * allocated and released ones are kept for reuse. Spares are only
+ * handed out while half of the buffers stay available, so up to
+ * MAX_BUFFERS / 2 streams get their first buffer without waiting.
+ */
+class AlignedBufferPool {
+private:
+  Lock _lock;
+  Condition _released;
+  vector<char *> _free;
+  uint32_t _allocated;
+
+public:
+  AlignedBufferPool()
+      : _released(_lock), _allocated(0) {
+  }
+
+  /**
+   * @param spare return NULL rather than leave fewer than half of the
+   *              buffers available, otherwise block until a buffer is
+   *              released if all are in use
+   */
+  char * acquire(bool spare) {
+    ScopeLock<Lock> autolock(_lock);
+    if (spare) {
+      uint32_t available = _free.size() + DirectFileOutputStream::MAX_BUFFERS - _allocated;
+      if (available <= DirectFileOutputStream::MAX_BUFFERS / 2) {
+        return NULL;
+      }
+    }
+    while (_free.empty() && _allocated >= DirectFileOutputStream::MAX_BUFFERS) {
+      _released.wait();
+    }
+    if (!_free.empty()) {
+      char * ret = _free.back();
+      _free.pop_back();
+      return ret;
+    }
+    void * ret = NULL;
+    if (0 != posix_memalign(&ret, DIRECT_IO_ALIGNMENT, DIRECT_IO_BUFFER_SIZE)) {
+      THROW_EXCEPTION_EX(OutOfMemoryException, "posix_memalign %u bytes failed",
+          DIRECT_IO_BUFFER_SIZE);
+    }
+    _allocated++;
+    return (char *)ret;
+  }
+
+  void release(char * buffer) {
+    if (NULL != buffer) {
+      ScopeLock<Lock> autolock(_lock);
+      _free.push_back(buffer);
+      _released.signal();
+    }
+  }
+};
+
+// shared by all streams, kept until the process exits
+static Lock SharedLock;
+static AlignedBufferPool * SharedBuffers = NULL;
+static ThreadPool * SharedWriteBehind = NULL;
+
+static AlignedBufferPool * GetSharedBuffers() {
+  ScopeLock<Lock> autolock(SharedLock);
+  if (NULL == SharedBuffers) {
+    SharedBuffers = new AlignedBufferPool();
+  }
+  return SharedBuffers;
+}
+
+static ThreadPool * GetSharedWriteBehind() {
+  ScopeLock<Lock> autolock(SharedLock);
+  if (NULL == SharedWriteBehind) {
+    SharedWriteBehind = new ThreadPool(WRITE_BEHIND_THREADS);
+  }
+  return SharedWriteBehind;
+}
+
+DirectFileOutputStream::DirectFileOutputStream(const string & path, bool overwrite)
+    : _path(path), _fd(-1), _direct(false), _current(NULL), _spare(NULL), _length(0),
+        _offset(0), _pending(NULL), _writing(false) {
+  int flags = 0;
+  if (overwrite) {
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+  } else {
+    flags = O_WRONLY | O_CREAT | O_EXCL;
+  }
+  mode_t mask = umask(0);
+  umask(mask);
+#ifdef O_DIRECT
+  _fd = ::open(path.c_str(), flags | O_DIRECT, (0666 & ~mask));
+  _direct = _fd >= 0;
+  if (_fd < 0 && errno == EINVAL) {
+    // tmpfs and some others don't support O_DIRECT, the failed open may
+    // have created the file already, so don't insist on creating it
+    _fd = ::open(path.c_str(), flags & ~O_EXCL, (0666 & ~mask));
+  }
+#else
+  _fd = ::open(path.c_str(), flags, (0666 & ~mask));
+#endif
+  if (_fd < 0) {
+    THROW_EXCEPTION_EX(IOException, "Can't open file for write: [%s]", path.c_str());
+  }
+  _current = GetSharedBuffers()->acquire(false);
+  _spare = GetSharedBuffers()->acquire(true);
+  _pending = new WriteBehindTask(_fd, _direct);
+  _bytesWrite = NativeObjectFactory::GetCounter(TaskCounters::FILESYSTEM_COUNTER_GROUP,
+      TaskCounters::FILE_BYTES_WRITTEN);
+}
+
+DirectFileOutputStream::~DirectFileOutputStream() {
+  try {
+    close();
+  } catch (std::exception & e) {
+    LOG("DirectFileOutputStream: close %s failed: %s", _path.c_str(), e.what());
+  }
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+  // close() waited for the in-flight write, also if it failed
+  delete _pending;
+  GetSharedBuffers()->release(_current);
+  GetSharedBuffers()->release(_spare);
+}
+
+uint64_t DirectFileOutputStream::tell() {
+  return _offset + _length;
+}
+
+void DirectFileOutputStream::write(const void * buff, uint32_t length) {
+  if (_fd < 0) {
+    THROW_EXCEPTION(IOException, "write to closed stream");
+  }
+  const char * src = (const char *)buff;
+  uint32_t remain = length;
+  while (remain > 0) {
+    uint32_t toCopy = std::min(remain, DIRECT_IO_BUFFER_SIZE - _length);
+    simple_memcpy(_current + _length, src, toCopy);
+    _length += toCopy;
+    src += toCopy;
+    remain -= toCopy;
+    if (_length == DIRECT_IO_BUFFER_SIZE) {
+      submit(_length);
+    }
+  }
+  _bytesWrite->increase(length);
+}
+
+void DirectFileOutputStream::preallocate(uint64_t length) {
+#ifdef __linux__
+  if (_fd >= 0 && length > 0) {
+    // best effort, the file system may not support it
+    ::fallocate(_fd, FALLOC_FL_KEEP_SIZE, 0, length);
+  }
+#endif
+}
+
+void DirectFileOutputStream::flush() {
+}
+
+void DirectFileOutputStream::close() {
+  if (_fd < 0) {
+    return;
+  }
+  if (_length > 0) {
+    uint32_t ioLength = _length;
+    if (_direct) {
+      ioLength = (_length + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+      memset(_current + _length, 0, ioLength - _length);
+    }
+    submit(ioLength);
+  }
+  waitPending();
+  // cut the padding and blocks preallocated beyond the real length
+  if (0 != ::ftruncate(_fd, _offset)) {
+    THROW_EXCEPTION_EX(IOException, "ftruncate %s failed: %s", _path.c_str(), strerror(errno));
+  }
+  ::close(_fd);
+  _fd = -1;
+}
+
+void DirectFileOutputStream::submit(uint32_t ioLength) {
+  waitPending();
+  _pending->reset();
+  _pending->buffer = _current;
+  _pending->length = ioLength;
+  _pending->offset = _offset;
+  if (NULL == _spare) {
+    // no buffer to fill meanwhile, write in place
+    _pending->run();
+    _pending->waitFinish();
+  } else {
+    std::swap(_current, _spare);
+    GetSharedWriteBehind()->submit(_pending);
+    _writing = true;
+  }
+  _offset += _length;
+  _length = 0;
+}
+
+void DirectFileOutputStream::waitPending() {
+  if (_writing) {
+    _writing = false;
+    _pending->waitFinish();
+  }
+}
+
+} // namespace NativeTask
@@ -0,0 +1,98 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DIRECTFILESTREAM_H_
+#define DIRECTFILESTREAM_H_
+
+#include "lib/Streams.h"
+#include "util/SyncUtils.h"
+
+namespace NativeTask {
+
+class Counter;
+class WriteBehindTask;
+
+/**
+ * Spill file writer that keeps map output out of the page cache, so
+ * it does not evict the map outputs the shuffle handler is serving.
+ * The file is opened with O_DIRECT when the file system supports it;
+ * otherwise every chunk is flushed with sync_file_range and dropped
+ * from the cache. Data is staged in aligned buffers taken from a pool
+ * of MAX_BUFFERS shared by all streams of the process, and written
+ * behind on io threads shared as well, at most one chunk in flight.
+ * A stream waits for its first buffer if the pool is exhausted, so a
+ * thread must not keep more than MAX_BUFFERS / 2 streams open at once;
+ * it writes synchronously if it gets no second buffer.
+ */
+class DirectFileOutputStream : public OutputStream {
+public:
+  static const uint32_t BUFFER_SIZE = 1024 * 1024;
+  static const uint32_t MAX_BUFFERS = 32;
+
+private:
+  string _path;
+  int _fd;
+  bool _direct;
+  char * _current;
+  // NULL if the shared pool had no buffer left
+  char * _spare;
+  uint32_t _length;
+  uint64_t _offset;
+  WriteBehindTask * _pending;
+  bool _writing;
+  Counter * _bytesWrite;
+
+public:
+  DirectFileOutputStream(const string & path, bool overwrite = true);
+
+  virtual ~DirectFileOutputStream();
+
+  virtual uint64_t tell();
+
+  virtual void write(const void * buff, uint32_t length);
+
+  virtual void preallocate(uint64_t length);
+
+  virtual void flush();
+
+  virtual void close();
+
+  /**
+   * @return false if the file system refused O_DIRECT and the
+   *         stream fell back to buffered writes
+   */
+  bool isDirect() const {
+    return _direct;
+  }
+
+private:
+  /**
+   * write the current buffer behind
+   * @param ioLength bytes to write, may include the padding of the tail
+   */
+  void submit(uint32_t ioLength);
+
+  /**
+   * wait for the in-flight write, if any
+   */
+  void waitPending();
+};
+
+} // namespace NativeTask
+
+#endif /* DIRECTFILESTREAM_H_ */
@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "lib/commons.h"
 #include "util/StringUtil.h"
 #include "lib/jniutils.h"
@@ -28,6 +29,7 @@
 #include "lib/NativeObjectFactory.h"
 #include "lib/Path.h"
 #include "lib/FileSystem.h"
+#include "lib/DirectFileStream.h"
 
 namespace NativeTask {
 
@@ -45,6 +47,59 @@ FileInputStream::FileInputStream(const string & path) {
       TaskCounters::FILE_BYTES_READ);
 }
 
+MappedFile::MappedFile(const string & path)
+    : _path(path), _data(NULL), _length(0), _bytesRead(NULL) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    THROW_EXCEPTION_EX(IOException, "Can't open file for read: [%s]", path.c_str());
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    THROW_EXCEPTION_EX(IOException, "stat path %s failed, %s", path.c_str(), strerror(errno));
+  }
+  _length = (uint64_t)st.st_size;
+  if (_length > 0) {
+    void * data = ::mmap(NULL, _length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == data) {
+      ::close(fd);
+      THROW_EXCEPTION_EX(IOException, "mmap %s failed, %s", path.c_str(), strerror(errno));
+    }
+    _data = (char *)data;
+  }
+  ::close(fd);
+  _bytesRead = NativeObjectFactory::GetCounter(TaskCounters::FILESYSTEM_COUNTER_GROUP,
+      TaskCounters::FILE_BYTES_READ);
+}
+
+MappedFile::~MappedFile() {
+  if (NULL != _data) {
+    ::munmap(_data, _length);
+    _data = NULL;
+  }
+}
+
+void MappedFile::adviseSequential() {
+  if (NULL != _data) {
+    ::madvise(_data, _length, MADV_SEQUENTIAL);
+  }
+}
+
+void MappedFile::release(uint64_t offset, uint64_t length) {
+  const uint64_t pageSize = (uint64_t)::sysconf(_SC_PAGESIZE);
+  uint64_t end = std::min(offset + length, _length) & ~(pageSize - 1);
+  uint64_t start = (offset + pageSize - 1) & ~(pageSize - 1);
+  if (NULL != _data && start < end) {
+    ::madvise(_data + start, end - start, MADV_DONTNEED);
+  }
+}
+
+void MappedFile::countRead(uint64_t length) {
+  if (NULL != _bytesRead) {
+    _bytesRead->increase(length);
+  }
+}
+
 FileInputStream::~FileInputStream() {
   close();
 }
@@ -130,6 +185,15 @@ class RawFileSystem : public FileSystem {
     return path;
   }
 
+  void mkdirsForFile(const string & np) {
+    string parent = Path::GetParent(np);
+    if (parent.length() > 0) {
+      if (!exists(parent)) {
+        mkdirs(parent);
+      }
+    }
+  }
+
  public:
   InputStream * open(const string & path) {
     return new FileInputStream(getRealPath(path));
@@ -137,15 +201,16 @@ class RawFileSystem : public FileSystem {
 
   OutputStream * create(const string & path, bool overwrite) {
     string np = getRealPath(path);
-    string parent = Path::GetParent(np);
-    if (parent.length() > 0) {
-      if (!exists(parent)) {
-        mkdirs(parent);
-      }
-    }
+    mkdirsForFile(np);
     return new FileOutputStream(np, overwrite);
   }
 
+  OutputStream * createDirect(const string & path, bool overwrite) {
+    string np = getRealPath(path);
+    mkdirsForFile(np);
+    return new DirectFileOutputStream(np, overwrite);
+  }
+
   uint64_t getLength(const string & path) {
     struct stat st;
     if (::stat(getRealPath(path).c_str(), &st) != 0) {
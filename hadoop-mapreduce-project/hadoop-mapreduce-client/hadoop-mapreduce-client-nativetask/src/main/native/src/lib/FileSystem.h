@@ -49,6 +49,45 @@ public:
   virtual void close();
 };
 
+/**
+ * Local file mapped read only as a whole, so readers can use the
+ * data in place instead of copying it through an InputStream
+ */
+class MappedFile {
+private:
+  string _path;
+  char * _data;
+  uint64_t _length;
+  Counter * _bytesRead;
+public:
+  MappedFile(const string & path);
+  ~MappedFile();
+
+  const char * data() {
+    return _data;
+  }
+
+  uint64_t length() {
+    return _length;
+  }
+
+  /**
+   * hint the kernel to read ahead aggressively, the file is read in order
+   */
+  void adviseSequential();
+
+  /**
+   * drop the pages of a range already consumed, offset and length
+   * are rounded inwards to page boundaries
+   */
+  void release(uint64_t offset, uint64_t length);
+
+  /**
+   * account bytes consumed from the mapping to FILE_BYTES_READ
+   */
+  void countRead(uint64_t length);
+};
+
 /**
  * Local raw filesystem file output stream
  * with blocking semantics
@@ -97,6 +136,14 @@ public:
     return NULL;
   }
 
+  /**
+   * like create, but the data written bypasses the page cache where the
+   * file system supports it
+   */
+  virtual OutputStream * createDirect(const string & path, bool overwrite = true) {
+    return create(path, overwrite);
+  }
+
   virtual uint64_t getLength(const string & path) {
     return 0;
   }
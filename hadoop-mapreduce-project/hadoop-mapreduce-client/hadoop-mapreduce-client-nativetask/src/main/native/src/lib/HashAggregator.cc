@@ -0,0 +1,233 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "lib/HashAggregator.h"
+
+namespace NativeTask {
+
+static const uint32_t MIN_TABLE_SIZE = 1024;
+
+static inline uint32_t HashKey(const char * key, uint32_t length, uint32_t partition) {
+  const uint64_t M = 0x9e3779b97f4a7c15ULL;
+  uint64_t h = ((uint64_t)length << 32 | partition) * M;
+  while (length >= 8) {
+    uint64_t v;
+    memcpy(&v, key, 8);
+    h = (h ^ v) * M;
+    h ^= h >> 29;
+    key += 8;
+    length -= 8;
+  }
+  if (length > 0) {
+    uint64_t v = 0;
+    memcpy(&v, key, length);
+    h = (h ^ v) * M;
+  }
+  h ^= h >> 32;
+  return (uint32_t)h;
+}
+
+/**
+ * orders entries by partition, then by key
+ */
+class HashAggregator::EntryLessThan {
+private:
+  HashAggregator * _aggregator;
+public:
+  EntryLessThan(HashAggregator * aggregator)
+      : _aggregator(aggregator) {
+  }
+
+  inline bool operator()(const Entry * lhs, const Entry * rhs) {
+    if (lhs->partition != rhs->partition) {
+      return lhs->partition < rhs->partition;
+    }
+    KVBuffer * left = _aggregator->getKVBuffer(lhs->head);
+    KVBuffer * right = _aggregator->getKVBuffer(rhs->head);
+    return _aggregator->_keyComparator(left->content, left->keyLength, right->content,
+        right->keyLength) < 0;
+  }
+};
+
+/**
+ * iterates the records of one partition, key by key
+ */
+class HashAggregator::GroupIterator : public KVIterator {
+private:
+  HashAggregator * _aggregator;
+  Entry ** _current;
+  Entry ** _end;
+  uint32_t _record;
+public:
+  GroupIterator(HashAggregator * aggregator, Entry ** begin, Entry ** end)
+      : _aggregator(aggregator), _current(begin), _end(end),
+          _record(begin < end ? (*begin)->head : NO_RECORD) {
+  }
+
+  virtual bool next(Buffer & key, Buffer & value) {
+    if (_record == NO_RECORD) {
+      if (_current == _end || ++_current == _end) {
+        return false;
+      }
+      _record = (*_current)->head;
+    }
+    KVBuffer * kv = _aggregator->getKVBuffer(_record);
+    key.reset(kv->getKey(), kv->keyLength);
+    value.reset(kv->getValue(), kv->valueLength);
+    _record = _aggregator->getRecord(_record)->next;
+    return true;
+  }
+};
+
+/**
+ * appends the combiner output of one partition
+ */
+class HashAggregator::OutputCollector : public Collector {
+private:
+  std::string & _output;
+  uint32_t _partition;
+public:
+  OutputCollector(std::string & output, uint32_t partition)
+      : _output(output), _partition(partition) {
+  }
+
+  virtual void collect(const void * key, uint32_t keyLen, const void * value,
+      uint32_t valueLen) {
+    uint32_t header[3] = {_partition, keyLen, valueLen};
+    _output.append((const char *)header, sizeof(header));
+    _output.append((const char *)key, keyLen);
+    _output.append((const char *)value, valueLen);
+  }
+};
+
+HashAggregator::HashAggregator(uint64_t memory, ComparatorPtr comparator,
+    ICombineRunner * combiner)
+    : _arena(NULL), _arenaSize(0), _arenaUsed(0), _table(NULL), _tableMask(0), _entryCount(0),
+        _maxEntries(0), _pending(NO_RECORD), _pendingPartition(0), _keyComparator(comparator), _combiner(combiner), _recordCount(0), _flushCount(0) {
+  memory = std::min(memory, (uint64_t)UINT32_MAX);
+  // a quarter for the table, load factor at most 1/2
+  uint32_t tableSize = MIN_TABLE_SIZE;
+  while ((uint64_t)tableSize * 2 * sizeof(Entry) <= memory / 4) {
+    tableSize *= 2;
+  }
+  _tableMask = tableSize - 1;
+  _maxEntries = tableSize / 2;
+  _arenaSize = (uint32_t)(memory - std::min(memory, (uint64_t)tableSize * sizeof(Entry)));
+  _table = (Entry *)malloc(tableSize * sizeof(Entry));
+  _arena = (char *)malloc(_arenaSize);
+  if (NULL == _table || NULL == _arena) {
+    free(_table);
+    free(_arena);
+    THROW_EXCEPTION(OutOfMemoryException, "Not enough memory for hash aggregation");
+  }
+  memset(_table, 0xff, tableSize * sizeof(Entry));
+}
+
+HashAggregator::~HashAggregator() {
+  free(_table);
+  free(_arena);
+}
+
+KVBuffer * HashAggregator::allocateKVBuffer(uint32_t partition, uint32_t length) {
+  commitPending();
+  const uint32_t recordLength = sizeof(Record) + length;
+  if (_entryCount >= _maxEntries || recordLength > _arenaSize - _arenaUsed) {
+    return NULL;
+  }
+  _pending = _arenaUsed;
+  _pendingPartition = partition;
+  _arenaUsed += recordLength;
+  getRecord(_pending)->next = NO_RECORD;
+  _recordCount++;
+  return getKVBuffer(_pending);
+}
+
+void HashAggregator::commitPending() {
+  if (_pending == NO_RECORD) {
+    return;
+  }
+  const uint32_t offset = _pending;
+  _pending = NO_RECORD;
+  KVBuffer * kv = getKVBuffer(offset);
+  const uint32_t hash = HashKey(kv->content, kv->keyLength, _pendingPartition);
+  uint32_t slot = hash & _tableMask;
+  while (true) {
+    Entry & entry = _table[slot];
+    if (entry.head == NO_RECORD) {
+      entry.hash = hash;
+      entry.partition = _pendingPartition;
+      entry.head = offset;
+      entry.tail = offset;
+      _entryCount++;
+      return;
+    }
+    if (entry.hash == hash && entry.partition == _pendingPartition) {
+      KVBuffer * other = getKVBuffer(entry.head);
+      if (other->keyLength == kv->keyLength
+          && 0 == memcmp(other->content, kv->content, kv->keyLength)) {
+        getRecord(entry.tail)->next = offset;
+        entry.tail = offset;
+        return;
+      }
+    }
+    slot = (slot + 1) & _tableMask;
+  }
+}
+
+void HashAggregator::flush(std::string & output) {
+  commitPending();
+  if (_entryCount == 0) {
+    return;
+  }
+  std::vector<Entry *> entries;
+  entries.reserve(_entryCount);
+  for (uint32_t i = 0; i <= _tableMask; i++) {
+    if (_table[i].head != NO_RECORD) {
+      entries.push_back(&_table[i]);
+    }
+  }
+  std::sort(entries.begin(), entries.end(), EntryLessThan(this));
+
+  size_t start = 0;
+  while (start < entries.size()) {
+    const uint32_t partition = entries[start]->partition;
+    size_t end = start + 1;
+    while (end < entries.size() && entries[end]->partition == partition) {
+      end++;
+    }
+    GroupIterator iterator(this, &entries[start], &entries[0] + end);
+    OutputCollector collector(output, partition);
+    _combiner->combine(CombineContext(UNKNOWN), &iterator, &collector);
+    start = end;
+  }
+  _flushCount++;
+  reset();
+}
+
+void HashAggregator::reset() {
+  memset(_table, 0xff, (_tableMask + 1) * sizeof(Entry));
+  _entryCount = 0;
+  _arenaUsed = 0;
+  _pending = NO_RECORD;
+}
+
+} // namespace NativeTask
@@ -0,0 +1,130 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HASHAGGREGATOR_H_
+#define HASHAGGREGATOR_H_
+
+#include "NativeTask.h"
+#include "lib/Buffers.h"
+#include "lib/Combiner.h"
+#include "lib/KeyComparators.h"
+
+namespace NativeTask {
+
+/**
+ * Groups map output records by partition and serialized key in an
+ * open addressing hash table before they reach the sort buffer.
+ *
+ * Records are appended to an arena and chained per distinct key. When
+ * the arena or the table is full, flush() sorts the distinct keys of
+ * each partition and runs the combiner over them, so only the combiner
+ * output has to be collected into the sort buffer.
+ */
+class HashAggregator {
+public:
+  static const uint32_t NO_RECORD = 0xffffffff;
+
+private:
+  struct Entry {
+    uint32_t hash;
+    uint32_t partition;
+    // arena offsets of the first and last record of this key
+    uint32_t head;
+    uint32_t tail;
+  };
+
+  // arena record header, followed by a KVBuffer
+  struct Record {
+    uint32_t next;
+  };
+
+  class EntryLessThan;
+  class GroupIterator;
+  class OutputCollector;
+
+  char * _arena;
+  uint32_t _arenaSize;
+  uint32_t _arenaUsed;
+  Entry * _table;
+  uint32_t _tableMask;
+  uint32_t _entryCount;
+  uint32_t _maxEntries;
+
+  // allocated record, indexed once it is filled
+  uint32_t _pending;
+  uint32_t _pendingPartition;
+
+  KeyComparator _keyComparator;
+  ICombineRunner * _combiner;
+
+  uint64_t _recordCount;
+  uint64_t _flushCount;
+
+public:
+  /**
+   * @param memory bytes for the arena and the hash table, less than 4GB
+   */
+  HashAggregator(uint64_t memory, ComparatorPtr comparator, ICombineRunner * combiner);
+
+  ~HashAggregator();
+
+  /**
+   * allocate space for one record, it must be filled before the next
+   * call of allocateKVBuffer() or flush()
+   * @return NULL if full, flush() and try again; still NULL if the
+   *         record does not fit into an empty aggregator
+   */
+  KVBuffer * allocateKVBuffer(uint32_t partition, uint32_t length);
+
+  bool empty() const {
+    return _arenaUsed == 0 && _pending == NO_RECORD;
+  }
+
+  uint64_t getRecordCount() const {
+    return _recordCount;
+  }
+
+  uint64_t getFlushCount() const {
+    return _flushCount;
+  }
+
+  /**
+   * run the combiner over all records, grouped by key in key order for
+   * each partition, then empty the aggregator
+   * @param output combiner output appended as KVBufferWithParititionId
+   *               records in host byte order, ordered by partition
+   */
+  void flush(std::string & output);
+
+private:
+  void commitPending();
+
+  Record * getRecord(uint32_t offset) {
+    return (Record *)(_arena + offset);
+  }
+
+  KVBuffer * getKVBuffer(uint32_t offset) {
+    return (KVBuffer *)(_arena + offset + sizeof(Record));
+  }
+
+  void reset();
+};
+
+} // namespace NativeTask
+
+#endif /* HASHAGGREGATOR_H_ */
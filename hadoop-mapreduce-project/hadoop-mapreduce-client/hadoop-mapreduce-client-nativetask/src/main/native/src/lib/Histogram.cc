@@ -0,0 +1,63 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "lib/NativeObjectFactory.h"
+#include "lib/Histogram.h"
+
+namespace NativeTask {
+
+Histogram::Histogram(const string & group, const string & name, const uint64_t * bounds,
+    uint32_t numBounds)
+    : _group(group), _name(name), _bounds(bounds, bounds + numBounds),
+        _buckets(numBounds + 1, (Counter *)NULL), _count(NULL), _sum(NULL) {
+}
+
+void Histogram::add(uint64_t value) {
+  uint32_t index = std::lower_bound(_bounds.begin(), _bounds.end(), value) - _bounds.begin();
+  ScopeLock<Lock> autolock(_lock);
+  if (NULL == _count) {
+    _count = NativeObjectFactory::GetCounter(_group, _name + "_COUNT");
+    _sum = NativeObjectFactory::GetCounter(_group, _name + "_SUM");
+  }
+  if (NULL == _buckets[index]) {
+    string bucket = index < _bounds.size() ? "_LE_" + FormatBound(_bounds[index])
+        : "_GT_" + FormatBound(_bounds.back());
+    _buckets[index] = NativeObjectFactory::GetCounter(_group, _name + bucket);
+  }
+  _buckets[index]->increase();
+  _count->increase();
+  _sum->increase(value);
+}
+
+string Histogram::FormatBound(uint64_t bound) {
+  const char * UNITS = "KMGT";
+  uint32_t unit = 0;
+  while (bound >= 1024 && bound % 1024 == 0 && unit < 4) {
+    bound /= 1024;
+    unit++;
+  }
+  string ret = StringUtil::ToString(bound);
+  if (unit > 0) {
+    ret.append(1, UNITS[unit - 1]);
+  }
+  return ret;
+}
+
+} // namespace NativeTask
@@ -0,0 +1,67 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include "util/SyncUtils.h"
+
+namespace NativeTask {
+
+class Counter;
+
+/**
+ * Histogram exported as task counters of one group, so it reaches the
+ * job counters with the regular status updates:
+ *   <name>_COUNT, <name>_SUM   number and sum of the values
+ *   <name>_LE_<bound>          values up to bound, above the previous one
+ *   <name>_GT_<bound>          values above the last bound
+ * Counters are created on first use, so unused buckets don't count
+ * against the job's counter limit.
+ */
+class Histogram {
+private:
+  string _group;
+  string _name;
+  vector<uint64_t> _bounds;
+  vector<Counter *> _buckets;
+  Counter * _count;
+  Counter * _sum;
+  Lock _lock;
+
+public:
+  /**
+   * @param bounds ascending upper bounds of the buckets
+   */
+  Histogram(const string & group, const string & name, const uint64_t * bounds,
+      uint32_t numBounds);
+
+  /**
+   * safe to call from any thread
+   */
+  void add(uint64_t value);
+
+  /**
+   * @return bound as used in counter names, e.g. 4096 -> 4K
+   */
+  static string FormatBound(uint64_t bound);
+};
+
+} // namespace NativeTask
+
+#endif /* HISTOGRAM_H_ */
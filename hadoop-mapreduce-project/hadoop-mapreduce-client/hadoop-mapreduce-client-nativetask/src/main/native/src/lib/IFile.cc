@@ -18,6 +18,7 @@
 
 #include "lib/commons.h"
 #include "util/StringUtil.h"
+#include "util/Timer.h"
 #include "lib/IFile.h"
 #include "lib/Compressions.h"
 #include "lib/FileSystem.h"
@@ -26,20 +27,67 @@ namespace NativeTask {
 
 ///////////////////////////////////////////////////////////
 
-IFileReader::IFileReader(InputStream * stream, SingleSpillInfo * spill, bool deleteInputStream)
-    :  _stream(stream), _source(NULL), _checksumType(spill->checkSumType), _kType(spill->keyType),
-        _vType(spill->valueType), _codec(spill->codec), _segmentIndex(-1), _spillInfo(spill),
-        _valuePos(NULL), _valueLen(0), _deleteSourceStream(deleteInputStream) {
+IFileReader::IFileReader(InputStream * stream, SingleSpillInfo * spill, bool deleteInputStream,
+    uint32_t startPartition, uint32_t endPartition)
+    :  _stream(stream), _source(NULL), _mapped(NULL), _segmentStart(0), _segmentLength(0),
+        _checksumType(spill->checkSumType), _kType(spill->keyType),
+        _vType(spill->valueType), _codec(spill->codec), _segmentIndex(-1), _startSegment(0),
+        _endSegment(0), _spillInfo(spill), _valuePos(NULL), _valueLen(0),
+        _deleteSourceStream(deleteInputStream) {
+  _endSegment = (int32_t)std::min(endPartition, spill->length);
+  _startSegment = (int32_t)std::min(startPartition, (uint32_t)_endSegment);
+  _segmentIndex = _startSegment - 1;
+  if (_startSegment > 0) {
+    _stream->seek(spill->segments[_startSegment - 1].realEndOffset);
+  }
   _source = new ChecksumInputStream(_stream, _checksumType);
   _source->setLimit(0);
   _reader.init(128 * 1024, _source, _codec);
 }
 
+IFileReader::IFileReader(MappedFile * mapped, SingleSpillInfo * spill, uint32_t startPartition,
+    uint32_t endPartition)
+    :  _stream(NULL), _source(NULL), _mapped(mapped), _segmentStart(0), _segmentLength(0),
+        _checksumType(spill->checkSumType), _kType(spill->keyType),
+        _vType(spill->valueType), _codec(spill->codec), _segmentIndex(-1), _startSegment(0),
+        _endSegment(0), _spillInfo(spill), _valuePos(NULL), _valueLen(0),
+        _deleteSourceStream(false) {
+  if (!canMap(spill, startPartition, endPartition)) {
+    delete _mapped;
+    _mapped = NULL;
+    THROW_EXCEPTION_EX(UnsupportException, "spill %s can not be read mapped",
+        spill->path.c_str());
+  }
+  _endSegment = (int32_t)std::min(endPartition, spill->length);
+  _startSegment = (int32_t)std::min(startPartition, (uint32_t)_endSegment);
+  _segmentIndex = _startSegment - 1;
+  _mapped->adviseSequential();
+  _reader.wrap(NULL, 0);
+}
+
+bool IFileReader::canMap(SingleSpillInfo * spill, uint32_t startPartition,
+    uint32_t endPartition) {
+  if (spill->codec.length() > 0) {
+    return false;
+  }
+  uint32_t end = std::min(endPartition, spill->length);
+  for (uint32_t i = std::min(startPartition, end); i < end; i++) {
+    uint64_t start = i > 0 ? spill->segments[i - 1].realEndOffset : 0;
+    if (spill->segments[i].realEndOffset - start > UINT32_MAX) {
+      return false;
+    }
+  }
+  return true;
+}
+
 IFileReader::~IFileReader() {
 
   delete _source;
   _source = NULL;
 
+  delete _mapped;
+  _mapped = NULL;
+
   if (_deleteSourceStream) {
     delete _stream;
     _stream = NULL;
@@ -51,10 +99,13 @@ IFileReader::~IFileReader() {
  * 1 if end
  */
 bool IFileReader::nextPartition() {
+  if (NULL != _mapped) {
+    return nextMappedPartition();
+  }
   if (0 != _source->getLimit()) {
     THROW_EXCEPTION(IOException, "bad ifile segment length");
   }
-  if (_segmentIndex >= 0) {
+  if (_segmentIndex >= _startSegment) {
     // verify checksum
     uint32_t chsum = 0;
     if (4 != _stream->readFully(&chsum, 4)) {
@@ -68,7 +119,7 @@ bool IFileReader::nextPartition() {
     }
   }
   _segmentIndex++;
-  if (_segmentIndex < (int)(_spillInfo->length)) {
+  if (_segmentIndex < _endSegment) {
     int64_t end_pos = (int64_t)_spillInfo->segments[_segmentIndex].realEndOffset;
     if (_segmentIndex > 0) {
       end_pos -= (int64_t)_spillInfo->segments[_segmentIndex - 1].realEndOffset;
@@ -85,6 +136,40 @@ bool IFileReader::nextPartition() {
   }
 }
 
+bool IFileReader::nextMappedPartition() {
+  if (_segmentIndex >= _startSegment) {
+    if (0 != _reader.remain()) {
+      THROW_EXCEPTION(IOException, "bad ifile segment length");
+    }
+    _mapped->release(_segmentStart, _segmentLength);
+  }
+  _segmentIndex++;
+  if (_segmentIndex >= _endSegment) {
+    return false;
+  }
+  uint64_t end = _spillInfo->segments[_segmentIndex].realEndOffset;
+  _segmentStart = _segmentIndex > 0 ? _spillInfo->segments[_segmentIndex - 1].realEndOffset : 0;
+  if (end < _segmentStart + 4 || end > _mapped->length()) {
+    THROW_EXCEPTION(IOException, "bad ifile format");
+  }
+  _segmentLength = end - _segmentStart;
+
+  // the whole segment is at hand, so verify it before handing out any record
+  const char * segment = _mapped->data() + _segmentStart;
+  uint32_t dataLength = (uint32_t)(_segmentLength - 4);
+  uint32_t expect = Checksum::init(_checksumType);
+  Checksum::update(_checksumType, expect, segment, dataLength);
+  expect = Checksum::getValue(_checksumType, expect);
+  uint32_t actual = bswap(*(const uint32_t *)(segment + dataLength));
+  if (actual != expect) {
+    THROW_EXCEPTION_EX(IOException, "read ifile checksum not match, actual %x expect %x", actual,
+        expect);
+  }
+  _mapped->countRead(_segmentLength);
+  _reader.wrap(segment, dataLength);
+  return true;
+}
+
 ///////////////////////////////////////////////////////////
 
 IFileWriter * IFileWriter::create(const std::string & filepath, const MapOutputSpec & spec,
@@ -98,7 +183,8 @@ IFileWriter * IFileWriter::create(const std::string & filepath, const MapOutputS
 IFileWriter::IFileWriter(OutputStream * stream, ChecksumType checksumType, KeyValueType ktype,
     KeyValueType vtype, const string & codec, Counter * counter, bool deleteTargetStream)
     : _stream(stream), _dest(NULL), _checksumType(checksumType), _kType(ktype), _vType(vtype),
-        _codec(codec), _recordCounter(counter), _recordCount(0), _deleteTargetStream(deleteTargetStream) {
+        _codec(codec), _recordCounter(counter), _recordCount(0), _appendedLength(0),
+        _finishTime(0), _deleteTargetStream(deleteTargetStream) {
   _dest = new ChecksumOutputStream(_stream, _checksumType);
   _appendBuffer.init(128 * 1024, _dest, _codec);
 }
@@ -125,8 +211,10 @@ void IFileWriter::endPartition() {
 
   CompressStream * compressionStream = _appendBuffer.getCompressionStream();
   if (NULL != compressionStream) {
+    Timer timer;
     compressionStream->finish();
     compressionStream->resetState();
+    _finishTime += timer.now() - timer.last();
   }
 
   uint32_t chsum = _dest->getChecksum();
@@ -134,10 +222,25 @@ void IFileWriter::endPartition() {
   _stream->write(&chsum, sizeof(chsum));
   _stream->flush();
   IFileSegment * info = &(_spillFileSegments[_spillFileSegments.size() - 1]);
-  info->uncompressedEndOffset = _appendBuffer.getCounter();
+  info->uncompressedEndOffset = _appendBuffer.getCounter() + _appendedLength;
   info->realEndOffset = _stream->tell();
 }
 
+void IFileWriter::appendSegment(const string & segment, uint64_t uncompressedLength,
+    uint64_t recordCount) {
+  startPartition();
+  _stream->write(segment.data(), segment.length());
+  _stream->flush();
+  _appendedLength += uncompressedLength;
+  IFileSegment * info = &(_spillFileSegments[_spillFileSegments.size() - 1]);
+  info->uncompressedEndOffset = _appendBuffer.getCounter() + _appendedLength;
+  info->realEndOffset = _stream->tell();
+  if (NULL != _recordCounter) {
+    _recordCounter->increase(recordCount);
+  }
+  _recordCount += recordCount;
+}
+
 void IFileWriter::write(const char * key, uint32_t keyLen, const char * value, uint32_t valueLen) {
   // append KeyLength ValueLength KeyBytesLength
   uint32_t keyBuffLen = keyLen;
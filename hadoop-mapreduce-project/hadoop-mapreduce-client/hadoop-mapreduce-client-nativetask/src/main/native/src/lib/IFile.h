@@ -27,6 +27,8 @@
 
 namespace NativeTask {
 
+class MappedFile;
+
 /**
  * IFileReader
  */
@@ -34,19 +36,45 @@ class IFileReader {
 private:
   InputStream * _stream;
   ChecksumInputStream * _source;
+  MappedFile * _mapped;
+  uint64_t _segmentStart;
+  uint64_t _segmentLength;
   ReadBuffer _reader;
   ChecksumType _checksumType;
   KeyValueType _kType;
   KeyValueType _vType;
   string _codec;
   int32_t _segmentIndex;
+  int32_t _startSegment;
+  int32_t _endSegment;
   SingleSpillInfo * _spillInfo;
   const char * _valuePos;
   uint32_t _valueLen;
   bool _deleteSourceStream;
 
 public:
-  IFileReader(InputStream * stream, SingleSpillInfo * spill, bool deleteSourceStream = false);
+  /**
+   * @param startPartition the stream is positioned at the first segment
+   *        of this partition, nextPartition() stops before endPartition
+   */
+  IFileReader(InputStream * stream, SingleSpillInfo * spill, bool deleteSourceStream = false,
+      uint32_t startPartition = 0, uint32_t endPartition = UINT32_MAX);
+
+  /**
+   * read an uncompressed spill in place from its mapping, keys and values
+   * returned point into mapped, segments are checksummed when entered and
+   * their pages dropped when left
+   * @param mapped owned by the reader
+   */
+  IFileReader(MappedFile * mapped, SingleSpillInfo * spill, uint32_t startPartition = 0,
+      uint32_t endPartition = UINT32_MAX);
+
+  /**
+   * whether spill can be read by the mapped reader: no compression, and
+   * every segment small enough for a ReadBuffer
+   */
+  static bool canMap(SingleSpillInfo * spill, uint32_t startPartition = 0,
+      uint32_t endPartition = UINT32_MAX);
 
   virtual ~IFileReader();
 
@@ -55,6 +83,10 @@ public:
    */
   bool nextPartition();
 
+private:
+  bool nextMappedPartition();
+public:
+
   /**
    * get next key
    * NULL if no more, then next_partition() need to be called
@@ -130,6 +162,8 @@ protected:
   vector<IFileSegment> _spillFileSegments;
   Counter * _recordCounter;
   uint64_t _recordCount;
+  uint64_t _appendedLength;
+  uint64_t _finishTime;
 
   bool _deleteTargetStream;
 
@@ -152,10 +186,25 @@ public:
 
   virtual void write(const char * key, uint32_t keyLen, const char * value, uint32_t valueLen);
 
+  /**
+   * Append a whole partition segment, i.e. the output of another
+   * IFileWriter with the same checksum/codec/key/value settings between
+   * startPartition() and endPartition(), including its trailing checksum.
+   * Used to stitch partitions spilled in parallel into one file.
+   */
+  void appendSegment(const string & segment, uint64_t uncompressedLength, uint64_t recordCount);
+
   SingleSpillInfo * getSpillInfo();
 
   void getStatistics(uint64_t & offset, uint64_t & realOffset, uint64_t & recordCount);
 
+  /**
+   * nanoseconds spent compressing, 0 without codec
+   */
+  uint64_t getCompressTime() {
+    return _appendBuffer.getCompressTime() + _finishTime;
+  }
+
   virtual void collect(const void * key, uint32_t keyLen, const void * value, uint32_t valueLen) {
     write((const char*)key, keyLen, (const char*)value, valueLen);
   }
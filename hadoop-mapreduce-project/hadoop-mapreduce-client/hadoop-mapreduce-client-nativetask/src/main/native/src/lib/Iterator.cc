@@ -17,11 +17,13 @@
  */
 #include "lib/Iterator.h"
 #include "lib/commons.h"
+#include "lib/MapOutputSpec.h"
 
 namespace NativeTask {
 
-KeyGroupIteratorImpl::KeyGroupIteratorImpl(KVIterator * iterator)
-    : _keyGroupIterState(NEW_KEY), _iterator(iterator), _first(true) {
+KeyGroupIteratorImpl::KeyGroupIteratorImpl(KVIterator * iterator, uint32_t groupLength)
+    : _keyGroupIterState(NEW_KEY), _iterator(iterator), _groupLength(groupLength),
+        _first(true) {
 }
 
 bool KeyGroupIteratorImpl::nextKey() {
@@ -60,11 +62,10 @@ const char * KeyGroupIteratorImpl::nextValue(uint32_t & len) {
   }
   case SAME_KEY: {
     if (next()) {
-      if (_key.length() == _currentGroupKey.length()) {
-        if (fmemeq(_key.data(), _currentGroupKey.c_str(), _key.length())) {
-          len = _value.length();
-          return _value.data();
-        }
+      if (MapOutputSpec::sameGroup(_key.data(), _key.length(), _currentGroupKey.data(),
+          _currentGroupKey.length(), _groupLength)) {
+        len = _value.length();
+        return _value.data();
       }
       _keyGroupIterState = NEW_KEY;
       return NULL;
@@ -29,12 +29,17 @@ protected:
   KeyGroupIterState _keyGroupIterState;
   KVIterator * _iterator;
   string _currentGroupKey;
+  uint32_t _groupLength;
   Buffer _key;
   Buffer _value;
   bool _first;
 
 public:
-  KeyGroupIteratorImpl(KVIterator * iterator);
+  /**
+   * @param groupLength group keys by their first groupLength bytes, see
+   *        MapOutputSpec::sameGroup; 0 groups equal keys
+   */
+  KeyGroupIteratorImpl(KVIterator * iterator, uint32_t groupLength = 0);
   bool nextKey();
   const char * getKey(uint32_t & len);
   const char * nextValue(uint32_t & len);
@@ -0,0 +1,279 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KEYCOMPARATORS_H_
+#define KEYCOMPARATORS_H_
+
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "util/WritableUtils.h"
+#include "lib/NativeObjectFactory.h"
+
+namespace NativeTask {
+
+/**
+ * Inline bodies of the built-in key comparators, the
+ * NativeObjectFactory::*Comparator functions forward to these
+ */
+inline int CompareBytesKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  uint32_t minlen = std::min(srcLength, destLength);
+  int64_t ret = fmemcmp(src, dest, minlen);
+  if (ret > 0) {
+    return 1;
+  } else if (ret < 0) {
+    return -1;
+  }
+  return srcLength - destLength;
+}
+
+inline int CompareByteKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  return (*src) - (*dest);
+}
+
+inline int CompareIntKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  int result = (*src) - (*dest);
+  if (result == 0) {
+    uint32_t from = bswap(*(uint32_t*)src);
+    uint32_t to = bswap(*(uint32_t*)dest);
+    if (from > to) {
+      return 1;
+    } else if (from == to) {
+      return 0;
+    } else {
+      return -1;
+    }
+  }
+  return result;
+}
+
+inline int CompareLongKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  int result = (int)(*src) - (int)(*dest);
+  if (result == 0) {
+    uint64_t from = bswap64(*(uint64_t*)src);
+    uint64_t to = bswap64(*(uint64_t*)dest);
+    if (from > to) {
+      return 1;
+    } else if (from == to) {
+      return 0;
+    } else {
+      return -1;
+    }
+  }
+  return result;
+}
+
+inline int CompareVIntKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  int32_t from = WritableUtils::ReadVInt(src, srcLength);
+  int32_t to = WritableUtils::ReadVInt(dest, destLength);
+  if (from > to) {
+    return 1;
+  } else if (from == to) {
+    return 0;
+  } else {
+    return -1;
+  }
+}
+
+inline int CompareVLongKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  int64_t from = WritableUtils::ReadVLong(src, srcLength);
+  int64_t to = WritableUtils::ReadVLong(dest, destLength);
+  if (from > to) {
+    return 1;
+  } else if (from == to) {
+    return 0;
+  } else {
+    return -1;
+  }
+}
+
+inline int CompareFloatKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  if (srcLength != 4 || destLength != 4) {
+    THROW_EXCEPTION_EX(IOException, "float comparator, while src/dest lengt is not 4");
+  }
+
+  uint32_t from = bswap(*(uint32_t*)src);
+  uint32_t to = bswap(*(uint32_t*)dest);
+
+  float * srcValue = (float *)(&from);
+  float * destValue = (float *)(&to);
+
+  if ((*srcValue) < (*destValue)) {
+    return -1;
+  } else if ((*srcValue) == (*destValue)) {
+    return 0;
+  } else {
+    return 1;
+  }
+}
+
+inline int CompareDoubleKey(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  if (srcLength != 8 || destLength != 8) {
+    THROW_EXCEPTION_EX(IOException, "double comparator, while src/dest lengt is not 4");
+  }
+
+  uint64_t from = bswap64(*(uint64_t*)src);
+  uint64_t to = bswap64(*(uint64_t*)dest);
+
+  double * srcValue = (double *)(&from);
+  double * destValue = (double *)(&to);
+  if ((*srcValue) < (*destValue)) {
+    return -1;
+  } else if ((*srcValue) == (*destValue)) {
+    return 0;
+  } else {
+    return 1;
+  }
+}
+
+/**
+ * Key comparator fixed at compile time, so sort and merge kernels
+ * instantiated with it inline the comparison
+ */
+template<int (*_Compare)(const char *, uint32_t, const char *, uint32_t)>
+class StaticKeyComparator {
+public:
+  inline int operator()(const char * src, uint32_t srcLength, const char * dest,
+      uint32_t destLength) const {
+    return _Compare(src, srcLength, dest, destLength);
+  }
+};
+
+typedef StaticKeyComparator<CompareBytesKey> BytesKeyComparator;
+typedef StaticKeyComparator<CompareByteKey> ByteKeyComparator;
+typedef StaticKeyComparator<CompareIntKey> IntKeyComparator;
+typedef StaticKeyComparator<CompareLongKey> LongKeyComparator;
+typedef StaticKeyComparator<CompareVIntKey> VIntKeyComparator;
+typedef StaticKeyComparator<CompareVLongKey> VLongKeyComparator;
+typedef StaticKeyComparator<CompareFloatKey> FloatKeyComparator;
+typedef StaticKeyComparator<CompareDoubleKey> DoubleKeyComparator;
+
+/**
+ * Key comparator called through a ComparatorPtr, only needed for
+ * comparators loaded from a NativeLibrary
+ */
+class DynamicKeyComparator {
+private:
+  ComparatorPtr _compare;
+public:
+  DynamicKeyComparator(ComparatorPtr compare)
+      : _compare(compare) {
+  }
+
+  inline int operator()(const char * src, uint32_t srcLength, const char * dest,
+      uint32_t destLength) const {
+    return (*_compare)(src, srcLength, dest, destLength);
+  }
+};
+
+/**
+ * Run op with the StaticKeyComparator matching comparator if it is one
+ * of the built-in comparators returned by get_comparator(), otherwise
+ * with a DynamicKeyComparator. _Op needs a member template
+ * operator()(const _KeyCompare &).
+ */
+template<typename _Op>
+inline void DispatchKeyComparator(ComparatorPtr comparator, _Op & op) {
+  if (comparator == &NativeObjectFactory::BytesComparator) {
+    op(BytesKeyComparator());
+  } else if (comparator == &NativeObjectFactory::IntComparator) {
+    op(IntKeyComparator());
+  } else if (comparator == &NativeObjectFactory::LongComparator) {
+    op(LongKeyComparator());
+  } else if (comparator == &NativeObjectFactory::VIntComparator) {
+    op(VIntKeyComparator());
+  } else if (comparator == &NativeObjectFactory::VLongComparator) {
+    op(VLongKeyComparator());
+  } else if (comparator == &NativeObjectFactory::FloatComparator) {
+    op(FloatKeyComparator());
+  } else if (comparator == &NativeObjectFactory::DoubleComparator) {
+    op(DoubleKeyComparator());
+  } else if (comparator == &NativeObjectFactory::ByteComparator) {
+    op(ByteKeyComparator());
+  } else {
+    op(DynamicKeyComparator(comparator));
+  }
+}
+
+/**
+ * Key comparator chosen at run time, for long lived objects like Merger
+ * that own their heap and so can not be instantiated per key type.
+ * Built-in comparisons are still inlined, behind a switch on a value
+ * fixed at construction.
+ */
+class KeyComparator {
+private:
+  ComparatorPtr _compare;
+  KeyValueType _builtinType;
+public:
+  KeyComparator(ComparatorPtr compare)
+      : _compare(compare), _builtinType(UnknownType) {
+    if (compare == &NativeObjectFactory::BytesComparator) {
+      _builtinType = BytesType;
+    } else if (compare == &NativeObjectFactory::IntComparator) {
+      _builtinType = IntType;
+    } else if (compare == &NativeObjectFactory::LongComparator) {
+      _builtinType = LongType;
+    } else if (compare == &NativeObjectFactory::VIntComparator) {
+      _builtinType = VIntType;
+    } else if (compare == &NativeObjectFactory::VLongComparator) {
+      _builtinType = VLongType;
+    } else if (compare == &NativeObjectFactory::FloatComparator) {
+      _builtinType = FloatType;
+    } else if (compare == &NativeObjectFactory::DoubleComparator) {
+      _builtinType = DoubleType;
+    } else if (compare == &NativeObjectFactory::ByteComparator) {
+      _builtinType = ByteType;
+    }
+  }
+
+  inline int operator()(const char * src, uint32_t srcLength, const char * dest,
+      uint32_t destLength) const {
+    switch (_builtinType) {
+    case BytesType:
+      return CompareBytesKey(src, srcLength, dest, destLength);
+    case IntType:
+      return CompareIntKey(src, srcLength, dest, destLength);
+    case LongType:
+      return CompareLongKey(src, srcLength, dest, destLength);
+    case VIntType:
+      return CompareVIntKey(src, srcLength, dest, destLength);
+    case VLongType:
+      return CompareVLongKey(src, srcLength, dest, destLength);
+    case FloatType:
+      return CompareFloatKey(src, srcLength, dest, destLength);
+    case DoubleType:
+      return CompareDoubleKey(src, srcLength, dest, destLength);
+    case ByteType:
+      return CompareByteKey(src, srcLength, dest, destLength);
+    default:
+      return (*_compare)(src, srcLength, dest, destLength);
+    }
+  }
+};
+
+} // namespace NativeTask
+
+#endif /* KEYCOMPARATORS_H_ */
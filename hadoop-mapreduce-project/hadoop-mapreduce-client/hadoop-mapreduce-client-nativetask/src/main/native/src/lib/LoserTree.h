@@ -0,0 +1,131 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOSER_TREE_H_
+#define LOSER_TREE_H_
+
+#include "NativeTask.h"
+
+namespace NativeTask {
+
+/**
+ * Tournament tree for k-way merge, keeps the loser of each match in the
+ * inner nodes and the overall winner in _tree[0], so replacing the
+ * winner replays one leaf-to-root path: log2(k) comparisons, against
+ * about 2 * log2(k) for heapify.
+ *
+ * Compare(lhs, rhs) returns true if lhs goes before rhs.
+ */
+template<typename T, typename Compare>
+class LoserTree {
+private:
+  std::vector<T> _sources;
+  std::vector<uint8_t> _exhausted;
+  std::vector<uint32_t> _tree;
+  Compare _comparator;
+  uint32_t _remain;
+
+public:
+  LoserTree(Compare comparator)
+      : _comparator(comparator), _remain(0) {
+  }
+
+  /**
+   * @param first sources, each positioned at its first record
+   */
+  void init(T * first, T * last) {
+    _sources.assign(first, last);
+    _exhausted.assign(_sources.size(), 0);
+    _tree.assign(std::max((size_t)1, _sources.size()), 0);
+    _remain = _sources.size();
+    if (_sources.size() > 1) {
+      _tree[0] = build(1);
+    }
+  }
+
+  void clear() {
+    _sources.clear();
+    _exhausted.clear();
+    _tree.clear();
+    _remain = 0;
+  }
+
+  bool empty() const {
+    return _remain == 0;
+  }
+
+  T top() const {
+    return _sources[_tree[0]];
+  }
+
+  /**
+   * Must be called after top() has been moved to its next record
+   * @param hasNext false if top() has no more records
+   */
+  void replaceTop(bool hasNext) {
+    uint32_t winner = _tree[0];
+    if (!hasNext) {
+      _exhausted[winner] = 1;
+      _remain--;
+    }
+    const uint32_t size = _sources.size();
+    for (uint32_t node = (winner + size) >> 1; node > 0; node >>= 1) {
+      if (before(_tree[node], winner)) {
+        std::swap(_tree[node], winner);
+      }
+    }
+    _tree[0] = winner;
+  }
+
+private:
+  /**
+   * an exhausted source loses to everything
+   */
+  inline bool before(uint32_t lhs, uint32_t rhs) {
+    if (_exhausted[lhs]) {
+      return false;
+    }
+    if (_exhausted[rhs]) {
+      return true;
+    }
+    return _comparator(_sources[lhs], _sources[rhs]);
+  }
+
+  /**
+   * nodes [1, k) are inner nodes, node k + i is the leaf of source i
+   * @return winner of the subtree at node
+   */
+  uint32_t build(uint32_t node) {
+    const uint32_t size = _sources.size();
+    if (node >= size) {
+      return node - size;
+    }
+    uint32_t left = build(node << 1);
+    uint32_t right = build((node << 1) + 1);
+    if (before(right, left)) {
+      _tree[node] = left;
+      return right;
+    }
+    _tree[node] = right;
+    return left;
+  }
+};
+
+} // namespace NativeTask
+
+#endif /* LOSER_TREE_H_ */
@@ -31,17 +31,30 @@
 #include "lib/Combiner.h"
 #include "lib/TaskCounters.h"
 #include "lib/MinHeap.h"
+#include "lib/BufferStream.h"
 
 namespace NativeTask {
 
 ICombineRunner * CombineRunnerWrapper::createCombiner() {
 
   ICombineRunner * combineRunner = NULL;
-  if (NULL != _config->get(NATIVE_COMBINER)) {
-    // Earlier versions of this code supported user-defined
-    // native Combiner implementations. This simplified version
-    // no longer supports it.
-    THROW_EXCEPTION_EX(UnsupportException, "Native Combiners not supported");
+  const char * combinerClass = _config->get(NATIVE_COMBINER);
+  if (NULL != combinerClass) {
+    NativeObject * obj = NativeObjectFactory::CreateObject(combinerClass);
+    NativeCombiner * nativeCombiner = dynamic_cast<NativeCombiner *>(obj);
+    if (NULL == nativeCombiner) {
+      delete obj;
+      THROW_EXCEPTION_EX(UnsupportException, "Native combiner %s not found or not a "
+          "NativeCombiner", combinerClass);
+    }
+    try {
+      nativeCombiner->configure(_config);
+    } catch (...) {
+      delete nativeCombiner;
+      throw;
+    }
+    LOG("[MapOutputCollector::getCombiner] native combiner %s", combinerClass);
+    return nativeCombiner;
   }
 
   CombineHandler * javaCombiner = _spillOutput->getJavaCombineHandler();
@@ -54,8 +67,19 @@ ICombineRunner * CombineRunnerWrapper::createCombiner() {
   return combineRunner;
 }
 
+bool CombineRunnerWrapper::initNativeCombiner() {
+  if (NULL == _config->get(NATIVE_COMBINER)) {
+    return false;
+  }
+  if (!_combinerInited) {
+    _combineRunner = createCombiner();
+    _combinerInited = true;
+  }
+  return true;
+}
+
 void CombineRunnerWrapper::combine(CombineContext type, KVIterator * kvIterator,
-    IFileWriter * writer) {
+    Collector * writer) {
 
   if (!_combinerInited) {
     _combineRunner = createCombiner();
@@ -69,32 +93,161 @@ void CombineRunnerWrapper::combine(CombineContext type, KVIterator * kvIterator,
   }
 }
 
+/////////////////////////////////////////////////////////////////
+// CollectorMetrics
+/////////////////////////////////////////////////////////////////
+
+const char * CollectorMetrics::GROUP = "NativeTask Collector";
+
+// 4 bounds, 5 buckets each, see CollectorMetrics
+static const uint64_t MILLIS_BOUNDS[] = {10, 100, 1000, 10000};
+static const uint64_t MICROS_BOUNDS[] = {100, 1000, 10000, 100000};
+static const uint64_t BYTES_BOUNDS[] = {1ULL << 20, 16ULL << 20, 256ULL << 20, 4ULL << 30};
+static const uint64_t FAN_IN_BOUNDS[] = {2, 8, 32, 128};
+static const uint64_t PERCENT_BOUNDS[] = {25, 50, 75, 100};
+
+#define BOUNDS(bounds) bounds, sizeof(bounds) / sizeof(bounds[0])
+
+CollectorMetrics::CollectorMetrics(const string & codec)
+    : spillTime(GROUP, "SPILL_MS", BOUNDS(MILLIS_BOUNDS)),
+        partitionSortTime(GROUP, "PARTITION_SORT_US", BOUNDS(MICROS_BOUNDS)),
+        spillBytes(GROUP, "SPILL_BYTES", BOUNDS(BYTES_BOUNDS)),
+        mergeFanIn(GROUP, "MERGE_FAN_IN", BOUNDS(FAN_IN_BOUNDS)),
+        mergeBytes(GROUP, "MERGE_READ_BYTES", BOUNDS(BYTES_BOUNDS)),
+        allocateBlockedTime(GROUP, "ALLOCATE_BLOCKED_MS", BOUNDS(MILLIS_BOUNDS)),
+        compressRatio(NULL), compressTime(NULL) {
+  if (codec.length() > 0) {
+    // e.g. org.apache.hadoop.io.compress.Lz4Codec -> LZ4
+    string name = codec.substr(codec.rfind('.') + 1);
+    if (StringUtil::EndsWith(name, "Codec")) {
+      name = name.substr(0, name.length() - 5);
+    }
+    for (size_t i = 0; i < name.length(); i++) {
+      name[i] = toupper(name[i]);
+    }
+    compressRatio = new Histogram(GROUP, "COMPRESS_RATIO_PCT_" + name, BOUNDS(PERCENT_BOUNDS));
+    compressTime = new Histogram(GROUP, "COMPRESS_MS_" + name, BOUNDS(MILLIS_BOUNDS));
+  }
+}
+
+CollectorMetrics::~CollectorMetrics() {
+  delete compressRatio;
+  delete compressTime;
+}
+
+void CollectorMetrics::addOutput(IFileWriter * writer, uint64_t workerCompressTime) {
+  uint64_t rawLength;
+  uint64_t realLength;
+  uint64_t recordCount;
+  writer->getStatistics(rawLength, realLength, recordCount);
+  if (NULL != compressRatio && rawLength > 0) {
+    compressRatio->add(realLength * 100 / rawLength);
+    compressTime->add((writer->getCompressTime() + workerCompressTime) / 1000000);
+  }
+}
+
+static uint64_t SpillBytes(const std::vector<SingleSpillInfo *> & spills) {
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < spills.size(); i++) {
+    bytes += spills[i]->getRealEndPosition();
+  }
+  return bytes;
+}
+
 /////////////////////////////////////////////////////////////////
 // MapOutputCollector
 /////////////////////////////////////////////////////////////////
 
+/**
+ * Spill a detached set of partition buckets on the spill thread
+ */
+class AsyncSpillTask : public AsyncTask {
+public:
+  MapOutputCollector * collector;
+  PartitionBucket ** buckets;
+  string path;
+  uint32_t spillId;
+  uint64_t collectTime;
+  // pool bytes to release once the spill is done
+  uint64_t poolUsed;
+  SingleSpillInfo * info;
+
+  AsyncSpillTask(MapOutputCollector * collector, PartitionBucket ** buckets, const string & path,
+      uint32_t spillId, uint64_t collectTime, uint64_t poolUsed)
+      : collector(collector), buckets(buckets), path(path), spillId(spillId),
+          collectTime(collectTime), poolUsed(poolUsed), info(NULL) {
+  }
+
+  virtual ~AsyncSpillTask() {
+    delete info;
+  }
+
+protected:
+  virtual void execute() {
+    info = collector->spillBuckets(buckets, path, spillId, collectTime, false);
+  }
+};
+
 MapOutputCollector::MapOutputCollector(uint32_t numberPartitions, SpillOutputService * spillService)
     : _config(NULL), _numPartitions(numberPartitions), _buckets(NULL),
-      _keyComparator(NULL), _combineRunner(NULL),
+      _keyComparator(NULL), _sortKeyType(UnknownType),
+      _wholePartitionSort(false), _combineRunner(NULL),
       _mapOutputRecords(NULL), _mapOutputBytes(NULL),
       _mapOutputMaterializedBytes(NULL), _spilledRecords(NULL),
-      _spillOutput(spillService), _defaultBlockSize(0), _pool(NULL) {
+      _spillOutput(spillService), _defaultBlockSize(0), _pool(NULL), _sortPool(NULL),
+      _asyncSpill(false), _spillThreshold(0), _lastPoolUsed(0), _spillingBuckets(NULL),
+      _spillThread(NULL), _spillTask(NULL), _mergeFactor(DEFAULT_MERGE_FACTOR),
+      _mergeThreads(1), _mergePool(NULL), _ioThread(NULL), _readAheadSize(0), _mmapSpills(false),
+      _directSpill(false), _aggregator(NULL), _metrics(NULL) {
   _pool = new MemoryPool();
 }
 
 MapOutputCollector::~MapOutputCollector() {
 
-  if (NULL != _buckets) {
-    for (uint32_t i = 0; i < _numPartitions; i++) {
-      if (NULL != _buckets[i]) {
-        delete _buckets[i];
-        _buckets[i] = NULL;
-      }
+  if (NULL != _spillTask) {
+    // only on error paths, the spill result is not needed any more
+    try {
+      _spillTask->waitFinish();
+    } catch (...) {
     }
+    delete _spillTask;
+    _spillTask = NULL;
   }
 
-  delete[] _buckets;
+  if (NULL != _spillThread) {
+    delete _spillThread;
+    _spillThread = NULL;
+  }
+
+  if (NULL != _sortPool) {
+    delete _sortPool;
+    _sortPool = NULL;
+  }
+
+  if (NULL != _ioThread) {
+    delete _ioThread;
+    _ioThread = NULL;
+  }
+
+  if (NULL != _mergePool) {
+    delete _mergePool;
+    _mergePool = NULL;
+  }
+
+  if (NULL != _aggregator) {
+    delete _aggregator;
+    _aggregator = NULL;
+  }
+
+  if (NULL != _metrics) {
+    delete _metrics;
+    _metrics = NULL;
+  }
+
+  deleteBuckets(_buckets);
   _buckets = NULL;
+  deleteBuckets(_spillingBuckets);
+  _spillingBuckets = NULL;
 
   if (NULL != _pool) {
     delete _pool;
@@ -107,7 +260,7 @@ MapOutputCollector::~MapOutputCollector() {
   }
 }
 
-void MapOutputCollector::init(uint32_t defaultBlockSize, uint32_t memoryCapacity,
+void MapOutputCollector::init(uint32_t defaultBlockSize, uint64_t memoryCapacity,
     ComparatorPtr keyComparator, ICombineRunner * combiner) {
 
   this->_combineRunner = combiner;
@@ -119,14 +272,7 @@ void MapOutputCollector::init(uint32_t defaultBlockSize, uint32_t memoryCapacity
   // TODO: add support for customized comparator
   this->_keyComparator = keyComparator;
 
-  _buckets = new PartitionBucket*[_numPartitions];
-
-  for (uint32_t partitionId = 0; partitionId < _numPartitions; partitionId++) {
-    PartitionBucket * pb = new PartitionBucket(_pool, partitionId, keyComparator, _combineRunner,
-        defaultBlockSize);
-
-    _buckets[partitionId] = pb;
-  }
+  _buckets = createBuckets();
 
   _mapOutputRecords = NativeObjectFactory::GetCounter(
       TaskCounters::TASK_COUNTER_GROUP, TaskCounters::MAP_OUTPUT_RECORDS);
@@ -141,6 +287,31 @@ void MapOutputCollector::init(uint32_t defaultBlockSize, uint32_t memoryCapacity
   _collectTimer.reset();
 }
 
+PartitionBucket ** MapOutputCollector::createBuckets() {
+  PartitionBucket ** buckets = new PartitionBucket*[_numPartitions];
+
+  for (uint32_t partitionId = 0; partitionId < _numPartitions; partitionId++) {
+    PartitionBucket * pb = new PartitionBucket(_pool, partitionId, _keyComparator, _combineRunner,
+        _defaultBlockSize, _sortKeyType, _wholePartitionSort, _spec.mergeAlgorithm);
+
+    buckets[partitionId] = pb;
+  }
+  return buckets;
+}
+
+void MapOutputCollector::deleteBuckets(PartitionBucket ** buckets) {
+  if (NULL == buckets) {
+    return;
+  }
+  for (uint32_t i = 0; i < _numPartitions; i++) {
+    if (NULL != buckets[i]) {
+      delete buckets[i];
+      buckets[i] = NULL;
+    }
+  }
+  delete[] buckets;
+}
+
 void MapOutputCollector::reset() {
   for (uint32_t i = 0; i < _numPartitions; i++) {
     if (NULL != _buckets[i]) {
@@ -155,56 +326,317 @@ void MapOutputCollector::configure(Config * config) {
   MapOutputSpec::getSpecFromConfig(config, _spec);
 
   uint32_t maxBlockSize = config->getInt(NATIVE_SORT_MAX_BLOCK_SIZE, DEFAULT_MAX_BLOCK_SIZE);
-  uint32_t capacity = config->getInt(MAPRED_IO_SORT_MB, 300) * 1024 * 1024;
+  int64_t sortMB = config->getInt(MAPRED_IO_SORT_MB, 300);
+  if (sortMB <= 0) {
+    THROW_EXCEPTION_EX(IOException, "Invalid %s: %" PRId64, MAPRED_IO_SORT_MB, sortMB);
+  }
+  uint64_t capacity = (uint64_t)sortMB * 1024 * 1024;
 
   uint32_t defaultBlockSize = getDefaultBlockSize(capacity, _numPartitions, maxBlockSize);
   LOG("Native Total MemoryBlockPool: num_partitions %u, min_block_size %uK, "
-      "max_block_size %uK, capacity %uM", _numPartitions, defaultBlockSize / 1024,
+      "max_block_size %uK, capacity %" PRIu64 "M", _numPartitions, defaultBlockSize / 1024,
       maxBlockSize / 1024, capacity / 1024 / 1024);
 
   ComparatorPtr comparator = getComparator(config, _spec);
 
-  ICombineRunner * combiner = NULL;
+  // key type specific sort only applies to the built-in comparators
+  const bool nativeComparator = (comparator == get_comparator(_spec.keyType, NULL));
+  const bool keySpecificSort = nativeComparator && SupportKeyPrefix(_spec.keyType);
+  if (_spec.sortOrder == GROUPBY) {
+    // with a fixed length group field in front, byte order of the whole key
+    // is group field order then secondary field order, so GROUPBY runs the
+    // regular sort and merge kernels, prefix and radix sort included
+    if (!nativeComparator || (_spec.keyType != TextType && _spec.keyType != BytesType)) {
+      THROW_EXCEPTION(UnsupportException,
+          "GROUPBY requires Text or BytesWritable keys and the built-in comparator");
+    }
+    LOG("Native sort: GROUPBY with a %u byte group field", _spec.groupFieldLength);
+  }
+  if (_spec.sortAlgorithm == RADIXSORT) {
+    if (keySpecificSort) {
+      _sortKeyType = _spec.keyType;
+    } else {
+      LOG("Native sort: RADIXSORT not supported for this key type or comparator, "
+          "use DUALPIVOTSORT");
+      _spec.sortAlgorithm = DUALPIVOTSORT;
+    }
+  } else if (keySpecificSort && config->getBool(NATIVE_SORT_KEY_PREFIX, false)) {
+    _sortKeyType = _spec.keyType;
+    LOG("Native sort uses key prefix index");
+  }
+  _wholePartitionSort = config->getBool(NATIVE_SORT_WHOLE_PARTITION, false);
+
+  CombineRunnerWrapper * combiner = NULL;
+  bool javaCombiner = false;
   if (NULL != config->get(NATIVE_COMBINER)
       // config name for old api and new api
       || NULL != config->get(MAPRED_COMBINE_CLASS_OLD)
       || NULL != config->get(MAPRED_COMBINE_CLASS_NEW)) {
     combiner = new CombineRunnerWrapper(config, _spillOutput);
+    try {
+      javaCombiner = !combiner->initNativeCombiner();
+    } catch (...) {
+      delete combiner;
+      throw;
+    }
   }
 
+  string memoryPolicy = config->get(NATIVE_SORT_MEMORY_POLICY, "MALLOC");
+  MemoryPolicy policy = MALLOC_MEMORY;
+  if (memoryPolicy == "HUGEPAGE") {
+    policy = HUGEPAGE_MEMORY;
+  } else if (memoryPolicy == "HUGETLB") {
+    policy = HUGETLB_MEMORY;
+  } else if (memoryPolicy != "MALLOC") {
+    THROW_EXCEPTION_EX(IOException, "Invalid %s: %s", NATIVE_SORT_MEMORY_POLICY,
+        memoryPolicy.c_str());
+  }
+  const bool numaLocal = config->getBool(NATIVE_SORT_MEMORY_NUMA_LOCAL, false);
+  const bool prefault = config->getBool(NATIVE_SORT_MEMORY_PREFAULT, false);
+  _pool->setPolicy(policy, numaLocal, prefault);
+  LOG("Native sort buffer: policy %s, numa local %s, prefault %s", memoryPolicy.c_str(),
+      numaLocal ? "true" : "false", prefault ? "true" : "false");
+
   init(defaultBlockSize, capacity, comparator, combiner);
+
+  int64_t hashMB = config->getInt(NATIVE_COMBINE_HASH_MB, 0);
+  if (hashMB > 0) {
+    if (NULL == _combineRunner) {
+      LOG("Native hash aggregation is disabled because no combiner is set");
+    } else {
+      hashMB = std::min(hashMB, (int64_t)4095);
+      _aggregator = new HashAggregator((uint64_t)hashMB * 1024 * 1024, _keyComparator,
+          _combineRunner);
+      LOG("Native hash aggregation: %" PRId64 "M", hashMB);
+    }
+  }
+
+  int64_t spillThreads = config->getInt(NATIVE_SORT_SPILL_THREADS, 1);
+  if (spillThreads > 1 && _numPartitions > 1) {
+    spillThreads = std::min(spillThreads, (int64_t)_numPartitions);
+    LOG("Native parallel sort & spill: threads %" PRId64, spillThreads);
+    _sortPool = new ThreadPool((uint32_t)spillThreads);
+  }
+
+  if (config->getBool(NATIVE_SPILL_ASYNC, false)) {
+    if (javaCombiner) {
+      // java combiner calls back into java, keep it on the collecting thread
+      LOG("Native async spill is disabled because a java combiner is set");
+    } else {
+      float spillPercent = config->getFloat(MAPRED_SORT_SPILL_PERCENT, 0.8);
+      if (spillPercent <= 0 || spillPercent > 1) {
+        THROW_EXCEPTION_EX(IOException, "Invalid %s: %f", MAPRED_SORT_SPILL_PERCENT,
+            spillPercent);
+      }
+      _asyncSpill = true;
+      _spillThreshold = (uint64_t)(capacity * (double)spillPercent);
+      _spillingBuckets = createBuckets();
+      _spillThread = new ThreadPool(1);
+      LOG("Native async spill: spill percent %.2f", spillPercent);
+    }
+  }
+
+  int64_t mergeFactor = config->getInt(MAPRED_IO_SORT_FACTOR, DEFAULT_MERGE_FACTOR);
+  if (mergeFactor < 2) {
+    THROW_EXCEPTION_EX(IOException, "Invalid %s: %" PRId64, MAPRED_IO_SORT_FACTOR, mergeFactor);
+  }
+  _mergeFactor = (uint32_t)std::min(mergeFactor, (int64_t)UINT32_MAX);
+  _mergeThreads = (uint32_t)std::max(config->getInt(NATIVE_MERGE_THREADS, 1), (int64_t)1);
+
+  int64_t readAheadSize = config->getInt(NATIVE_MERGE_READ_AHEAD, 0);
+  if (readAheadSize > 0) {
+    _readAheadSize = (uint32_t)std::min(readAheadSize, (int64_t)(256 * 1024 * 1024));
+    _ioThread = new ThreadPool(1);
+    LOG("Native merge read ahead: %u bytes", _readAheadSize);
+  }
+  _mmapSpills = config->getBool(NATIVE_MERGE_MMAP, false);
+  if (_mmapSpills) {
+    LOG("Native merge reads uncompressed spills mapped");
+  }
+  _directSpill = config->getBool(NATIVE_SPILL_DIRECT_IO, false);
+  if (_directSpill) {
+    LOG("Native intermediate spill and merge outputs bypass the page cache");
+  }
+  if (config->getBool(NATIVE_COLLECTOR_METRICS, false)) {
+    _metrics = new CollectorMetrics(_spec.codec);
+    LOG("Native collector metrics are exported as counters of %s", CollectorMetrics::GROUP);
+  }
 }
 
 KVBuffer * MapOutputCollector::allocateKVBuffer(uint32_t partitionId, uint32_t kvlength) {
+  if (partitionId >= _numPartitions) {
+    THROW_EXCEPTION_EX(IOException, "Partition is NULL, partition_id: %d, num_partitions: %d",
+                       partitionId, _numPartitions);
+  }
+
+  KVBuffer * dest = NULL;
+  if (NULL != _aggregator) {
+    dest = _aggregator->allocateKVBuffer(partitionId, kvlength);
+    if (NULL == dest) {
+      flushAggregator();
+      dest = _aggregator->allocateKVBuffer(partitionId, kvlength);
+    }
+  }
+  if (NULL == dest) {
+    dest = allocateFromBuckets(partitionId, kvlength);
+  }
+  _mapOutputRecords->increase();
+  _mapOutputBytes->increase(kvlength - KVBuffer::headerLength());
+  return dest;
+}
+
+void MapOutputCollector::flushAggregator() {
+  string output;
+  _aggregator->flush(output);
+  const char * pos = output.data();
+  const char * end = pos + output.length();
+  while (pos < end) {
+    KVBufferWithParititionId * record = (KVBufferWithParititionId *)pos;
+    const uint32_t length = record->buffer.length();
+    KVBuffer * dest = allocateFromBuckets(record->partitionId, length);
+    memcpy(dest, &record->buffer, length);
+    pos += sizeof(uint32_t) + length;
+  }
+}
+
+KVBuffer * MapOutputCollector::allocateFromBuckets(uint32_t partitionId, uint32_t kvlength) {
   PartitionBucket * partition = getPartition(partitionId);
   if (NULL == partition) {
     THROW_EXCEPTION_EX(IOException, "Partition is NULL, partition_id: %d, num_partitions: %d",
                        partitionId, _numPartitions);
   }
 
+  if (_asyncSpill && _pool->getUsed() != _lastPoolUsed) {
+    checkAsyncSpill();
+    partition = getPartition(partitionId);
+  }
+
   KVBuffer * dest = partition->allocateKVBuffer(kvlength);
 
   if (NULL == dest) {
-    string * spillpath = _spillOutput->getSpillPath();
-    if (NULL == spillpath || spillpath->length() == 0) {
-      THROW_EXCEPTION(IOException, "Illegal(empty) spill files path");
-    } else {
-      middleSpill(*spillpath, "", false);
-      delete spillpath;
+    Timer blocked;
+    while (NULL == dest && spillForSpace()) {
+      partition = getPartition(partitionId);
+      dest = partition->allocateKVBuffer(kvlength);
     }
-
-    dest = partition->allocateKVBuffer(kvlength);
     if (NULL == dest) {
       // io.sort.mb too small, cann't proceed
-      // should not get here, cause get_buffer_to_put can throw OOM exception
       THROW_EXCEPTION(OutOfMemoryException, "key/value pair larger than io.sort.mb");
     }
+    if (NULL != _metrics) {
+      _metrics->allocateBlockedTime.add((blocked.now() - blocked.last()) / 1000000);
+    }
   }
-  _mapOutputRecords->increase();
-  _mapOutputBytes->increase(kvlength - KVBuffer::headerLength());
   return dest;
 }
 
+bool MapOutputCollector::spillForSpace() {
+  Timer timer;
+  if (_asyncSpill) {
+    if (NULL != _spillTask) {
+      // collected faster than spilled, have to wait
+      finishAsyncSpill();
+      _times.midSpillTime += timer.now() - timer.last();
+      return true;
+    }
+    if (_pool->getUsed() > 0) {
+      startAsyncSpill();
+      finishAsyncSpill();
+      _times.midSpillTime += timer.now() - timer.last();
+      return true;
+    }
+    return false;
+  }
+
+  if (_pool->getUsed() == 0) {
+    return false;
+  }
+  string * spillpath = _spillOutput->getSpillPath();
+  if (NULL == spillpath || spillpath->length() == 0) {
+    delete spillpath;
+    THROW_EXCEPTION(IOException, "Illegal(empty) spill files path");
+  }
+  middleSpill(*spillpath, "", false);
+  delete spillpath;
+  _times.midSpillTime += timer.now() - timer.last();
+  return true;
+}
+
+char * MapOutputCollector::allocateSharedBuffer(uint32_t minLength, uint32_t expectLength,
+    uint32_t & allocated) {
+  if (NULL != _aggregator) {
+    return NULL;
+  }
+  expectLength = std::max(minLength, expectLength);
+
+  if (_asyncSpill && _pool->getUsed() != _lastPoolUsed) {
+    checkAsyncSpill();
+  }
+
+  // near the end of the pool take what is left, the unused part is
+  // given back on commit
+  char * buffer = _pool->allocate(minLength, expectLength, allocated, true);
+  if (NULL == buffer) {
+    Timer blocked;
+    while (NULL == buffer && spillForSpace()) {
+      buffer = _pool->allocate(minLength, expectLength, allocated, true);
+    }
+    if (NULL == buffer) {
+      THROW_EXCEPTION(OutOfMemoryException, "key/value pair larger than io.sort.mb");
+    }
+    if (NULL != _metrics) {
+      _metrics->allocateBlockedTime.add((blocked.now() - blocked.last()) / 1000000);
+    }
+  }
+  return buffer;
+}
+
+void MapOutputCollector::commitSharedBuffer(char * buffer, uint32_t allocated, uint32_t length) {
+  if (length > allocated) {
+    THROW_EXCEPTION_EX(IOException, "Shared buffer overflow, length: %u, allocated: %u", length,
+        allocated);
+  }
+  _pool->shrink(buffer, allocated, length);
+
+  // one block per partition, indexing the records in place
+  std::vector<MemoryBlock *> blocks(_numPartitions, (MemoryBlock *)NULL);
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+  uint32_t pos = 0;
+  while (pos < length) {
+    if (length - pos < KVBufferWithParititionId::minLength()) {
+      THROW_EXCEPTION(IOException, "k/v meta information incomplete");
+    }
+    KVBufferWithParititionId * record = (KVBufferWithParititionId *)(buffer + pos);
+    const uint32_t partitionId = record->partitionId;
+    if (partitionId >= _numPartitions) {
+      THROW_EXCEPTION_EX(IOException, "Partition is NULL, partition_id: %d, num_partitions: %d",
+          partitionId, _numPartitions);
+    }
+    const uint64_t contentLength = (uint64_t)record->buffer.keyLength
+        + record->buffer.valueLength;
+    const uint32_t remain = length - pos - KVBufferWithParititionId::minLength();
+    if (contentLength > remain) {
+      THROW_EXCEPTION_EX(IOException, "k/v content incomplete, length: %" PRIu64 ", remain: %u",
+          contentLength, remain);
+    }
+
+    const uint32_t kvlength = (uint32_t)contentLength + KVBuffer::headerLength();
+    MemoryBlock * block = blocks[partitionId];
+    if (NULL == block) {
+      block = new MemoryBlock(buffer, 0);
+      _buckets[partitionId]->addMemoryBlock(block);
+      blocks[partitionId] = block;
+    }
+    block->addKVBuffer(pos + SIZE_OF_PARTITION_LENGTH, kvlength);
+    records++;
+    bytes += contentLength;
+    pos += SIZE_OF_PARTITION_LENGTH + kvlength;
+  }
+  _mapOutputRecords->increase(records);
+  _mapOutputBytes->increase(bytes);
+}
+
 /**
  * collect one k/v pair
  * @return true success; false buffer full, need spill
@@ -239,17 +671,68 @@ PartitionBucket * MapOutputCollector::getPartition(uint32_t partition) {
   return _buckets[partition];
 }
 
+/**
+ * Sort one partition bucket on a worker thread, and optionally spill
+ * it to an in-memory IFile segment
+ */
+class PartitionSortTask : public AsyncTask {
+public:
+  PartitionBucket * bucket;
+  SortAlgorithm sortType;
+  const MapOutputSpec * spec;
+  bool spill;
+
+  string segment;
+  uint64_t uncompressedLength;
+  uint64_t recordCount;
+  uint64_t sortTime;
+  uint64_t compressTime;
+
+  PartitionSortTask(PartitionBucket * bucket, SortAlgorithm sortType, const MapOutputSpec * spec,
+      bool spill)
+      : bucket(bucket), sortType(sortType), spec(spec), spill(spill), uncompressedLength(0),
+          recordCount(0), sortTime(0), compressTime(0) {
+  }
+
+protected:
+  virtual void execute() {
+    if (NULL != bucket) {
+      Timer timer;
+      bucket->sort(sortType);
+      sortTime = timer.now() - timer.last();
+    }
+    if (spill) {
+      // record counter is updated when the segment is appended
+      OutputStringStream output(segment);
+      IFileWriter writer(&output, spec->checksumType, spec->keyType, spec->valueType,
+          spec->codec, NULL);
+      writer.startPartition();
+      if (NULL != bucket) {
+        bucket->spill(&writer);
+      }
+      writer.endPartition();
+      uint64_t realLength;
+      writer.getStatistics(uncompressedLength, realLength, recordCount);
+      compressTime = writer.getCompressTime();
+    }
+  }
+};
+
 /**
  * Spill buffer to file
  * @return Array of spill segments information
  */
-void MapOutputCollector::sortPartitions(SortOrder orderType, SortAlgorithm sortType,
-    IFileWriter * writer, SortMetrics & metric) {
+void MapOutputCollector::sortPartitions(PartitionBucket ** buckets, SortOrder orderType,
+    SortAlgorithm sortType, IFileWriter * writer, SortMetrics & metric) {
 
   uint32_t start_partition = 0;
   uint32_t num_partition = _numPartitions;
-  if (orderType == GROUPBY) {
-    THROW_EXCEPTION(UnsupportException, "GROUPBY not supported");
+  // GROUPBY keys sort like FULLORDER, groups are formed by the combiners
+  const bool sorted = (orderType != NOSORT);
+
+  if (sorted && NULL != _sortPool) {
+    parallelSortPartitions(buckets, sortType, writer, metric);
+    return;
   }
 
   uint64_t sortingTime = 0;
@@ -260,13 +743,17 @@ void MapOutputCollector::sortPartitions(SortOrder orderType, SortAlgorithm sortT
     if (NULL != writer) {
       writer->startPartition();
     }
-    PartitionBucket * pb = _buckets[start_partition + i];
+    PartitionBucket * pb = buckets[start_partition + i];
     if (pb != NULL) {
       recordNum += pb->getKVCount();
-      if (orderType == FULLORDER) {
+      if (sorted) {
         timer.reset();
         pb->sort(sortType);
-        sortingTime += timer.now() - timer.last();
+        const uint64_t partitionSortTime = timer.now() - timer.last();
+        sortingTime += partitionSortTime;
+        if (NULL != _metrics && pb->getKVCount() > 0) {
+          _metrics->partitionSortTime.add(partitionSortTime / 1000);
+        }
       }
       if (NULL != writer) {
         pb->spill(writer);
@@ -280,6 +767,143 @@ void MapOutputCollector::sortPartitions(SortOrder orderType, SortAlgorithm sortT
   metric.recordCount = recordNum;
 }
 
+void MapOutputCollector::parallelSortPartitions(PartitionBucket ** buckets,
+    SortAlgorithm sortType, IFileWriter * writer, SortMetrics & metric) {
+  // the combiner may call back into java, so it always runs here
+  const bool spillInWorker = (NULL != writer) && (NULL == _combineRunner);
+  // bound the number of staged segments held in memory
+  const uint32_t window = _sortPool->getThreadCount() * 2;
+
+  std::vector<PartitionSortTask *> tasks(_numPartitions, (PartitionSortTask *)NULL);
+  uint32_t submitted = 0;
+  uint32_t current = 0;
+  uint64_t sortingTime = 0;
+  uint64_t recordNum = 0;
+
+  try {
+    for (; current < _numPartitions; current++) {
+      while (submitted < _numPartitions && submitted < current + window) {
+        tasks[submitted] = new PartitionSortTask(buckets[submitted], sortType, &_spec,
+            spillInWorker);
+        _sortPool->submit(tasks[submitted]);
+        submitted++;
+      }
+
+      PartitionSortTask * task = tasks[current];
+      task->waitFinish();
+      PartitionBucket * pb = buckets[current];
+      if (NULL != pb) {
+        recordNum += pb->getKVCount();
+        if (NULL != _metrics && pb->getKVCount() > 0) {
+          _metrics->partitionSortTime.add(task->sortTime / 1000);
+        }
+      }
+      sortingTime += task->sortTime;
+      metric.compressTime += task->compressTime;
+
+      if (spillInWorker) {
+        writer->appendSegment(task->segment, task->uncompressedLength, task->recordCount);
+      } else if (NULL != writer) {
+        writer->startPartition();
+        if (NULL != pb) {
+          pb->spill(writer);
+        }
+        writer->endPartition();
+      }
+      delete task;
+      tasks[current] = NULL;
+    }
+  } catch (...) {
+    // workers may still reference the buckets, drain them before unwinding
+    for (uint32_t i = current; i < submitted; i++) {
+      if (NULL != tasks[i]) {
+        try {
+          tasks[i]->waitFinish();
+        } catch (...) {
+        }
+        delete tasks[i];
+      }
+    }
+    throw;
+  }
+  metric.sortTime = sortingTime;
+  metric.recordCount = recordNum;
+}
+
+/**
+ * Merge a group of spills into one intermediate spill
+ */
+class IntermediateMergeTask : public AsyncTask {
+public:
+  MapOutputCollector * collector;
+  std::vector<SingleSpillInfo *> spills;
+  string path;
+  SingleSpillInfo * info;
+
+  IntermediateMergeTask(MapOutputCollector * collector, const string & path)
+      : collector(collector), path(path), info(NULL) {
+  }
+
+  virtual ~IntermediateMergeTask() {
+    delete info;
+  }
+
+protected:
+  virtual void execute() {
+    info = collector->mergeSpills(spills, path);
+  }
+};
+
+/**
+ * Final merge of a partition range, into writer or else a new file
+ */
+class RangeMergeTask : public AsyncTask {
+public:
+  MapOutputCollector * collector;
+  uint32_t start;
+  uint32_t end;
+  IFileWriter * writer;
+  string path;
+  SingleSpillInfo * info;
+
+  RangeMergeTask(MapOutputCollector * collector, uint32_t start, uint32_t end)
+      : collector(collector), start(start), end(end), writer(NULL), info(NULL) {
+  }
+
+  virtual ~RangeMergeTask() {
+    delete info;
+  }
+
+protected:
+  virtual void execute() {
+    if (NULL != writer) {
+      collector->mergePartitionRange(start, end, writer);
+      info = writer->getSpillInfo();
+    } else {
+      IFileWriter * rangeWriter = collector->createSpillWriter(path, false);
+      try {
+        collector->mergePartitionRange(start, end, rangeWriter);
+      } catch (...) {
+        delete rangeWriter;
+        throw;
+      }
+      if (NULL != collector->_metrics) {
+        collector->_metrics->addOutput(rangeWriter);
+      }
+      info = rangeWriter->getSpillInfo();
+      info->path = path;
+      delete rangeWriter;
+    }
+  }
+};
+
+class SpillSizeLessThan {
+public:
+  bool operator()(SingleSpillInfo * lhs, SingleSpillInfo * rhs) {
+    return lhs->getRealEndPosition() < rhs->getRealEndPosition();
+  }
+};
+
 void MapOutputCollector::middleSpill(const std::string & spillOutput,
     const std::string & indexFilePath, bool final) {
 
@@ -288,33 +912,8 @@ void MapOutputCollector::middleSpill(const std::string & spillOutput,
   if (spillOutput.empty()) {
     THROW_EXCEPTION(IOException, "MapOutputCollector: Spill file path empty");
   } else {
-    OutputStream * fout = FileSystem::getLocal().create(spillOutput, true);
-
-    IFileWriter * writer = new IFileWriter(fout, _spec.checksumType, _spec.keyType, _spec.valueType,
-        _spec.codec, _spilledRecords);
-
-    Timer timer;
-    SortMetrics metrics;
-    sortPartitions(_spec.sortOrder, _spec.sortAlgorithm, writer, metrics);
-
-    SingleSpillInfo * info = writer->getSpillInfo();
-    info->path = spillOutput;
-    uint64_t spillTime = timer.now() - timer.last() - metrics.sortTime;
-
-    const uint64_t M = 1000000; // million
-    LOG("%s-spill: { id: %d, collect: %"PRIu64" ms, "
-        "in-memory sort: %"PRIu64" ms, in-memory records: %"PRIu64", "
-        "merge&spill: %"PRIu64" ms, uncompressed size: %"PRIu64", "
-        "real size: %"PRIu64" path: %s }",
-        final ? "Final" : "Mid",
-        _spillInfos.getSpillCount(),
-        collecttime / M,
-        metrics.sortTime  / M,
-        metrics.recordCount,
-        spillTime  / M,
-        info->getEndPosition(),
-        info->getRealEndPosition(),
-        spillOutput.c_str());
+    SingleSpillInfo * info = spillBuckets(_buckets, spillOutput, _spillInfos.getSpillCount(),
+        collecttime, final);
 
     if (final) {
       _mapOutputMaterializedBytes->increase(info->getRealEndPosition());
@@ -327,14 +926,418 @@ void MapOutputCollector::middleSpill(const std::string & spillOutput,
       _spillInfos.add(info);
     }
 
-    delete writer;
-    delete fout;
-
     reset();
     _collectTimer.reset();
   }
 }
 
+SingleSpillInfo * MapOutputCollector::spillBuckets(PartitionBucket ** buckets,
+    const std::string & spillOutput, uint32_t spillId, uint64_t collectTime, bool final) {
+  OutputStream * fout = createSpillOutput(spillOutput, final);
+  uint64_t expectedLength = 0;
+  for (uint32_t i = 0; i < _numPartitions; i++) {
+    if (NULL != buckets[i]) {
+      expectedLength += buckets[i]->getKVBytes();
+    }
+  }
+  fout->preallocate(expectedLength);
+
+  IFileWriter * writer = new IFileWriter(fout, _spec.checksumType, _spec.keyType, _spec.valueType,
+      _spec.codec, _spilledRecords);
+
+  Timer timer;
+  SortMetrics metrics;
+  sortPartitions(buckets, _spec.sortOrder, _spec.sortAlgorithm, writer, metrics);
+
+  SingleSpillInfo * info = writer->getSpillInfo();
+  info->path = spillOutput;
+  uint64_t totalTime = timer.now() - timer.last();
+  // sort time is summed over workers when sorting in parallel
+  uint64_t spillTime = totalTime > metrics.sortTime ? totalTime - metrics.sortTime : 0;
+  _times.sortTime += metrics.sortTime;
+  _times.spillTime += spillTime;
+  if (NULL != _metrics) {
+    _metrics->spillTime.add(totalTime / 1000000);
+    _metrics->spillBytes.add(info->getRealEndPosition());
+    _metrics->addOutput(writer, metrics.compressTime);
+  }
+
+  const uint64_t M = 1000000; // million
+  LOG("%s-spill: { id: %d, collect: %" PRIu64 " ms, "
+      "in-memory sort: %" PRIu64 " ms, in-memory records: %" PRIu64 ", "
+      "merge&spill: %" PRIu64 " ms, uncompressed size: %" PRIu64 ", "
+      "real size: %" PRIu64 " path: %s }",
+      final ? "Final" : "Mid",
+      spillId,
+      collectTime / M,
+      metrics.sortTime  / M,
+      metrics.recordCount,
+      spillTime  / M,
+      info->getEndPosition(),
+      info->getRealEndPosition(),
+      spillOutput.c_str());
+
+  delete writer;
+  delete fout;
+  return info;
+}
+
+void MapOutputCollector::checkAsyncSpill() {
+  if (NULL != _spillTask && _spillTask->isFinished()) {
+    finishAsyncSpill();
+  }
+  if (NULL == _spillTask && _pool->getUsed() >= _spillThreshold) {
+    startAsyncSpill();
+  }
+  _lastPoolUsed = _pool->getUsed();
+}
+
+void MapOutputCollector::startAsyncSpill() {
+  // java callbacks are only allowed on the collecting thread
+  string * spillpath = _spillOutput->getSpillPath();
+  if (NULL == spillpath || spillpath->length() == 0) {
+    delete spillpath;
+    THROW_EXCEPTION(IOException, "Illegal(empty) spill files path");
+  }
+
+  uint64_t collecttime = _collectTimer.now() - _collectTimer.last();
+  std::swap(_buckets, _spillingBuckets);
+  _spillTask = new AsyncSpillTask(this, _spillingBuckets, *spillpath,
+      _spillInfos.getSpillCount(), collecttime, _pool->getUsed());
+  delete spillpath;
+  _spillThread->submit(_spillTask);
+  _collectTimer.reset();
+}
+
+void MapOutputCollector::finishAsyncSpill() {
+  AsyncSpillTask * task = _spillTask;
+  _spillTask = NULL;
+  try {
+    task->waitFinish();
+  } catch (...) {
+    delete task;
+    throw;
+  }
+  _spillInfos.add(task->info);
+  task->info = NULL;
+  for (uint32_t i = 0; i < _numPartitions; i++) {
+    _spillingBuckets[i]->reset();
+  }
+  _pool->release(task->poolUsed);
+  _lastPoolUsed = _pool->getUsed();
+  delete task;
+}
+
+OutputStream * MapOutputCollector::createSpillOutput(const std::string & path, bool final) {
+  if (_directSpill && !final) {
+    return FileSystem::getLocal().createDirect(path, true);
+  }
+  return FileSystem::getLocal().create(path, true);
+}
+
+IFileWriter * MapOutputCollector::createSpillWriter(const std::string & path, bool final) {
+  return new IFileWriter(createSpillOutput(path, final), _spec.checksumType, _spec.keyType,
+      _spec.valueType, _spec.codec, _spilledRecords, true);
+}
+
+MergeEntry * MapOutputCollector::createSpillMergeEntry(SingleSpillInfo * spill,
+    uint32_t startPartition, uint32_t endPartition) {
+  return IFileMergeEntry::create(spill, startPartition, endPartition, _ioThread, _readAheadSize,
+      _mmapSpills);
+}
+
+SingleSpillInfo * MapOutputCollector::mergeSpills(std::vector<SingleSpillInfo *> & spills,
+    const std::string & path) {
+  Timer timer;
+  IFileWriter * writer = createSpillWriter(path, false);
+  // combiner only runs in the final merge, as in the java MapTask
+  Merger * merger = new Merger(writer, _config, _keyComparator, NULL, _spec.mergeAlgorithm);
+  for (size_t i = 0; i < spills.size(); i++) {
+    merger->addMergeEntry(createSpillMergeEntry(spills[i]));
+  }
+  merger->merge();
+  delete merger;
+
+  if (NULL != _metrics) {
+    _metrics->mergeFanIn.add(spills.size());
+    _metrics->mergeBytes.add(SpillBytes(spills));
+    _metrics->addOutput(writer);
+  }
+  SingleSpillInfo * info = writer->getSpillInfo();
+  info->path = path;
+  delete writer;
+
+  const uint64_t M = 1000000; // million
+  LOG("Intermediate-merge: { inputs: %u, merge: %" PRIu64 " ms, uncompressed size: %" PRIu64 ", "
+      "real size: %" PRIu64 " path: %s }",
+      (uint32_t)spills.size(),
+      (timer.now() - timer.last()) / M,
+      info->getEndPosition(),
+      info->getRealEndPosition(),
+      path.c_str());
+  return info;
+}
+
+ThreadPool * MapOutputCollector::getMergePool() {
+  if (NULL == _mergePool) {
+    _mergePool = new ThreadPool(_mergeThreads);
+  }
+  return _mergePool;
+}
+
+void MapOutputCollector::reduceSpills() {
+  Timer timer;
+  std::vector<SingleSpillInfo *> & spills = _spillInfos.spills;
+  // the in-memory buckets are one more input of the final merge
+  while (spills.size() + 1 > _mergeFactor) {
+    std::sort(spills.begin(), spills.end(), SpillSizeLessThan());
+
+    // merge the smallest spills, no more of them than needed
+    std::vector<IntermediateMergeTask *> tasks;
+    uint32_t excess = spills.size() + 1 - _mergeFactor;
+    size_t merged = 0;
+    while (excess > 0 && spills.size() - merged >= 2) {
+      uint32_t groupSize = std::min(_mergeFactor, excess + 1);
+      groupSize = std::min(groupSize, (uint32_t)(spills.size() - merged));
+      string * path = _spillOutput->getSpillPath();
+      if (NULL == path || path->length() == 0) {
+        delete path;
+        for (size_t i = 0; i < tasks.size(); i++) {
+          delete tasks[i];
+        }
+        THROW_EXCEPTION(IOException, "Illegal(empty) spill files path");
+      }
+      IntermediateMergeTask * task = new IntermediateMergeTask(this, *path);
+      delete path;
+      task->spills.assign(spills.begin() + merged, spills.begin() + merged + groupSize);
+      tasks.push_back(task);
+      merged += groupSize;
+      excess -= groupSize - 1;
+    }
+
+    // every merge holds a read buffer per input plus its output buffer,
+    // run no more merges at once than the unused sort buffer can hold
+    uint64_t mergeMemory = (uint64_t)(_mergeFactor + 1) * MERGE_STREAM_BUFFER_SIZE;
+    if (_spec.codec.length() > 0) {
+      mergeMemory *= 2;
+    }
+    const uint64_t freeMemory = _pool->getCapacity() - _pool->getUsed();
+    uint32_t concurrency = (uint32_t)std::min((uint64_t)_mergeThreads,
+        std::max((uint64_t)1, freeMemory / mergeMemory));
+    concurrency = std::min(concurrency, (uint32_t)tasks.size());
+    LOG("Intermediate-merge round: { spills: %u, merges: %u, threads: %u }",
+        (uint32_t)spills.size(), (uint32_t)tasks.size(), concurrency);
+
+    size_t submitted = 0;
+    string error;
+    for (size_t i = 0; i < tasks.size(); i++) {
+      while (submitted < tasks.size() && submitted < i + concurrency) {
+        if (concurrency > 1) {
+          getMergePool()->submit(tasks[submitted]);
+        } else {
+          tasks[submitted]->run();
+        }
+        submitted++;
+      }
+      try {
+        tasks[i]->waitFinish();
+      } catch (std::exception & e) {
+        if (error.empty()) {
+          error = e.what();
+        }
+      }
+    }
+
+    if (!error.empty()) {
+      for (size_t i = 0; i < tasks.size(); i++) {
+        delete tasks[i];
+      }
+      THROW_EXCEPTION(IOException, error.c_str());
+    }
+
+    std::vector<SingleSpillInfo *> remain(spills.begin() + merged, spills.end());
+    for (size_t i = 0; i < merged; i++) {
+      spills[i]->deleteSpillFile();
+      delete spills[i];
+    }
+    for (size_t i = 0; i < tasks.size(); i++) {
+      remain.push_back(tasks[i]->info);
+      tasks[i]->info = NULL;
+      delete tasks[i];
+    }
+    spills.swap(remain);
+  }
+  _times.mergeTime += timer.now() - timer.last();
+}
+
+void MapOutputCollector::mergePartitionRange(uint32_t start, uint32_t end,
+    IFileWriter * writer) {
+  Merger * merger = new Merger(writer, _config, _keyComparator, NULL, _spec.mergeAlgorithm);
+  for (size_t i = 0; i < _spillInfos.getSpillCount(); i++) {
+    merger->addMergeEntry(createSpillMergeEntry(_spillInfos.getSingleSpillInfo(i), start, end));
+  }
+  merger->addMergeEntry(new MemoryMergeEntry(_buckets + start, end - start));
+  try {
+    merger->merge();
+  } catch (...) {
+    delete merger;
+    throw;
+  }
+  delete merger;
+}
+
+void MapOutputCollector::parallelFinalMerge(const std::string & filepath,
+    const std::string & idx_file_path) {
+  // split partitions into ranges of about the same spilled size
+  const uint32_t numRanges = std::min(_mergeThreads, _numPartitions);
+  std::vector<uint64_t> sizes(_numPartitions, 1);
+  uint64_t total = _numPartitions;
+  for (size_t i = 0; i < _spillInfos.getSpillCount(); i++) {
+    SingleSpillInfo * spill = _spillInfos.getSingleSpillInfo(i);
+    for (uint32_t p = 0; p < _numPartitions && p < spill->length; p++) {
+      uint64_t size = spill->segments[p].realEndOffset
+          - (p > 0 ? spill->segments[p - 1].realEndOffset : 0);
+      sizes[p] += size;
+      total += size;
+    }
+  }
+  std::vector<RangeMergeTask *> tasks;
+  uint32_t start = 0;
+  uint64_t accumulated = 0;
+  for (uint32_t p = 0; p < _numPartitions; p++) {
+    accumulated += sizes[p];
+    const uint32_t partitionsAfter = _numPartitions - p - 1;
+    const uint32_t rangesAfter = numRanges - tasks.size() - 1;
+    // leave at least one partition for each remaining range
+    if (partitionsAfter == 0 || (rangesAfter > 0 && (partitionsAfter == rangesAfter
+        || accumulated * numRanges >= total * (tasks.size() + 1)))) {
+      tasks.push_back(new RangeMergeTask(this, start, p + 1));
+      start = p + 1;
+    }
+  }
+
+  // first range is written to the output directly, the others to spill
+  // files which are appended afterwards
+  OutputStream * fout = createSpillOutput(filepath, true);
+  IFileWriter * writer = new IFileWriter(fout, _spec.checksumType, _spec.keyType, _spec.valueType,
+      _spec.codec, _spilledRecords);
+  tasks[0]->writer = writer;
+  for (size_t i = 1; i < tasks.size(); i++) {
+    string * path = _spillOutput->getSpillPath();
+    if (NULL == path || path->length() == 0) {
+      delete path;
+      for (size_t j = 0; j < tasks.size(); j++) {
+        delete tasks[j];
+      }
+      delete writer;
+      delete fout;
+      THROW_EXCEPTION(IOException, "Illegal(empty) spill files path");
+    }
+    tasks[i]->path = *path;
+    delete path;
+  }
+
+  Timer timer;
+  SortMetrics metrics;
+  sortPartitions(_buckets, _spec.sortOrder, _spec.sortAlgorithm, NULL, metrics);
+  _times.sortTime += metrics.sortTime;
+  Timer mergeTimer;
+
+  ThreadPool * mergePool = getMergePool();
+  for (size_t i = 0; i < tasks.size(); i++) {
+    mergePool->submit(tasks[i]);
+  }
+  string error;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    try {
+      tasks[i]->waitFinish();
+    } catch (std::exception & e) {
+      if (error.empty()) {
+        error = e.what();
+      }
+    }
+  }
+
+  if (NULL != _metrics) {
+    _metrics->mergeFanIn.add(_spillInfos.getSpillCount() + 1);
+    _metrics->mergeBytes.add(SpillBytes(_spillInfos.spills));
+    _metrics->addOutput(writer);
+  }
+
+  std::vector<IFileSegment> segments;
+  if (error.empty()) {
+    try {
+      const uint32_t COPY_BUFFER_SIZE = 1024 * 1024;
+      char * buffer = new char[COPY_BUFFER_SIZE];
+      IFileSegment base = {0, 0};
+      for (size_t i = 0; i < tasks.size(); i++) {
+        SingleSpillInfo * info = tasks[i]->info;
+        for (uint32_t j = 0; j < info->length; j++) {
+          IFileSegment segment = info->segments[j];
+          segment.uncompressedEndOffset += base.uncompressedEndOffset;
+          segment.realEndOffset += base.realEndOffset;
+          segments.push_back(segment);
+        }
+        if (segments.size() > 0) {
+          base = segments.back();
+        }
+        if (i > 0) {
+          InputStream * fin = FileSystem::getLocal().open(info->path);
+          int32_t read;
+          while ((read = fin->read(buffer, COPY_BUFFER_SIZE)) > 0) {
+            fout->write(buffer, read);
+          }
+          delete fin;
+          info->deleteSpillFile();
+        }
+      }
+      delete [] buffer;
+      fout->flush();
+    } catch (std::exception & e) {
+      error = e.what();
+    }
+  }
+  for (size_t i = 1; i < tasks.size(); i++) {
+    if (NULL != tasks[i]->info) {
+      tasks[i]->info->deleteSpillFile();
+    }
+  }
+  for (size_t i = 0; i < tasks.size(); i++) {
+    delete tasks[i];
+  }
+  delete writer;
+  delete fout;
+  if (!error.empty()) {
+    THROW_EXCEPTION(IOException, error);
+  }
+  _times.mergeTime += mergeTimer.now() - mergeTimer.last();
+
+  const uint64_t realOutputSize = segments.size() > 0 ? segments.back().realEndOffset : 0;
+  const uint64_t M = 1000000; // million
+  LOG("Final-merge-spill: { id: %d, in-memory sort: %" PRIu64 " ms, "
+      "in-memory records: %" PRIu64 ", merge&spill: %" PRIu64 " ms, ranges: %u, "
+      "uncompressed size: %" PRIu64 ", real size: %" PRIu64 " path: %s }",
+      _spillInfos.getSpillCount(),
+      metrics.sortTime / M,
+      metrics.recordCount,
+      (timer.now() - timer.last()) / M,
+      (uint32_t)tasks.size(),
+      segments.size() > 0 ? segments.back().uncompressedEndOffset : 0,
+      realOutputSize,
+      filepath.c_str());
+
+  _mapOutputMaterializedBytes->increase(realOutputSize);
+
+  IFileSegment * segmentArray = new IFileSegment[segments.size()];
+  std::copy(segments.begin(), segments.end(), segmentArray);
+  SingleSpillInfo * spill_range = new SingleSpillInfo(segmentArray, segments.size(), "",
+      _spec.checksumType, _spec.keyType, _spec.valueType, _spec.codec);
+  spill_range->writeSpillInfo(idx_file_path);
+  delete spill_range;
+  _spillInfos.deleteAllSpillFiles();
+  reset();
+}
+
 /**
  * final merge and/or spill, use previous spilled
  * file & in-memory data
@@ -342,32 +1345,52 @@ void MapOutputCollector::middleSpill(const std::string & spillOutput,
 void MapOutputCollector::finalSpill(const std::string & filepath,
     const std::string & idx_file_path) {
 
+  if (NULL != _spillTask) {
+    finishAsyncSpill();
+  }
+
   if (_spillInfos.getSpillCount() == 0) {
     middleSpill(filepath, idx_file_path, true);
     return;
   }
 
-  IFileWriter * writer = IFileWriter::create(filepath, _spec, _spilledRecords);
-  Merger * merger = new Merger(writer, _config, _keyComparator, _combineRunner);
+  reduceSpills();
+
+  if (_mergeThreads > 1 && _numPartitions > 1 && NULL == _combineRunner) {
+    // combiner may call back into java, keep it on the collecting thread
+    parallelFinalMerge(filepath, idx_file_path);
+    return;
+  }
+
+  IFileWriter * writer = createSpillWriter(filepath, true);
+  Merger * merger = new Merger(writer, _config, _keyComparator, _combineRunner,
+      _spec.mergeAlgorithm);
 
   for (size_t i = 0; i < _spillInfos.getSpillCount(); i++) {
     SingleSpillInfo * spill = _spillInfos.getSingleSpillInfo(i);
-    MergeEntryPtr pme = IFileMergeEntry::create(spill);
+    MergeEntryPtr pme = createSpillMergeEntry(spill);
     merger->addMergeEntry(pme);
   }
 
   SortMetrics metrics;
-  sortPartitions(_spec.sortOrder, _spec.sortAlgorithm, NULL, metrics);
+  sortPartitions(_buckets, _spec.sortOrder, _spec.sortAlgorithm, NULL, metrics);
 
   merger->addMergeEntry(new MemoryMergeEntry(_buckets, _numPartitions));
 
   Timer timer;
   merger->merge();
+  _times.sortTime += metrics.sortTime;
+  _times.mergeTime += timer.now() - timer.last();
 
   uint64_t outputSize;
   uint64_t realOutputSize;
   uint64_t recordCount;
   writer->getStatistics(outputSize, realOutputSize, recordCount);
+  if (NULL != _metrics) {
+    _metrics->mergeFanIn.add(_spillInfos.getSpillCount() + 1);
+    _metrics->mergeBytes.add(SpillBytes(_spillInfos.spills));
+    _metrics->addOutput(writer);
+  }
 
   const uint64_t M = 1000000; // million
   LOG("Final-merge-spill: { id: %d, in-memory sort: %"PRIu64" ms, "
@@ -404,6 +1427,12 @@ void MapOutputCollector::close() {
     THROW_EXCEPTION(IOException, "Illegal(empty) map output file/index path");
   }
 
+  if (NULL != _aggregator) {
+    flushAggregator();
+    LOG("Native hash aggregation: records %" PRIu64 ", flushes %" PRIu64,
+        _aggregator->getRecordCount(), _aggregator->getFlushCount());
+  }
+
   finalSpill(*outputpath, *indexpath);
 
   delete outputpath;
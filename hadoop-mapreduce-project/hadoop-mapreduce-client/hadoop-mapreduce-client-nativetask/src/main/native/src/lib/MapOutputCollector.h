@@ -28,7 +28,10 @@
 #include "lib/SpillInfo.h"
 #include "lib/Combiner.h"
 #include "lib/PartitionBucket.h"
+#include "lib/HashAggregator.h"
+#include "lib/Histogram.h"
 #include "lib/SpillOutputService.h"
+#include "util/SyncUtils.h"
 
 namespace NativeTask {
 /**
@@ -38,13 +41,73 @@ namespace NativeTask {
 struct SortMetrics {
   uint64_t recordCount;
   uint64_t sortTime;
+  // compressing partitions spilled by the sort workers
+  uint64_t compressTime;
 
 public:
   SortMetrics()
-      : recordCount(0), sortTime(0) {
+      : recordCount(0), sortTime(0), compressTime(0) {
   }
 };
 
+/**
+ * nanoseconds spent in each phase of the collector, summed over the task
+ */
+struct CollectorTimes {
+  // in-memory sort of spills and of the final merge, summed over the
+  // sort workers when sorting in parallel
+  uint64_t sortTime;
+  // writing sorted buckets to spill files, sort excluded
+  uint64_t spillTime;
+  // intermediate and final merges, sort excluded
+  uint64_t mergeTime;
+  // collect() blocked on spills to free the sort buffer
+  uint64_t midSpillTime;
+
+public:
+  CollectorTimes()
+      : sortTime(0), spillTime(0), mergeTime(0), midSpillTime(0) {
+  }
+};
+
+/**
+ * Histograms of the collector phases, exported as counters of GROUP.
+ * Only kept if native.collector.metrics is set, every bucket in use
+ * takes one of the job's counters (mapreduce.job.counters.max, 120 by
+ * default): each histogram has 5 buckets plus _COUNT and _SUM, so at
+ * most 6 * 7 = 42 counters, and 56 with a map output codec.
+ */
+class CollectorMetrics {
+public:
+  static const char * GROUP;
+
+  // duration of each sort & spill, ms
+  Histogram spillTime;
+  // sort time of each non empty partition, us
+  Histogram partitionSortTime;
+  // bytes written by each spill
+  Histogram spillBytes;
+  // inputs of each merge, the in-memory records count as one
+  Histogram mergeFanIn;
+  // spill bytes read by each merge
+  Histogram mergeBytes;
+  // time allocateKVBuffer waited for a spill, ms
+  Histogram allocateBlockedTime;
+  // compressed size in percent of the raw size, and compression time
+  // in ms, per spill or merge output; NULL without codec
+  Histogram * compressRatio;
+  Histogram * compressTime;
+
+  CollectorMetrics(const string & codec);
+
+  ~CollectorMetrics();
+
+  /**
+   * @param workerCompressTime spent by sort workers for the same output
+   */
+  void addOutput(IFileWriter * writer, uint64_t workerCompressTime = 0);
+};
+
 class CombineRunnerWrapper : public ICombineRunner {
 private:
   Config * _config;
@@ -65,15 +128,35 @@ public:
     }
   }
 
-  virtual void combine(CombineContext type, KVIterator * kvIterator, IFileWriter * writer);
+  /**
+   * create the native combiner now, if one is set, so that it can run
+   * on any thread from the start; a java combiner is only created by
+   * the first combine, on the collecting thread
+   * @return false if the combiner is not native
+   */
+  bool initNativeCombiner();
+
+  virtual void combine(CombineContext type, KVIterator * kvIterator, Collector * writer);
 
 private:
   ICombineRunner * createCombiner();
 };
 
+class AsyncSpillTask;
+class MergeEntry;
+class IntermediateMergeTask;
+class RangeMergeTask;
+
 class MapOutputCollector {
+  friend class AsyncSpillTask;
+  friend class IntermediateMergeTask;
+  friend class RangeMergeTask;
+
   static const uint32_t DEFAULT_MIN_BLOCK_SIZE = 16 * 1024;
   static const uint32_t DEFAULT_MAX_BLOCK_SIZE = 4 * 1024 * 1024;
+  static const uint32_t DEFAULT_MERGE_FACTOR = 10;
+  // read or write buffer of one merge input/output, doubled with a codec
+  static const uint32_t MERGE_STREAM_BUFFER_SIZE = 128 * 1024;
 
 private:
   Config * _config;
@@ -82,6 +165,10 @@ private:
   PartitionBucket ** _buckets;
 
   ComparatorPtr _keyComparator;
+  // UnknownType unless key type specific sort is allowed, see MemoryBlock::sort
+  KeyValueType _sortKeyType;
+  // sort each partition as a whole, see PartitionBucket
+  bool _wholePartitionSort;
 
   ICombineRunner * _combineRunner;
 
@@ -102,6 +189,44 @@ private:
 
   MemoryPool * _pool;
 
+  // workers for parallel per-partition sort & spill, NULL if disabled
+  ThreadPool * _sortPool;
+
+  // async spill: buckets being spilled by _spillThread, swapped with
+  // _buckets when a spill starts
+  bool _asyncSpill;
+  uint64_t _spillThreshold;
+  uint64_t _lastPoolUsed;
+  PartitionBucket ** _spillingBuckets;
+  ThreadPool * _spillThread;
+  AsyncSpillTask * _spillTask;
+
+  // max number of spills merged at once, see mapreduce.task.io.sort.factor
+  uint32_t _mergeFactor;
+  uint32_t _mergeThreads;
+  // runs the merges of all intermediate rounds and of the final merge,
+  // created on first use
+  ThreadPool * _mergePool;
+
+  // reads spills ahead during merges, NULL if disabled
+  ThreadPool * _ioThread;
+  uint32_t _readAheadSize;
+
+  // merges read uncompressed spills in place from a mapping
+  bool _mmapSpills;
+
+  // intermediate spill and merge files bypass the page cache, the
+  // final output stays cached for the shuffle handler
+  bool _directSpill;
+
+  // combines records before they reach the sort buffer, NULL if disabled
+  HashAggregator * _aggregator;
+
+  // NULL if disabled
+  CollectorMetrics * _metrics;
+
+  CollectorTimes _times;
+
 public:
   MapOutputCollector(uint32_t num_partition, SpillOutputService * spillService);
 
@@ -118,20 +243,76 @@ public:
 
   KVBuffer * allocateKVBuffer(uint32_t partitionId, uint32_t kvlength);
 
+  /**
+   * Shared buffers let the caller serialize records straight into the
+   * sort buffer: it fills the buffer with KVBufferWithParititionId
+   * records, lengths in host order, and hands it back through
+   * commitSharedBuffer, which indexes the records in place. Spills if
+   * the pool is full. Only one shared buffer may be outstanding, and
+   * allocateKVBuffer must not be used while it is.
+   * @param allocated at least minLength, up to expectLength bytes
+   * @return NULL if records have to go through allocateKVBuffer, which
+   *         is the case with hash aggregation
+   */
+  char * allocateSharedBuffer(uint32_t minLength, uint32_t expectLength, uint32_t & allocated);
+
+  /**
+   * @param length bytes of whole records written to buffer, the rest of
+   *        the allocated bytes is given back
+   */
+  void commitSharedBuffer(char * buffer, uint32_t allocated, uint32_t length);
+
   void close();
 
+  /**
+   * phase times so far, complete once close() returned
+   */
+  const CollectorTimes & getTimes() const {
+    return _times;
+  }
+
 private:
-  void init(uint32_t maxBlockSize, uint32_t memory_capacity, ComparatorPtr keyComparator,
+  void init(uint32_t maxBlockSize, uint64_t memory_capacity, ComparatorPtr keyComparator,
       ICombineRunner * combiner);
 
+  PartitionBucket ** createBuckets();
+
+  /**
+   * allocate from the partition's bucket, spills if the pool is full
+   */
+  KVBuffer * allocateFromBuckets(uint32_t partitionId, uint32_t kvlength);
+
+  /**
+   * called when the pool is full, frees memory by finishing the async
+   * spill in flight or by spilling what has been collected
+   * @return false if nothing could be freed
+   */
+  bool spillForSpace();
+
+  /**
+   * combine the records held by _aggregator and collect the output
+   * into the buckets
+   */
+  void flushAggregator();
+
+  void deleteBuckets(PartitionBucket ** buckets);
+
   void reset();
 
   /**
-   * spill a range of partition buckets, prepare for future
-   * Parallel sort & spill, TODO: parallel sort & spill
+   * sort all partition buckets, and spill them to writer if not NULL
    */
-  void sortPartitions(SortOrder orderType, SortAlgorithm sortType, IFileWriter * writer,
-      SortMetrics & metrics);
+  void sortPartitions(PartitionBucket ** buckets, SortOrder orderType, SortAlgorithm sortType,
+      IFileWriter * writer, SortMetrics & metrics);
+
+  /**
+   * sort partitions on _sortPool; without a combiner each worker also
+   * spills its partition to an in-memory segment, which is appended to
+   * writer in partition order so the output is identical to the
+   * sequential path
+   */
+  void parallelSortPartitions(PartitionBucket ** buckets, SortAlgorithm sortType,
+      IFileWriter * writer, SortMetrics & metrics);
 
   ComparatorPtr getComparator(Config * config, MapOutputSpec & spec);
 
@@ -139,9 +320,10 @@ private:
     return ((v + unit - 1) / unit) * unit;
   }
 
-  uint32_t getDefaultBlockSize(uint32_t memoryCapacity, uint32_t partitionNum,
+  uint32_t getDefaultBlockSize(uint64_t memoryCapacity, uint32_t partitionNum,
       uint32_t maxBlockSize) {
-    uint32_t defaultBlockSize = memoryCapacity / _numPartitions / 4;
+    uint64_t blockSize = memoryCapacity / _numPartitions / 4;
+    uint32_t defaultBlockSize = (uint32_t)std::min(blockSize, (uint64_t)maxBlockSize);
     defaultBlockSize = GetCeil(defaultBlockSize, DEFAULT_MIN_BLOCK_SIZE);
     defaultBlockSize = std::min(defaultBlockSize, maxBlockSize);
     return defaultBlockSize;
@@ -155,6 +337,69 @@ private:
    */
   void middleSpill(const std::string & spillOutput, const std::string & indexFilePath, bool final);
 
+  /**
+   * sort & write buckets to a new spill file, safe to call from the
+   * background spill thread
+   */
+  SingleSpillInfo * spillBuckets(PartitionBucket ** buckets, const std::string & spillOutput,
+      uint32_t spillId, uint64_t collectTime, bool final);
+
+  /**
+   * called before each allocation while async spill is enabled, it
+   * collects a finished spill and starts a new one once the pool is
+   * filled beyond the spill threshold
+   */
+  void checkAsyncSpill();
+
+  /**
+   * hand all collected data to the background spill thread, must only
+   * be called when every allocated KVBuffer has been filled
+   */
+  void startAsyncSpill();
+
+  /**
+   * wait for the in-flight spill and release its memory
+   */
+  void finishAsyncSpill();
+
+  /**
+   * create a spill, merge or final output file of this collector
+   * @param final the map output served by the shuffle handler, always
+   *              written through the page cache
+   */
+  OutputStream * createSpillOutput(const std::string & path, bool final);
+
+  IFileWriter * createSpillWriter(const std::string & path, bool final);
+
+  ThreadPool * getMergePool();
+
+  /**
+   * merge spill files into a new spill, without combiner, safe to call
+   * from any thread
+   */
+  MergeEntry * createSpillMergeEntry(SingleSpillInfo * spill, uint32_t startPartition = 0,
+      uint32_t endPartition = UINT32_MAX);
+
+  SingleSpillInfo * mergeSpills(std::vector<SingleSpillInfo *> & spills, const std::string & path);
+
+  /**
+   * run intermediate merges of the smallest spills until the final
+   * merge has no more than _mergeFactor inputs
+   */
+  void reduceSpills();
+
+  /**
+   * merge partitions [start, end) of all spills and the sorted in-memory
+   * buckets to writer, without combiner, safe to call from any thread
+   */
+  void mergePartitionRange(uint32_t start, uint32_t end, IFileWriter * writer);
+
+  /**
+   * final merge split into contiguous partition ranges merged on
+   * _mergeThreads threads, the ranges are concatenated into filepath
+   */
+  void parallelFinalMerge(const std::string & filepath, const std::string & indexpath);
+
   /**
    * final merge and/or spill use options in _config, and
    * previous spilled file & in-memory data
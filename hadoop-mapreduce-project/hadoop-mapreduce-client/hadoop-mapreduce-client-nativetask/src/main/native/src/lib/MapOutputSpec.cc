@@ -17,6 +17,7 @@
  */
 
 #include "lib/commons.h"
+#include "util/StringUtil.h"
 #include "lib/MapOutputSpec.h"
 #include "NativeTask.h"
 
@@ -30,16 +31,32 @@ void MapOutputSpec::getSpecFromConfig(Config * config, MapOutputSpec & spec) {
   string sortType = config->get(NATIVE_SORT_TYPE, "DUALPIVOTSORT");
   if (sortType == "DUALPIVOTSORT") {
     spec.sortAlgorithm = DUALPIVOTSORT;
+  } else if (sortType == "RADIXSORT") {
+    spec.sortAlgorithm = RADIXSORT;
   } else {
     spec.sortAlgorithm = CPPSORT;
   }
+  string mergeType = config->get(NATIVE_MERGE_TYPE, "LOSERTREE");
+  if (mergeType == "HEAP") {
+    spec.mergeAlgorithm = HEAPMERGE;
+  } else {
+    spec.mergeAlgorithm = LOSERTREEMERGE;
+  }
   if (config->get(MAPRED_COMPRESS_MAP_OUTPUT, "false") == "true") {
     spec.codec = config->get(MAPRED_MAP_OUTPUT_COMPRESSION_CODEC);
   } else {
     spec.codec = "";
   }
+  int64_t groupFieldLength = config->getInt(NATIVE_SORT_GROUP_FIELD_LENGTH, 0);
+  if (groupFieldLength < 0 || groupFieldLength > 0xffffffffLL) {
+    THROW_EXCEPTION_EX(IOException, "Invalid %s: %" PRId64, NATIVE_SORT_GROUP_FIELD_LENGTH,
+        groupFieldLength);
+  }
+  spec.groupFieldLength = (uint32_t)groupFieldLength;
   if (config->getBool(MAPRED_SORT_AVOID, false)) {
     spec.sortOrder = NOSORT;
+  } else if (spec.groupFieldLength > 0) {
+    spec.sortOrder = GROUPBY;
   } else {
     spec.sortOrder = FULLORDER;
   }
@@ -20,6 +20,7 @@
 #define MAPOUTPUTSPEC_H_
 
 #include <string>
+#include <string.h>
 #include "util/Checksum.h"
 #include "util/WritableUtils.h"
 #include "NativeTask.h"
@@ -35,6 +36,15 @@ enum SortAlgorithm {
   CQSORT = 0,
   CPPSORT = 1,
   DUALPIVOTSORT = 2,
+  RADIXSORT = 3,
+};
+
+/**
+ * k-way merge method, used when merging MemoryBlocks and spills
+ */
+enum MergeAlgorithm {
+  HEAPMERGE = 0,
+  LOSERTREEMERGE = 1,
 };
 
 /**
@@ -50,7 +60,8 @@ enum OutputFileType {
 /**
  * key/value recored order requirements
  * FULLSORT: hadoop  standard
- * GROUPBY:  same key are grouped together, but not in order
+ * GROUPBY:  secondary sort, keys are [group field][secondary field],
+ *           sorted like FULLORDER, and combined per group field
  * NOSORT:   no order at all
  */
 enum SortOrder {
@@ -70,10 +81,26 @@ public:
   KeyValueType valueType;
   SortOrder sortOrder;
   SortAlgorithm sortAlgorithm;
+  MergeAlgorithm mergeAlgorithm;
   string codec;
   ChecksumType checksumType;
+  // GROUPBY only: byte length of the group field at the start of each key
+  uint32_t groupFieldLength;
 
   static void getSpecFromConfig(Config * config, MapOutputSpec & spec);
+
+  /**
+   * @param groupLength keys are in one group if their first groupLength
+   *        bytes are equal, shorter keys and 0 compare the whole key
+   */
+  static bool sameGroup(const char * key1, uint32_t length1, const char * key2,
+      uint32_t length2, uint32_t groupLength) {
+    if (groupLength > 0) {
+      length1 = length1 < groupLength ? length1 : groupLength;
+      length2 = length2 < groupLength ? length2 : groupLength;
+    }
+    return length1 == length2 && 0 == memcmp(key1, key2, length1);
+  }
 };
 
 } // namespace NativeTask
@@ -48,20 +48,411 @@ KVBuffer * MemoryBlock::getKVBuffer(uint32_t index) {
   return kvbuffer;
 }
 
-void MemoryBlock::sort(SortAlgorithm type, ComparatorPtr comparator) {
-  if ((!_sorted) && (_kvOffsets.size() > 1)) {
-    switch (type) {
+static void buildPrefixIndex(const char * base, std::vector<uint32_t> & offsets,
+    KeyValueType keyType, std::vector<KVPrefixOffset> & index) {
+  index.resize(offsets.size());
+  for (size_t i = 0; i < offsets.size(); i++) {
+    KVBuffer * kv = (KVBuffer *)(base + offsets[i]);
+    index[i].prefix = KeyPrefix(keyType, kv->content, kv->keyLength);
+    index[i].offset = offsets[i];
+    index[i].keyLength = kv->keyLength;
+  }
+}
+
+/**
+ * Sort offsets by an index of (key prefix, offset), then write the
+ * sorted offsets back
+ */
+template<typename _KeyCompare>
+static void prefixSort(const char * base, std::vector<uint32_t> & offsets, SortAlgorithm type,
+    const _KeyCompare & comparator, KeyValueType keyType) {
+  std::vector<KVPrefixOffset> index;
+  buildPrefixIndex(base, offsets, keyType, index);
+
+  switch (type) {
+  case CPPSORT:
+    std::sort(index.begin(), index.end(),
+        ComparatorForPrefixStdSort<_KeyCompare>(base, comparator, keyType));
+    break;
+  case DUALPIVOTSORT:
+    DualPivotQuicksort(index,
+        ComparatorForPrefixDualPivotSort<_KeyCompare>(base, comparator, keyType));
+    break;
+  default:
+    THROW_EXCEPTION(UnsupportException, "Sort Algorithm not support");
+  }
+
+  for (size_t i = 0; i < index.size(); i++) {
+    offsets[i] = index[i].offset;
+  }
+}
+
+// below this size comparison sort beats another radix pass
+static const size_t RADIX_SORT_THRESHOLD = 64;
+
+class PrefixLessThan {
+public:
+  template<typename _Entry>
+  inline bool operator()(const _Entry & lhs, const _Entry & rhs) {
+    return lhs.prefix < rhs.prefix;
+  }
+};
+
+class KeyLengthLessThan {
+public:
+  inline bool operator()(const KVPrefixOffset & lhs, const KVPrefixOffset & rhs) {
+    return lhs.keyLength < rhs.keyLength;
+  }
+};
+
+class KeyEndsBefore {
+private:
+  uint32_t _depth;
+public:
+  KeyEndsBefore(uint32_t depth)
+      : _depth(depth) {
+  }
+
+  inline bool operator()(const KVPrefixOffset & entry) {
+    return entry.keyLength <= _depth;
+  }
+};
+
+/**
+ * compare byte keys known to share their first depth bytes
+ */
+template<typename _KeyCompare>
+class KeySuffixLessThan {
+private:
+  const char * _base;
+  uint32_t _depth;
+  _KeyCompare _keyComparator;
+public:
+  KeySuffixLessThan(const char * base, uint32_t depth, const _KeyCompare & comparator)
+      : _base(base), _depth(depth), _keyComparator(comparator) {
+  }
+
+  inline bool operator()(const KVPrefixOffset & lhs, const KVPrefixOffset & rhs) {
+    KVBuffer * left = (KVBuffer *)(_base + lhs.offset);
+    KVBuffer * right = (KVBuffer *)(_base + rhs.offset);
+    return _keyComparator(left->content + _depth, lhs.keyLength - _depth,
+        right->content + _depth, rhs.keyLength - _depth) < 0;
+  }
+};
+
+/**
+ * LSD radix sort on the 64 bit prefix, 8 bits per pass; passes where
+ * all entries share the same digit are skipped
+ */
+template<typename _Entry>
+static void radixSortByPrefix(_Entry * data, _Entry * temp, size_t length) {
+  if (length < RADIX_SORT_THRESHOLD) {
+    std::sort(data, data + length, PrefixLessThan());
+    return;
+  }
+
+  size_t counts[8][256];
+  memset(counts, 0, sizeof(counts));
+  for (size_t i = 0; i < length; i++) {
+    uint64_t prefix = data[i].prefix;
+    for (uint32_t digit = 0; digit < 8; digit++) {
+      counts[digit][(prefix >> (digit * 8)) & 0xff]++;
+    }
+  }
+
+  _Entry * src = data;
+  _Entry * dest = temp;
+  for (uint32_t digit = 0; digit < 8; digit++) {
+    const uint32_t shift = digit * 8;
+    size_t * count = counts[digit];
+    if (count[(src[0].prefix >> shift) & 0xff] == length) {
+      continue;
+    }
+    size_t position = 0;
+    for (uint32_t i = 0; i < 256; i++) {
+      size_t c = count[i];
+      count[i] = position;
+      position += c;
+    }
+    for (size_t i = 0; i < length; i++) {
+      dest[count[(src[i].prefix >> shift) & 0xff]++] = src[i];
+    }
+    std::swap(src, dest);
+  }
+  if (src != data) {
+    memcpy(data, src, length * sizeof(_Entry));
+  }
+}
+
+/**
+ * MSD radix sort for byte keys, entries' prefixes hold key bytes
+ * [depth, depth + 8) and all keys share their first depth bytes
+ */
+template<typename _KeyCompare>
+static void radixSortBytes(const char * base, KVPrefixOffset * data, KVPrefixOffset * temp,
+    size_t length, uint32_t depth, const _KeyCompare & comparator) {
+  radixSortByPrefix(data, temp, length);
+
+  const uint32_t nextDepth = depth + 8;
+  size_t start = 0;
+  while (start < length) {
+    size_t end = start + 1;
+    while (end < length && data[end].prefix == data[start].prefix) {
+      end++;
+    }
+    if (end - start > 1) {
+      // zero padding makes a key ending in this window a prefix of the
+      // other keys in the run, so those keys go first, shortest first
+      KVPrefixOffset * first = data + start;
+      KVPrefixOffset * last = data + end;
+      KVPrefixOffset * middle = std::partition(first, last, KeyEndsBefore(nextDepth));
+      if (middle - first > 1) {
+        std::sort(first, middle, KeyLengthLessThan());
+      }
+      size_t remain = last - middle;
+      if (remain > 1) {
+        if (remain < RADIX_SORT_THRESHOLD) {
+          std::sort(middle, last, KeySuffixLessThan<_KeyCompare>(base, nextDepth, comparator));
+        } else {
+          for (KVPrefixOffset * entry = middle; entry < last; entry++) {
+            KVBuffer * kv = (KVBuffer *)(base + entry->offset);
+            entry->prefix = KeyPrefix(BytesType, kv->content + nextDepth,
+                entry->keyLength - nextDepth);
+          }
+          radixSortBytes(base, middle, temp + (middle - data), remain, nextDepth, comparator);
+        }
+      }
+    }
+    start = end;
+  }
+}
+
+template<typename _KeyCompare>
+static void radixSort(const char * base, std::vector<uint32_t> & offsets,
+    const _KeyCompare & comparator, KeyValueType keyType) {
+  std::vector<KVPrefixOffset> index;
+  buildPrefixIndex(base, offsets, keyType, index);
+  std::vector<KVPrefixOffset> temp(index.size());
+
+  if (keyType == BytesType || keyType == TextType) {
+    radixSortBytes(base, &index[0], &temp[0], index.size(), 0, comparator);
+  } else {
+    radixSortByPrefix(&index[0], &temp[0], index.size());
+  }
+
+  for (size_t i = 0; i < index.size(); i++) {
+    offsets[i] = index[i].offset;
+  }
+}
+
+/**
+ * Sorts one MemoryBlock's offsets, instantiated per key comparator by
+ * DispatchKeyComparator
+ */
+class SortOffsets {
+private:
+  const char * _base;
+  std::vector<uint32_t> & _offsets;
+  SortAlgorithm _type;
+  KeyValueType _keyType;
+public:
+  SortOffsets(const char * base, std::vector<uint32_t> & offsets, SortAlgorithm type,
+      KeyValueType keyType)
+      : _base(base), _offsets(offsets), _type(type), _keyType(keyType) {
+  }
+
+  template<typename _KeyCompare>
+  void operator()(const _KeyCompare & comparator) {
+    if (SupportKeyPrefix(_keyType)) {
+      if (_type == RADIXSORT) {
+        radixSort(_base, _offsets, comparator, _keyType);
+      } else {
+        prefixSort(_base, _offsets, _type, comparator, _keyType);
+      }
+      return;
+    }
+    switch (_type) {
     case CPPSORT:
-      std::sort(_kvOffsets.begin(), _kvOffsets.end(), ComparatorForStdSort(_base, comparator));
+      std::sort(_offsets.begin(), _offsets.end(),
+          BasicComparatorForStdSort<_KeyCompare>(_base, comparator));
       break;
+    case RADIXSORT:
+      // no radix key for this key type or comparator
     case DUALPIVOTSORT: {
-      DualPivotQuicksort(_kvOffsets, ComparatorForDualPivotSort(_base, comparator));
+      DualPivotQuicksort(_offsets, BasicComparatorForDualPivotSort<_KeyCompare>(_base, comparator));
     }
       break;
     default:
       THROW_EXCEPTION(UnsupportException, "Sort Algorithm not support");
     }
   }
+};
+
+void MemoryBlock::sort(SortAlgorithm type, ComparatorPtr comparator, KeyValueType keyType) {
+  if ((!_sorted) && (_kvOffsets.size() > 1)) {
+    SortOffsets sortOffsets(_base, _kvOffsets, type, keyType);
+    DispatchKeyComparator(comparator, sortOffsets);
+  }
   _sorted = true;
 }
+/**
+ * Partition-wide sort index entry, like KVPrefixOffset but pointing
+ * to a KVBuffer in any MemoryBlock
+ */
+struct KVPrefixPointer {
+  uint64_t prefix;
+  KVBuffer * kv;
+};
+
+template<typename _KeyCompare>
+class ComparatorForKVPointer {
+private:
+  _KeyCompare _keyComparator;
+public:
+  ComparatorForKVPointer(const _KeyCompare & comparator)
+      : _keyComparator(comparator) {
+  }
+
+  inline int operator()(KVBuffer * lhs, KVBuffer * rhs) {
+    return _keyComparator(lhs->content, lhs->keyLength, rhs->content, rhs->keyLength);
+  }
+};
+
+template<typename _KeyCompare>
+class ComparatorForKVPrefixPointer {
+private:
+  _KeyCompare _keyComparator;
+  bool _byteKey;
+public:
+  ComparatorForKVPrefixPointer(const _KeyCompare & comparator, KeyValueType keyType)
+      : _keyComparator(comparator), _byteKey(keyType == BytesType || keyType == TextType) {
+  }
+
+  inline int operator()(const KVPrefixPointer & lhs, const KVPrefixPointer & rhs) {
+    if (lhs.prefix != rhs.prefix) {
+      return lhs.prefix < rhs.prefix ? -1 : 1;
+    }
+    if (!_byteKey) {
+      return 0;
+    }
+    KVBuffer * left = lhs.kv;
+    KVBuffer * right = rhs.kv;
+    if (left->keyLength >= 8 && right->keyLength >= 8) {
+      // first 8 bytes are known to be equal
+      return _keyComparator(left->content + 8, left->keyLength - 8, right->content + 8,
+          right->keyLength - 8);
+    }
+    return _keyComparator(left->content, left->keyLength, right->content, right->keyLength);
+  }
+};
+
+/**
+ * adapts a three-way comparator to std::sort
+ */
+template<typename _Compare>
+class LessThan {
+private:
+  _Compare _compare;
+public:
+  LessThan(const _Compare & compare)
+      : _compare(compare) {
+  }
+
+  template<typename _Tp>
+  inline bool operator()(const _Tp & lhs, const _Tp & rhs) {
+    return _compare(lhs, rhs) < 0;
+  }
+};
+
+template<typename _KeyCompare>
+static void prefixSortKVBuffers(std::vector<KVBuffer *> & kvs, SortAlgorithm type,
+    const _KeyCompare & comparator, KeyValueType keyType) {
+  std::vector<KVPrefixPointer> index(kvs.size());
+  for (size_t i = 0; i < kvs.size(); i++) {
+    index[i].prefix = KeyPrefix(keyType, kvs[i]->content, kvs[i]->keyLength);
+    index[i].kv = kvs[i];
+  }
+
+  typedef ComparatorForKVPrefixPointer<_KeyCompare> Compare;
+  Compare compare(comparator, keyType);
+  switch (type) {
+  case CPPSORT:
+    std::sort(index.begin(), index.end(), LessThan<Compare>(compare));
+    break;
+  case DUALPIVOTSORT:
+    DualPivotQuicksort(index, compare);
+    break;
+  case RADIXSORT: {
+    std::vector<KVPrefixPointer> temp(index.size());
+    radixSortByPrefix(&index[0], &temp[0], index.size());
+    if (keyType == BytesType || keyType == TextType) {
+      // keys are only ordered by their first 8 bytes so far
+      LessThan<Compare> lessThan(compare);
+      size_t start = 0;
+      while (start < index.size()) {
+        size_t end = start + 1;
+        while (end < index.size() && index[end].prefix == index[start].prefix) {
+          end++;
+        }
+        if (end - start > 1) {
+          std::sort(index.begin() + start, index.begin() + end, lessThan);
+        }
+        start = end;
+      }
+    }
+  }
+    break;
+  default:
+    THROW_EXCEPTION(UnsupportException, "Sort Algorithm not support");
+  }
+
+  for (size_t i = 0; i < index.size(); i++) {
+    kvs[i] = index[i].kv;
+  }
+}
+
+/**
+ * Sorts a partition's KVBuffers, instantiated per key comparator by
+ * DispatchKeyComparator
+ */
+class SortKVPointers {
+private:
+  std::vector<KVBuffer *> & _kvs;
+  SortAlgorithm _type;
+  KeyValueType _keyType;
+public:
+  SortKVPointers(std::vector<KVBuffer *> & kvs, SortAlgorithm type, KeyValueType keyType)
+      : _kvs(kvs), _type(type), _keyType(keyType) {
+  }
+
+  template<typename _KeyCompare>
+  void operator()(const _KeyCompare & comparator) {
+    if (SupportKeyPrefix(_keyType)) {
+      prefixSortKVBuffers(_kvs, _type, comparator, _keyType);
+      return;
+    }
+    typedef ComparatorForKVPointer<_KeyCompare> Compare;
+    switch (_type) {
+    case CPPSORT:
+      std::sort(_kvs.begin(), _kvs.end(), LessThan<Compare>(Compare(comparator)));
+      break;
+    case RADIXSORT:
+    case DUALPIVOTSORT:
+      DualPivotQuicksort(_kvs, Compare(comparator));
+      break;
+    default:
+      THROW_EXCEPTION(UnsupportException, "Sort Algorithm not support");
+    }
+  }
+};
+
+void SortKVBuffers(std::vector<KVBuffer *> & kvs, SortAlgorithm type, ComparatorPtr comparator,
+    KeyValueType keyType) {
+  if (kvs.size() <= 1) {
+    return;
+  }
+  SortKVPointers sortKVPointers(kvs, type, keyType);
+  DispatchKeyComparator(comparator, sortKVPointers);
+}
+
 } // namespace NativeTask
@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 #include "commons.h"
+#include "lib/KeyComparators.h"
 
 #ifndef MEMORYBLOCK_H_
 #define MEMORYBLOCK_H_
@@ -24,28 +25,36 @@ namespace NativeTask {
 
 class MemoryPool;
 
-class ComparatorForDualPivotSort {
+/**
+ * Sort comparators are templates on the key comparator, see
+ * KeyComparators.h; the plain names take a ComparatorPtr
+ */
+template<typename _KeyCompare>
+class BasicComparatorForDualPivotSort {
 private:
   const char * _base;
-  ComparatorPtr _keyComparator;
+  _KeyCompare _keyComparator;
 public:
-  ComparatorForDualPivotSort(const char * base, ComparatorPtr comparator)
+  BasicComparatorForDualPivotSort(const char * base, const _KeyCompare & comparator)
       : _base(base), _keyComparator(comparator) {
   }
 
   inline int operator()(uint32_t lhs, uint32_t rhs) {
     KVBuffer * left = (KVBuffer *)(_base + lhs);
     KVBuffer * right = (KVBuffer *)(_base + rhs);
-    return (*_keyComparator)(left->content, left->keyLength, right->content, right->keyLength);
+    return _keyComparator(left->content, left->keyLength, right->content, right->keyLength);
   }
 };
 
-class ComparatorForStdSort {
+typedef BasicComparatorForDualPivotSort<DynamicKeyComparator> ComparatorForDualPivotSort;
+
+template<typename _KeyCompare>
+class BasicComparatorForStdSort {
 private:
   const char * _base;
-  ComparatorPtr _keyComparator;
+  _KeyCompare _keyComparator;
 public:
-  ComparatorForStdSort(const char * base, ComparatorPtr comparator)
+  BasicComparatorForStdSort(const char * base, const _KeyCompare & comparator)
       : _base(base), _keyComparator(comparator) {
   }
 
@@ -53,11 +62,130 @@ public:
   inline bool operator()(uint32_t lhs, uint32_t rhs) {
     KVBuffer * left = (KVBuffer *)(_base + lhs);
     KVBuffer * right = (KVBuffer *)(_base + rhs);
-    int ret = (*_keyComparator)(left->getKey(), left->keyLength, right->getKey(), right->keyLength);
+    int ret = _keyComparator(left->getKey(), left->keyLength, right->getKey(), right->keyLength);
     return ret < 0;
   }
 };
 
+typedef BasicComparatorForStdSort<DynamicKeyComparator> ComparatorForStdSort;
+
+/**
+ * Sort index entry, keeps a normalized key prefix next to the KVBuffer
+ * offset so most comparisons never touch the KVBuffer itself
+ */
+struct KVPrefixOffset {
+  uint64_t prefix;
+  uint32_t offset;
+  uint32_t keyLength;
+};
+
+/**
+ * @return true if keys of keyType, ordered by their built-in
+ *         comparator, can be sorted by KeyPrefix()
+ */
+inline bool SupportKeyPrefix(KeyValueType keyType) {
+  switch (keyType) {
+  case BytesType:
+  case TextType:
+  case IntType:
+  case LongType:
+  case FloatType:
+  case DoubleType:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * Unsigned 64 bit prefix of a key, ordered the same way as the built-in
+ * comparator of keyType. Int/Long/Float/Double keys are fully represented
+ * (-0.0 is ordered before 0.0, NaNs after infinity); for byte keys the
+ * first 8 bytes are used, zero padded, and equal prefixes need a full
+ * compare.
+ */
+inline uint64_t KeyPrefix(KeyValueType keyType, const char * key, uint32_t keyLength) {
+  switch (keyType) {
+  case IntType:
+    return (uint64_t)(bswap(*(const uint32_t*)key) ^ 0x80000000U);
+  case LongType:
+    return bswap64(*(const uint64_t*)key) ^ 0x8000000000000000ULL;
+  case FloatType: {
+    uint32_t bits = bswap(*(const uint32_t*)key);
+    return (uint64_t)((bits & 0x80000000U) ? ~bits : (bits ^ 0x80000000U));
+  }
+  case DoubleType: {
+    uint64_t bits = bswap64(*(const uint64_t*)key);
+    return (bits & 0x8000000000000000ULL) ? ~bits : (bits ^ 0x8000000000000000ULL);
+  }
+  default:
+    if (keyLength >= 8) {
+      return bswap64(*(const uint64_t*)key);
+    } else {
+      uint64_t prefix = 0;
+      memcpy(&prefix, key, keyLength);
+      return bswap64(prefix);
+    }
+  }
+}
+
+template<typename _KeyCompare>
+class ComparatorForPrefixSort {
+private:
+  const char * _base;
+  _KeyCompare _keyComparator;
+  bool _byteKey;
+public:
+  ComparatorForPrefixSort(const char * base, const _KeyCompare & comparator,
+      KeyValueType keyType)
+      : _base(base), _keyComparator(comparator),
+          _byteKey(keyType == BytesType || keyType == TextType) {
+  }
+
+  inline int compare(const KVPrefixOffset & lhs, const KVPrefixOffset & rhs) {
+    if (lhs.prefix != rhs.prefix) {
+      return lhs.prefix < rhs.prefix ? -1 : 1;
+    }
+    if (!_byteKey) {
+      return 0;
+    }
+    KVBuffer * left = (KVBuffer *)(_base + lhs.offset);
+    KVBuffer * right = (KVBuffer *)(_base + rhs.offset);
+    if (lhs.keyLength >= 8 && rhs.keyLength >= 8) {
+      // first 8 bytes are known to be equal
+      return _keyComparator(left->content + 8, lhs.keyLength - 8, right->content + 8,
+          rhs.keyLength - 8);
+    }
+    return _keyComparator(left->content, lhs.keyLength, right->content, rhs.keyLength);
+  }
+};
+
+template<typename _KeyCompare>
+class ComparatorForPrefixDualPivotSort : public ComparatorForPrefixSort<_KeyCompare> {
+public:
+  ComparatorForPrefixDualPivotSort(const char * base, const _KeyCompare & comparator,
+      KeyValueType keyType)
+      : ComparatorForPrefixSort<_KeyCompare>(base, comparator, keyType) {
+  }
+
+  inline int operator()(const KVPrefixOffset & lhs, const KVPrefixOffset & rhs) {
+    return this->compare(lhs, rhs);
+  }
+};
+
+template<typename _KeyCompare>
+class ComparatorForPrefixStdSort : public ComparatorForPrefixSort<_KeyCompare> {
+public:
+  ComparatorForPrefixStdSort(const char * base, const _KeyCompare & comparator,
+      KeyValueType keyType)
+      : ComparatorForPrefixSort<_KeyCompare>(base, comparator, keyType) {
+  }
+
+  inline bool operator()(const KVPrefixOffset & lhs, const KVPrefixOffset & rhs) {
+    return this->compare(lhs, rhs) < 0;
+  }
+};
+
 class MemoryBlock {
 private:
   char * _base;
@@ -89,20 +217,49 @@ public:
     return (KVBuffer *)space;
   }
 
+  /**
+   * index a KVBuffer written in place at offset, for blocks created with
+   * size 0 over a buffer shared by several partitions; such a block
+   * has no remaining space, so nothing is ever allocated from it
+   */
+  void addKVBuffer(uint32_t offset, uint32_t length) {
+    _sorted = false;
+    _kvOffsets.push_back(offset);
+    _position += length;
+    _size = _position;
+  }
+
   uint32_t remainSpace() const {
     return _size - _position;
   }
 
+  uint32_t usedSpace() const {
+    return _position;
+  }
+
   uint32_t getKVCount() {
     return _kvOffsets.size();
   }
 
   KVBuffer * getKVBuffer(uint32_t index);
 
-  void sort(SortAlgorithm type, ComparatorPtr comparator);
+  /**
+   * @param keyType if not UnknownType, comparator is the built-in
+   *        comparator of keyType, and a key prefix index is used
+   *        when SupportKeyPrefix(keyType). RADIXSORT requires such a
+   *        keyType, otherwise DUALPIVOTSORT is used instead.
+   */
+  void sort(SortAlgorithm type, ComparatorPtr comparator, KeyValueType keyType = UnknownType);
 };
 //class MemoryBlock
 
+/**
+ * Sort KVBuffers from any number of MemoryBlocks as a single sequence,
+ * arguments are the same as MemoryBlock::sort
+ */
+void SortKVBuffers(std::vector<KVBuffer *> & kvs, SortAlgorithm type, ComparatorPtr comparator,
+    KeyValueType keyType = UnknownType);
+
 class MemBlockIterator {
 private:
   MemoryBlock * _memBlock;
@@ -141,7 +298,7 @@ typedef MemBlockIterator * MemBlockIteratorPtr;
 
 class MemBlockComparator {
 private:
-  ComparatorPtr _keyComparator;
+  KeyComparator _keyComparator;
 
 public:
   MemBlockComparator(ComparatorPtr comparator)
@@ -163,7 +320,7 @@ public:
       return true;
     }
 
-    return (*_keyComparator)(left->content, left->keyLength, right->content, right->keyLength) < 0;
+    return _keyComparator(left->content, left->keyLength, right->content, right->keyLength) < 0;
   }
 };
 
@@ -0,0 +1,205 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "util/SyncUtils.h"
+#include "lib/MemoryPool.h"
+
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23
+#endif
+
+namespace NativeTask {
+
+static const uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static const uint64_t PREFAULT_CHUNK_SIZE = 64 * 1024 * 1024;
+// distance kept from the allocation mark, the collector faults in
+// pages below it itself
+static const uint64_t PREFAULT_GAP = 2 * 1024 * 1024;
+
+/**
+ * Faults in the pages of the pool ahead of the collector, without
+ * changing their content. Only pages past the allocation mark are
+ * touched, so it does not contend for the cache lines being filled.
+ */
+class PrefaultThread : public Thread {
+private:
+  char * _base;
+  uint64_t _length;
+  volatile uint64_t * _mark;
+  volatile bool * _stop;
+public:
+  PrefaultThread(char * base, uint64_t length, volatile uint64_t * mark, volatile bool * stop)
+      : _base(base), _length(length), _mark(mark), _stop(stop) {
+  }
+
+  virtual void run() {
+    const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t pageMask = (uintptr_t)(pageSize - 1);
+    bool populate = true;
+    for (uint64_t offset = 0; offset < _length && !*_stop; offset += PREFAULT_CHUNK_SIZE) {
+      const uint64_t end = std::min(offset + PREFAULT_CHUNK_SIZE, _length);
+      uint64_t start = std::max(offset, *_mark + PREFAULT_GAP);
+      // first page boundary from start
+      start += (pageSize - (((uintptr_t)(_base + start)) & pageMask)) & pageMask;
+      if (start >= end) {
+        continue;
+      }
+#ifdef MADV_POPULATE_WRITE
+      if (populate && 0 == madvise(_base + start, end - start, MADV_POPULATE_WRITE)) {
+        continue;
+      }
+#endif
+      // kernel before 5.14
+      populate = false;
+      for (uint64_t i = start; i < end && !*_stop; i += pageSize) {
+        if (i < *_mark + PREFAULT_GAP) {
+          continue;
+        }
+        // adding 0 atomically does not race with the collector's writes
+        __sync_fetch_and_add(_base + i, (char)0);
+      }
+    }
+  }
+};
+
+/**
+ * Prefer the NUMA node of the calling thread for the pages of this
+ * range, pages not faulted in yet are then allocated there
+ */
+static void bindLocalNode(char * base, uint64_t length) {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+  const int MPOL_PREFERRED = 1;
+  const uint32_t MAX_NODES = 1024;
+  const uint32_t BITS = sizeof(unsigned long) * 8;
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (0 != syscall(SYS_getcpu, &cpu, &node, NULL) || node >= MAX_NODES) {
+    LOG("MemoryPool: failed to get the NUMA node of the current thread");
+    return;
+  }
+  // mbind needs a page aligned start, malloc'ed memory is not
+  const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+  char * start = (char *)((((uintptr_t)base) + pageSize - 1) & ~(uintptr_t)(pageSize - 1));
+  if (start >= base + length) {
+    return;
+  }
+  unsigned long nodemask[MAX_NODES / BITS];
+  memset(nodemask, 0, sizeof(nodemask));
+  nodemask[node / BITS] |= 1UL << (node % BITS);
+  if (0 != syscall(SYS_mbind, start, (unsigned long)(base + length - start), MPOL_PREFERRED,
+      nodemask, (unsigned long)MAX_NODES, 0)) {
+    LOG("MemoryPool: mbind to NUMA node %u failed: %s", node, strerror(errno));
+    return;
+  }
+  LOG("MemoryPool: prefer NUMA node %u", node);
+#else
+  LOG("MemoryPool: NUMA binding not supported on this platform");
+#endif
+}
+
+MemoryPool::MemoryPool()
+    : _base(NULL), _capacity(0), _used(0), _head(0), _mapped(0), _mark(0),
+        _policy(MALLOC_MEMORY),
+        _numaLocal(false), _prefault(false), _prefaultThread(NULL), _stopPrefault(false) {
+}
+
+MemoryPool::~MemoryPool() {
+  freeMemory();
+}
+
+void MemoryPool::freeMemory() {
+  if (NULL != _prefaultThread) {
+    _stopPrefault = true;
+    _prefaultThread->join();
+    delete _prefaultThread;
+    _prefaultThread = NULL;
+  }
+  if (NULL != _base) {
+    if (_mapped > 0) {
+      munmap(_base, _mapped);
+    } else {
+      free(_base);
+    }
+    _base = NULL;
+  }
+  _mapped = 0;
+  _capacity = 0;
+}
+
+char * MemoryPool::mapMemory(uint64_t capacity) {
+  const uint64_t length = (capacity + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  void * base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (_policy == HUGETLB_MEMORY) {
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+        -1, 0);
+    if (MAP_FAILED == base) {
+      LOG("MemoryPool: no hugetlbfs pages for %" PRIu64 " bytes, use transparent huge pages",
+          length);
+    }
+  }
+#endif
+  if (MAP_FAILED == base) {
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == base) {
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (0 != madvise(base, length, MADV_HUGEPAGE)) {
+      LOG("MemoryPool: madvise(MADV_HUGEPAGE) failed: %s", strerror(errno));
+    }
+#endif
+  }
+  _mapped = length;
+  return (char *)base;
+}
+
+void MemoryPool::init(uint64_t capacity) throw (OutOfMemoryException) {
+  if (capacity > _capacity) {
+    freeMemory();
+    if (_policy == MALLOC_MEMORY) {
+      _base = (char*)malloc((size_t)capacity);
+    } else {
+      _base = mapMemory(capacity);
+    }
+    if (NULL == _base) {
+      THROW_EXCEPTION(OutOfMemoryException, "Not enough memory to init MemoryBlockPool");
+    }
+    _capacity = capacity;
+    if (_numaLocal) {
+      bindLocalNode(_base, _capacity);
+    }
+    _mark = 0;
+    if (_prefault) {
+      _stopPrefault = false;
+      _prefaultThread = new PrefaultThread(_base, _capacity, &_mark, &_stopPrefault);
+      _prefaultThread->start();
+    }
+  }
+  reset();
+}
+
+} // namespace NativeTask
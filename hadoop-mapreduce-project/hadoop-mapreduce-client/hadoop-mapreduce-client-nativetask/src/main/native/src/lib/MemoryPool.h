@@ -26,63 +26,156 @@
 
 namespace NativeTask {
 
+class Thread;
+
+/**
+ * How MemoryPool gets its memory from the system
+ */
+enum MemoryPolicy {
+  // plain malloc
+  MALLOC_MEMORY = 0,
+  // anonymous mmap advised to use transparent huge pages
+  HUGEPAGE_MEMORY = 1,
+  // mmap from the reserved hugetlbfs pages, HUGEPAGE_MEMORY if none left
+  HUGETLB_MEMORY = 2,
+};
+
 /**
  * Class for allocating memory buffer
+ *
+ * Buffers are handed out from a ring: release() gives back the oldest
+ * allocated bytes, so new buffers can be allocated while older ones
+ * are still in use, e.g. by a background spill.
+ *
+ * The pool is addressed with 64 bit offsets so io.sort.mb can exceed
+ * 4GB; single buffers stay below 4GB, MemoryBlock indexes records by
+ * 32 bit offsets relative to its own buffer.
  */
 
 class MemoryPool {
 private:
   char * _base;
-  uint32_t _capacity;
-  uint32_t _used;
+  uint64_t _capacity;
+  // bytes held since the last release, including skipped tail gaps
+  uint64_t _used;
+  // offset of the next allocation
+  uint64_t _head;
+  // length of the mapping if _base is from mmap, otherwise 0
+  uint64_t _mapped;
+  // highest _head since init, the prefault thread stays beyond it
+  volatile uint64_t _mark;
+
+  MemoryPolicy _policy;
+  bool _numaLocal;
+  bool _prefault;
+  Thread * _prefaultThread;
+  volatile bool _stopPrefault;
 
 public:
 
-  MemoryPool()
-      : _base(NULL), _capacity(0), _used(0) {
-  }
+  MemoryPool();
 
-  ~MemoryPool() {
-    if (NULL != _base) {
-      free(_base);
-      _base = NULL;
-    }
+  ~MemoryPool();
+
+  /**
+   * set how the next init() allocates the pool
+   * @param numaLocal prefer the NUMA node of the calling thread
+   * @param prefault fault the pages in on a background thread, so
+   *                 the first records do not pay for it
+   */
+  void setPolicy(MemoryPolicy policy, bool numaLocal, bool prefault) {
+    _policy = policy;
+    _numaLocal = numaLocal;
+    _prefault = prefault;
   }
 
-  void init(uint32_t capacity) throw (OutOfMemoryException) {
-    if (capacity > _capacity) {
-      if (NULL != _base) {
-        free(_base);
-        _base = NULL;
-      }
-      _base = (char*)malloc(capacity);
-      if (NULL == _base) {
-        THROW_EXCEPTION(OutOfMemoryException, "Not enough memory to init MemoryBlockPool");
-      }
-      _capacity = capacity;
-    }
-    reset();
+  MemoryPolicy getPolicy() const {
+    return _policy;
   }
 
+  void init(uint64_t capacity) throw (OutOfMemoryException);
+
   void reset() {
     _used = 0;
+    _head = 0;
+  }
+
+  uint64_t getCapacity() const {
+    return _capacity;
+  }
+
+  uint64_t getUsed() const {
+    return _used;
   }
 
-  char * allocate(uint32_t min, uint32_t expect, uint32_t & allocated) {
-    if (_used + min > _capacity) {
+  /**
+   * give back the oldest <code>length</code> bytes, length should be
+   * a value returned by getUsed() before any later allocation
+   */
+  void release(uint64_t length) {
+    _used -= std::min(length, _used);
+    if (_used == 0) {
+      _head = 0;
+    }
+  }
+
+  /**
+   * @param takeRemain if less than expect is left, allocate all of it
+   *        instead of just min
+   */
+  char * allocate(uint32_t min, uint32_t expect, uint32_t & allocated, bool takeRemain = false) {
+    if (_used == _capacity) {
+      return NULL;
+    }
+    uint64_t tail = (_head + _capacity - _used) % _capacity;
+    uint64_t remain;
+    if (_head >= tail) {
+      remain = _capacity - _head;
+      if (remain < min && tail >= min) {
+        // skip the gap at the end, wrap to the start of the ring
+        _used += remain;
+        _head = 0;
+        remain = tail;
+      }
+    } else {
+      remain = tail - _head;
+    }
+
+    if (remain < min) {
       return NULL;
-    } else if (_used + expect > _capacity) {
-      char * buff = _base + _used;
-      allocated = min;
-      _used += min;
-      return buff;
+    }
+    if (remain < expect) {
+      allocated = takeRemain ? (uint32_t)remain : min;
     } else {
-      char * buff = _base + _used;
       allocated = expect;
-      _used += expect;
-      return buff;
     }
+    char * buff = _base + _head;
+    _head += allocated;
+    _used += allocated;
+    if (_head > _mark) {
+      _mark = _head;
+    }
+    return buff;
   }
+
+  /**
+   * give back the end of buff beyond length, if buff is the latest
+   * allocation, otherwise the bytes stay held until release()
+   */
+  void shrink(char * buff, uint32_t allocated, uint32_t length) {
+    if (length < allocated && buff + allocated == _base + _head) {
+      _head -= allocated - length;
+      _used -= allocated - length;
+      if (_used == 0) {
+        _head = 0;
+      }
+    }
+  }
+
+private:
+  void freeMemory();
+
+  char * mapMemory(uint64_t capacity);
 };
 
 } // namespace NativeTask
@@ -21,23 +21,34 @@
 #include "util/StringUtil.h"
 #include "lib/Merge.h"
 #include "lib/FileSystem.h"
+#include "lib/ReadAheadStream.h"
 
 namespace NativeTask {
 
-IFileMergeEntry * IFileMergeEntry::create(SingleSpillInfo * spill) {
+IFileMergeEntry * IFileMergeEntry::create(SingleSpillInfo * spill, uint32_t startPartition,
+    uint32_t endPartition, ThreadPool * ioThread, uint32_t readAheadSize, bool mmap) {
+  if (mmap && IFileReader::canMap(spill, startPartition, endPartition)) {
+    MappedFile * mapped = new MappedFile(spill->path);
+    return new IFileMergeEntry(new IFileReader(mapped, spill, startPartition, endPartition));
+  }
   InputStream * fileOut = FileSystem::getLocal().open(spill->path);
-  IFileReader * reader = new IFileReader(fileOut, spill, true);
+  if (NULL != ioThread && readAheadSize > 0) {
+    fileOut = new ReadAheadInputStream(fileOut, ioThread, readAheadSize, true);
+  }
+  IFileReader * reader = new IFileReader(fileOut, spill, true, startPartition, endPartition);
   return new IFileMergeEntry(reader);
 }
 
 Merger::Merger(IFileWriter * writer, Config * config, ComparatorPtr comparator,
-    ICombineRunner * combineRunner)
+    ICombineRunner * combineRunner, MergeAlgorithm mergeType)
     : _writer(writer), _config(config), _combineRunner(combineRunner), _first(true),
-        _comparator(comparator) {
+        _comparator(comparator), _mergeType(mergeType), _loserTree(_comparator),
+        _current(NULL) {
 }
 
 Merger::~Merger() {
   _heap.clear();
+  _loserTree.clear();
   for (size_t i = 0; i < _entries.size(); i++) {
     delete _entries[i];
   }
@@ -84,10 +95,30 @@ void Merger::initHeap() {
       _heap.push_back(pme);
     }
   }
-  makeHeap(&(_heap[0]), &(_heap[0]) + _heap.size(), _comparator);
+  if (_mergeType == LOSERTREEMERGE) {
+    _loserTree.init(&(_heap[0]), &(_heap[0]) + _heap.size());
+  } else {
+    makeHeap(&(_heap[0]), &(_heap[0]) + _heap.size(), _comparator);
+  }
 }
 
 bool Merger::next() {
+  if (_mergeType == LOSERTREEMERGE) {
+    if (_loserTree.empty()) {
+      return false;
+    }
+    if (!_first) {
+      _loserTree.replaceTop(_loserTree.top()->next());
+      if (_loserTree.empty()) {
+        return false;
+      }
+    } else {
+      _first = false;
+    }
+    _current = _loserTree.top();
+    return true;
+  }
+
   size_t cur_heap_size = _heap.size();
   if (cur_heap_size > 0) {
     if (!_first) {
@@ -112,7 +143,10 @@ bool Merger::next() {
     } else {
       _first = false;
     }
-    return _heap.size() > 0;
+    if (_heap.size() > 0) {
+      _current = _heap[0];
+      return true;
+    }
   }
   return false;
 }
@@ -120,9 +154,8 @@ bool Merger::next() {
 bool Merger::next(Buffer & key, Buffer & value) {
   bool result = next();
   if (result) {
-    MergeEntryPtr * base = &(_heap[0]);
-    key.reset(base[0]->getKey(), base[0]->getKeyLength());
-    value.reset(base[0]->getValue(), base[0]->getValueLength());
+    key.reset(_current->getKey(), _current->getKeyLength());
+    value.reset(_current->getValue(), _current->getValueLength());
     return true;
   } else {
     return false;
@@ -132,7 +165,6 @@ bool Merger::next(Buffer & key, Buffer & value) {
 void Merger::merge() {
   uint64_t total_record = 0;
   _heap.reserve(_entries.size());
-  MergeEntryPtr * base = &(_heap[0]);
   while (startPartition()) {
     initHeap();
     if (_heap.size() == 0) {
@@ -142,8 +174,8 @@ void Merger::merge() {
     _first = true;
     if (_combineRunner == NULL) {
       while (next()) {
-        _writer->write(base[0]->getKey(), base[0]->getKeyLength(), base[0]->getValue(),
-            base[0]->getValueLength());
+        _writer->write(_current->getKey(), _current->getKeyLength(), _current->getValue(),
+            _current->getValueLength());
         total_record++;
       }
     } else {
@@ -24,6 +24,7 @@
 #include "lib/MapOutputCollector.h"
 #include "lib/IFile.h"
 #include "lib/MinHeap.h"
+#include "lib/LoserTree.h"
 
 namespace NativeTask {
 
@@ -85,7 +86,7 @@ typedef MergeEntry * MergeEntryPtr;
 
 class MergeEntryComparator {
 private:
-  ComparatorPtr _keyComparator;
+  KeyComparator _keyComparator;
 
 public:
   MergeEntryComparator(ComparatorPtr comparator)
@@ -94,7 +95,7 @@ public:
 
 public:
   bool operator()(const MergeEntryPtr lhs, const MergeEntryPtr rhs) {
-    return (*_keyComparator)(lhs->getKey(), lhs->getKeyLength(), rhs->getKey(), rhs->getKeyLength())
+    return _keyComparator(lhs->getKey(), lhs->getKeyLength(), rhs->getKey(), rhs->getKeyLength())
         < 0;
   }
 };
@@ -181,7 +182,15 @@ public:
    * @param reader: managed by InterFileMergeEntry
    */
 
-  static IFileMergeEntry * create(SingleSpillInfo * spill);
+  /**
+   * @param ioThread if not NULL, the spill file is read ahead on it in
+   *        chunks of readAheadSize bytes
+   * @param mmap read the spill in place from a mapping when
+   *        IFileReader::canMap, read ahead does not apply then
+   */
+  static IFileMergeEntry * create(SingleSpillInfo * spill, uint32_t startPartition = 0,
+      uint32_t endPartition = UINT32_MAX, ThreadPool * ioThread = NULL,
+      uint32_t readAheadSize = 0, bool mmap = false);
 
   IFileMergeEntry(IFileReader * reader)
       : _reader(reader) {
@@ -230,10 +239,13 @@ private:
   ICombineRunner * _combineRunner;
   bool _first;
   MergeEntryComparator _comparator;
+  MergeAlgorithm _mergeType;
+  LoserTree<MergeEntryPtr, MergeEntryComparator> _loserTree;
+  MergeEntryPtr _current;
 
 public:
   Merger(IFileWriter * writer, Config * config, ComparatorPtr comparator,
-      ICombineRunner * combineRunner = NULL);
+      ICombineRunner * combineRunner = NULL, MergeAlgorithm mergeType = LOSERTREEMERGE);
 
   ~Merger();
 
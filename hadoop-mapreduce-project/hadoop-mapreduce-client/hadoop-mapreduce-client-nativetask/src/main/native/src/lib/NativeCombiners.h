@@ -0,0 +1,195 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NATIVECOMBINERS_H_
+#define NATIVECOMBINERS_H_
+
+#include "lib/commons.h"
+#include "util/StringUtil.h"
+#include "lib/Combiner.h"
+#include "lib/MapOutputSpec.h"
+
+namespace NativeTask {
+
+/**
+ * Reads and writes values serialized like IntWritable, LongWritable
+ * and DoubleWritable, i.e. big endian
+ */
+template<typename _Value>
+struct NumberValue;
+
+template<>
+struct NumberValue<int32_t> {
+  static KeyValueType type() {
+    return IntType;
+  }
+
+  static int32_t read(const char * pos) {
+    return (int32_t)bswap(*(const uint32_t *)pos);
+  }
+
+  static void write(int32_t value, char * pos) {
+    *(uint32_t *)pos = bswap((uint32_t)value);
+  }
+
+  // wraps around on overflow like java
+  static int32_t add(int32_t lhs, int32_t rhs) {
+    return (int32_t)((uint32_t)lhs + (uint32_t)rhs);
+  }
+};
+
+template<>
+struct NumberValue<int64_t> {
+  static KeyValueType type() {
+    return LongType;
+  }
+
+  static int64_t read(const char * pos) {
+    return (int64_t)bswap64(*(const uint64_t *)pos);
+  }
+
+  static void write(int64_t value, char * pos) {
+    *(uint64_t *)pos = bswap64((uint64_t)value);
+  }
+
+  static int64_t add(int64_t lhs, int64_t rhs) {
+    return (int64_t)((uint64_t)lhs + (uint64_t)rhs);
+  }
+};
+
+template<>
+struct NumberValue<double> {
+  static KeyValueType type() {
+    return DoubleType;
+  }
+
+  static double read(const char * pos) {
+    uint64_t bits = bswap64(*(const uint64_t *)pos);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static void write(double value, char * pos) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(value));
+    *(uint64_t *)pos = bswap64(bits);
+  }
+
+  static double add(double lhs, double rhs) {
+    return lhs + rhs;
+  }
+};
+
+struct SumOp {
+  template<typename _Value>
+  static _Value apply(_Value lhs, _Value rhs) {
+    return NumberValue<_Value>::add(lhs, rhs);
+  }
+};
+
+struct MinOp {
+  template<typename _Value>
+  static _Value apply(_Value lhs, _Value rhs) {
+    return rhs < lhs ? rhs : lhs;
+  }
+};
+
+struct MaxOp {
+  template<typename _Value>
+  static _Value apply(_Value lhs, _Value rhs) {
+    return lhs < rhs ? rhs : lhs;
+  }
+};
+
+/**
+ * Folds the values of each key with _Op and outputs one record per key.
+ * Keys are grouped by their serialized bytes; keys that only compare
+ * equal under a custom comparator are combined separately, which is
+ * still a valid combine. With GROUPBY keys are grouped by the group
+ * field, and each group is output with its first key.
+ *
+ * A count is a sum of per record counts, e.g. LongSumCombiner over
+ * values of 1, as a combiner may run more than once on the same data.
+ */
+template<typename _Value, typename _Op>
+class NumberCombiner : public NativeCombiner {
+private:
+  uint32_t _groupLength;
+
+public:
+  NumberCombiner()
+      : _groupLength(0) {
+  }
+
+  virtual void configure(Config * config) {
+    MapOutputSpec spec;
+    MapOutputSpec::getSpecFromConfig(config, spec);
+    if (spec.valueType != NumberValue<_Value>::type()) {
+      THROW_EXCEPTION_EX(UnsupportException, "combiner expects value type %d, map output "
+          "value type is %d", (int)NumberValue<_Value>::type(), (int)spec.valueType);
+    }
+    _groupLength = spec.sortOrder == GROUPBY ? spec.groupFieldLength : 0;
+  }
+
+  virtual void combine(CombineContext type, KVIterator * kvIterator, Collector * writer) {
+    Buffer key;
+    Buffer value;
+    std::string current;
+    _Value result = 0;
+    bool hasKey = false;
+    char output[sizeof(_Value)];
+    while (kvIterator->next(key, value)) {
+      if (value.length() != sizeof(_Value)) {
+        THROW_EXCEPTION_EX(IOException, "combiner value length %u, expect %u", value.length(),
+            (uint32_t)sizeof(_Value));
+      }
+      _Value v = NumberValue<_Value>::read(value.data());
+      if (hasKey && MapOutputSpec::sameGroup(key.data(), key.length(), current.data(),
+          current.length(), _groupLength)) {
+        result = _Op::apply(result, v);
+        continue;
+      }
+      if (hasKey) {
+        NumberValue<_Value>::write(result, output);
+        writer->collect(current.data(), current.length(), output, sizeof(_Value));
+      }
+      current.assign(key.data(), key.length());
+      result = v;
+      hasKey = true;
+    }
+    if (hasKey) {
+      NumberValue<_Value>::write(result, output);
+      writer->collect(current.data(), current.length(), output, sizeof(_Value));
+    }
+  }
+};
+
+typedef NumberCombiner<int32_t, SumOp> IntSumCombiner;
+typedef NumberCombiner<int32_t, MinOp> IntMinCombiner;
+typedef NumberCombiner<int32_t, MaxOp> IntMaxCombiner;
+typedef NumberCombiner<int64_t, SumOp> LongSumCombiner;
+typedef NumberCombiner<int64_t, MinOp> LongMinCombiner;
+typedef NumberCombiner<int64_t, MaxOp> LongMaxCombiner;
+typedef NumberCombiner<double, SumOp> DoubleSumCombiner;
+typedef NumberCombiner<double, MinOp> DoubleMinCombiner;
+typedef NumberCombiner<double, MaxOp> DoubleMaxCombiner;
+
+} // namespace NativeTask
+
+#endif /* NATIVECOMBINERS_H_ */
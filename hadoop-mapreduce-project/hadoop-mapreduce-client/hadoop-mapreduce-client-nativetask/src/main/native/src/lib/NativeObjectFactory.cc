@@ -23,6 +23,7 @@
 #include "lib/commons.h"
 #include "NativeTask.h"
 #include "lib/NativeObjectFactory.h"
+#include "lib/KeyComparators.h"
 #include "lib/NativeLibrary.h"
 #include "lib/BufferStream.h"
 #include "util/StringUtil.h"
@@ -31,6 +32,7 @@
 #include "handler/BatchHandler.h"
 #include "handler/MCollectorOutputHandler.h"
 #include "handler/CombineHandler.h"
+#include "lib/NativeCombiners.h"
 
 using namespace NativeTask;
 
@@ -56,6 +58,15 @@ DEFINE_NATIVE_LIBRARY(NativeTask) {
   REGISTER_CLASS(BatchHandler, NativeTask);
   REGISTER_CLASS(CombineHandler, NativeTask);
   REGISTER_CLASS(MCollectorOutputHandler, NativeTask);
+  REGISTER_CLASS(IntSumCombiner, NativeTask);
+  REGISTER_CLASS(IntMinCombiner, NativeTask);
+  REGISTER_CLASS(IntMaxCombiner, NativeTask);
+  REGISTER_CLASS(LongSumCombiner, NativeTask);
+  REGISTER_CLASS(LongMinCombiner, NativeTask);
+  REGISTER_CLASS(LongMaxCombiner, NativeTask);
+  REGISTER_CLASS(DoubleSumCombiner, NativeTask);
+  REGISTER_CLASS(DoubleMinCombiner, NativeTask);
+  REGISTER_CLASS(DoubleMaxCombiner, NativeTask);
   NativeObjectFactory::SetDefaultClass(BatchHandlerType, "NativeTask.BatchHandler");
 }
 
@@ -297,122 +308,42 @@ NativeObject * NativeObjectFactory::CreateDefaultObject(NativeObjectType type) {
 
 int NativeObjectFactory::BytesComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-
-  uint32_t minlen = std::min(srcLength, destLength);
-  int64_t ret = fmemcmp(src, dest, minlen);
-  if (ret > 0) {
-    return 1;
-  } else if (ret < 0) {
-    return -1;
-  }
-  return srcLength - destLength;
+  return CompareBytesKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::ByteComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  return (*src) - (*dest);
+  return CompareByteKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::IntComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  int result = (*src) - (*dest);
-  if (result == 0) {
-    uint32_t from = bswap(*(uint32_t*)src);
-    uint32_t to = bswap(*(uint32_t*)dest);
-    if (from > to) {
-      return 1;
-    } else if (from == to) {
-      return 0;
-    } else {
-      return -1;
-    }
-  }
-  return result;
+  return CompareIntKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::LongComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  int result = (int)(*src) - (int)(*dest);
-  if (result == 0) {
-
-    uint64_t from = bswap64(*(uint64_t*)src);
-    uint64_t to = bswap64(*(uint64_t*)dest);
-    if (from > to) {
-      return 1;
-    } else if (from == to) {
-      return 0;
-    } else {
-      return -1;
-    }
-  }
-  return result;
+  return CompareLongKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::VIntComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  int32_t from = WritableUtils::ReadVInt(src, srcLength);
-  int32_t to = WritableUtils::ReadVInt(dest, destLength);
-  if (from > to) {
-    return 1;
-  } else if (from == to) {
-    return 0;
-  } else {
-    return -1;
-  }
+  return CompareVIntKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::VLongComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  int64_t from = WritableUtils::ReadVLong(src, srcLength);
-  int64_t to = WritableUtils::ReadVLong(dest, destLength);
-  if (from > to) {
-    return 1;
-  } else if (from == to) {
-    return 0;
-  } else {
-    return -1;
-  }
+  return CompareVLongKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::FloatComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  if (srcLength != 4 || destLength != 4) {
-    THROW_EXCEPTION_EX(IOException, "float comparator, while src/dest lengt is not 4");
-  }
-
-  uint32_t from = bswap(*(uint32_t*)src);
-  uint32_t to = bswap(*(uint32_t*)dest);
-
-  float * srcValue = (float *)(&from);
-  float * destValue = (float *)(&to);
-
-  if ((*srcValue) < (*destValue)) {
-    return -1;
-  } else if ((*srcValue) == (*destValue)) {
-    return 0;
-  } else {
-    return 1;
-  }
+  return CompareFloatKey(src, srcLength, dest, destLength);
 }
 
 int NativeObjectFactory::DoubleComparator(const char * src, uint32_t srcLength, const char * dest,
     uint32_t destLength) {
-  if (srcLength != 8 || destLength != 8) {
-    THROW_EXCEPTION_EX(IOException, "double comparator, while src/dest lengt is not 4");
-  }
-
-  uint64_t from = bswap64(*(uint64_t*)src);
-  uint64_t to = bswap64(*(uint64_t*)dest);
-
-  double * srcValue = (double *)(&from);
-  double * destValue = (double *)(&to);
-  if ((*srcValue) < (*destValue)) {
-    return -1;
-  } else if ((*srcValue) == (*destValue)) {
-    return 0;
-  } else {
-    return 1;
-  }
+  return CompareDoubleKey(src, srcLength, dest, destLength);
 }
 
 ComparatorPtr get_comparator(const KeyValueType keyType, const char * comparatorName) {
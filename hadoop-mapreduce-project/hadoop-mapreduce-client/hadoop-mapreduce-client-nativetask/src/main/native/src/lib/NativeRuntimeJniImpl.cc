@@ -47,6 +47,12 @@ JNIEXPORT jboolean JNICALL Java_org_apache_hadoop_mapred_nativetask_NativeRuntim
     return JNI_TRUE;
 #else
     return JNI_FALSE;
+#endif
+  } else if ("org.apache.hadoop.io.compress.ZStandardCodec" == codecString) {
+#if defined HADOOP_ZSTD_LIBRARY
+    return JNI_TRUE;
+#else
+    return JNI_FALSE;
 #endif
   } else {
     return JNI_FALSE;
@@ -33,6 +33,8 @@ const string NativeObjectTypeToString(NativeObjectType type) {
   switch (type) {
   case BatchHandlerType:
     return string("BatchHandlerType");
+  case CombinerType:
+    return string("CombinerType");
   default:
     return string("UnknownObjectType");
   }
@@ -41,6 +43,8 @@ const string NativeObjectTypeToString(NativeObjectType type) {
 NativeObjectType NativeObjectTypeFromString(const string type) {
   if (type == "BatchHandlerType") {
     return BatchHandlerType;
+  } else if (type == "CombinerType") {
+    return CombinerType;
   }
   return UnknownObjectType;
 }
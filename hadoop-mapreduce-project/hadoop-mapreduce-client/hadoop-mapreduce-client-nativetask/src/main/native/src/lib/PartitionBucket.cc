@@ -36,7 +36,10 @@ KVIterator * PartitionBucket::getIterator() {
   if (_memBlocks.size() == 0) {
     return NULL;
   }
-  return new PartitionBucketIterator(this, _keyComparator);
+  if (_sortedKVs.size() > 0) {
+    return new KVBufferArrayIterator(_sortedKVs);
+  }
+  return new PartitionBucketIterator(this, _keyComparator, _mergeType);
 }
 
 void PartitionBucket::spill(IFileWriter * writer)
@@ -63,10 +66,21 @@ void PartitionBucket::sort(SortAlgorithm type) {
   if (_memBlocks.size() == 0) {
     return;
   }
-  if ((!_sorted)) {
+  if ((!_sorted) && _wholeSort && _memBlocks.size() > 1) {
+    _sortedKVs.clear();
+    _sortedKVs.reserve(getKVCount());
+    for (uint32_t i = 0; i < _memBlocks.size(); i++) {
+      MemoryBlock * block = _memBlocks[i];
+      const uint32_t count = block->getKVCount();
+      for (uint32_t j = 0; j < count; j++) {
+        _sortedKVs.push_back(block->getKVBuffer(j));
+      }
+    }
+    SortKVBuffers(_sortedKVs, type, _keyComparator, _sortKeyType);
+  } else if ((!_sorted)) {
     for (uint32_t i = 0; i < _memBlocks.size(); i++) {
       MemoryBlock * block = _memBlocks[i];
-      block->sort(type, _keyComparator);
+      block->sort(type, _keyComparator, _sortKeyType);
     }
   }
   _sorted = true;
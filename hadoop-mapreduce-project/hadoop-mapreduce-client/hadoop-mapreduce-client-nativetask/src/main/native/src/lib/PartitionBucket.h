@@ -45,13 +45,26 @@ private:
   uint32_t _blockSize;
   ComparatorPtr _keyComparator;
   ICombineRunner * _combineRunner;
+  KeyValueType _sortKeyType;
+  bool _wholeSort;
+  MergeAlgorithm _mergeType;
+  // all KVBuffers in order, filled by a whole partition sort
+  std::vector<KVBuffer *> _sortedKVs;
   bool _sorted;
 
 public:
+  /**
+   * @param sortKeyType see MemoryBlock::sort
+   * @param wholeSort sort all records of the partition at once instead
+   *        of sorting each MemoryBlock and merging them when iterating
+   * @param mergeType how sorted MemoryBlocks are merged when iterating
+   */
   PartitionBucket(MemoryPool * pool, uint32_t partition, ComparatorPtr comparator,
-      ICombineRunner * combineRunner, uint32_t blockSize)
+      ICombineRunner * combineRunner, uint32_t blockSize, KeyValueType sortKeyType = UnknownType,
+      bool wholeSort = false, MergeAlgorithm mergeType = LOSERTREEMERGE)
       : _pool(pool), _partition(partition), _blockSize(blockSize),
-          _keyComparator(comparator), _combineRunner(combineRunner),  _sorted(false) {
+          _keyComparator(comparator), _combineRunner(combineRunner), _sortKeyType(sortKeyType),
+          _wholeSort(wholeSort), _mergeType(mergeType), _sorted(false) {
     if (NULL == _pool || NULL == comparator) {
       THROW_EXCEPTION_EX(IOException, "pool is NULL, or comparator is not set");
     }
@@ -77,6 +90,8 @@ public:
       }
     }
     _memBlocks.clear();
+    _sortedKVs.clear();
+    _sorted = false;
   }
 
   KVIterator * getIterator();
@@ -92,6 +107,20 @@ public:
     return size;
   }
 
+  /**
+   * bytes of the serialized records, an estimate of the spill size
+   */
+  uint64_t getKVBytes() const {
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < _memBlocks.size(); i++) {
+      MemoryBlock * block = _memBlocks[i];
+      if (NULL != block) {
+        bytes += block->usedSpace();
+      }
+    }
+    return bytes;
+  }
+
   /**
    * @throws OutOfMemoryException if total_length > io.sort.mb
    */
@@ -100,7 +129,10 @@ public:
       LOG("KV Length is empty, no need to allocate buffer for it");
       return NULL;
     }
-    _sorted = false;
+    if (_sorted) {
+      _sorted = false;
+      _sortedKVs.clear();
+    }
     MemoryBlock * memBlock = NULL;
     uint32_t memBlockSize = _memBlocks.size();
     if (memBlockSize > 0) {
@@ -122,6 +154,18 @@ public:
     return NULL;
   }
 
+  /**
+   * take over a block whose records were written in place, see
+   * MemoryBlock::addKVBuffer
+   */
+  void addMemoryBlock(MemoryBlock * memBlock) {
+    if (_sorted) {
+      _sorted = false;
+      _sortedKVs.clear();
+    }
+    _memBlocks.push_back(memBlock);
+  }
+
   void sort(SortAlgorithm type);
 
   void spill(IFileWriter * writer) throw (IOException, UnsupportException);
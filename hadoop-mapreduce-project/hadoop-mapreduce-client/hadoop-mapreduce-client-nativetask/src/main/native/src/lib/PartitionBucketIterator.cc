@@ -37,8 +37,10 @@ namespace NativeTask {
 // PartitionBucket
 /////////////////////////////////////////////////////////////////
 
-PartitionBucketIterator::PartitionBucketIterator(PartitionBucket * pb, ComparatorPtr comparator)
-    : _pb(pb), _comparator(comparator), _first(true) {
+PartitionBucketIterator::PartitionBucketIterator(PartitionBucket * pb, ComparatorPtr comparator,
+    MergeAlgorithm mergeType)
+    : _pb(pb), _comparator(comparator), _first(true), _mergeType(mergeType),
+        _loserTree(_comparator), _current(NULL) {
   uint32_t blockCount = _pb->getMemoryBlockCount();
   for (uint32_t i = 0; i < blockCount; i++) {
     MemoryBlock * block = _pb->getMemoryBlock(i);
@@ -49,7 +51,12 @@ PartitionBucketIterator::PartitionBucketIterator(PartitionBucket * pb, Comparato
       delete blockIterator;
     }
   }
-  if (_heap.size() > 1) {
+  if (_mergeType == LOSERTREEMERGE) {
+    _iterators.swap(_heap);
+    if (_iterators.size() > 0) {
+      _loserTree.init(&(_iterators[0]), &(_iterators[0]) + _iterators.size());
+    }
+  } else if (_heap.size() > 1) {
     makeHeap(&(_heap[0]), &(_heap[0]) + _heap.size(), _comparator);
   }
 }
@@ -62,9 +69,30 @@ PartitionBucketIterator::~PartitionBucketIterator() {
       _heap[i] = NULL;
     }
   }
+  _loserTree.clear();
+  for (uint32_t i = 0; i < _iterators.size(); i++) {
+    delete _iterators[i];
+  }
+  _iterators.clear();
 }
 
 bool PartitionBucketIterator::next() {
+  if (_mergeType == LOSERTREEMERGE) {
+    if (_loserTree.empty()) {
+      return false;
+    }
+    if (!_first) {
+      _loserTree.replaceTop(_loserTree.top()->next());
+      if (_loserTree.empty()) {
+        return false;
+      }
+    } else {
+      _first = false;
+    }
+    _current = _loserTree.top();
+    return true;
+  }
+
   size_t cur_heap_size = _heap.size();
   if (cur_heap_size > 0) {
     if (!_first) {
@@ -92,7 +120,10 @@ bool PartitionBucketIterator::next() {
     } else {
       _first = false;
     }
-    return _heap.size() > 0;
+    if (_heap.size() > 0) {
+      _current = _heap[0];
+      return true;
+    }
   }
   return false;
 }
@@ -100,8 +131,7 @@ bool PartitionBucketIterator::next() {
 bool PartitionBucketIterator::next(Buffer & key, Buffer & value) {
   bool result = next();
   if (result) {
-    MemBlockIteratorPtr * base = &(_heap[0]);
-    KVBuffer * kvBuffer = base[0]->getKVBuffer();
+    KVBuffer * kvBuffer = _current->getKVBuffer();
 
     key.reset(kvBuffer->getKey(), kvBuffer->keyLength);
     value.reset(kvBuffer->getValue(), kvBuffer->valueLength);
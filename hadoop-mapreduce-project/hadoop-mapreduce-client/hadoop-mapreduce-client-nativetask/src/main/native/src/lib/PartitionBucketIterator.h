@@ -28,6 +28,7 @@
 #include "lib/SpillInfo.h"
 #include "lib/Combiner.h"
 #include "lib/PartitionBucket.h"
+#include "lib/LoserTree.h"
 
 namespace NativeTask {
 
@@ -37,9 +38,15 @@ protected:
   std::vector<MemBlockIteratorPtr> _heap;
   MemBlockComparator _comparator;
   bool _first;
+  MergeAlgorithm _mergeType;
+  // all block iterators, owned here when merging with _loserTree
+  std::vector<MemBlockIteratorPtr> _iterators;
+  LoserTree<MemBlockIteratorPtr, MemBlockComparator> _loserTree;
+  MemBlockIteratorPtr _current;
 
 public:
-  PartitionBucketIterator(PartitionBucket * pb, ComparatorPtr comparator);
+  PartitionBucketIterator(PartitionBucket * pb, ComparatorPtr comparator,
+      MergeAlgorithm mergeType = LOSERTREEMERGE);
   virtual ~PartitionBucketIterator();
   virtual bool next(Buffer & key, Buffer & value);
 
@@ -47,6 +54,31 @@ private:
   bool next();
 };
 
+/**
+ * Iterates KVBuffers already in sorted order, used after a whole
+ * partition sort
+ */
+class KVBufferArrayIterator : public KVIterator {
+protected:
+  std::vector<KVBuffer *> & _kvs;
+  size_t _index;
+
+public:
+  KVBufferArrayIterator(std::vector<KVBuffer *> & kvs)
+      : _kvs(kvs), _index(0) {
+  }
+
+  virtual bool next(Buffer & key, Buffer & value) {
+    if (_index >= _kvs.size()) {
+      return false;
+    }
+    KVBuffer * kvBuffer = _kvs[_index++];
+    key.reset(kvBuffer->getKey(), kvBuffer->keyLength);
+    value.reset(kvBuffer->getValue(), kvBuffer->valueLength);
+    return true;
+  }
+};
+
 }
 ;
 //namespace NativeTask
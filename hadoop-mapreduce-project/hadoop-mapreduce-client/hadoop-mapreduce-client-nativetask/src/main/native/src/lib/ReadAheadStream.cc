@@ -0,0 +1,152 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "lib/ReadAheadStream.h"
+
+namespace NativeTask {
+
+class ReadAheadTask : public AsyncTask {
+public:
+  InputStream * stream;
+  char * buffer;
+  uint32_t capacity;
+  int32_t length;
+
+  ReadAheadTask(InputStream * stream, char * buffer, uint32_t capacity)
+      : stream(stream), buffer(buffer), capacity(capacity), length(-1) {
+  }
+
+protected:
+  virtual void execute() {
+    length = stream->readFully(buffer, capacity);
+  }
+};
+
+ReadAheadInputStream::ReadAheadInputStream(InputStream * stream, ThreadPool * ioThread,
+    uint32_t bufferSize, bool deleteSourceStream)
+    : FilterInputStream(stream), _ioThread(ioThread), _bufferSize(bufferSize),
+        _deleteSourceStream(deleteSourceStream), _current(NULL), _spare(NULL), _length(0),
+        _position(0), _offset(0), _eof(false), _pending(NULL) {
+  if (NULL == _ioThread || 0 == _bufferSize) {
+    THROW_EXCEPTION(IOException, "ReadAheadInputStream needs an io thread and a buffer size");
+  }
+  _current = new char[_bufferSize];
+  _spare = new char[_bufferSize];
+}
+
+ReadAheadInputStream::~ReadAheadInputStream() {
+  try {
+    cancel();
+  } catch (std::exception & e) {
+    LOG("ReadAheadInputStream: read ahead failed: %s", e.what());
+  }
+  delete [] _current;
+  delete [] _spare;
+  if (_deleteSourceStream) {
+    delete _stream;
+    _stream = NULL;
+  }
+}
+
+void ReadAheadInputStream::seek(uint64_t position) {
+  cancel();
+  _stream->seek(position);
+  _offset = position;
+  _length = 0;
+  _position = 0;
+  _eof = false;
+}
+
+uint64_t ReadAheadInputStream::tell() {
+  return _offset;
+}
+
+int32_t ReadAheadInputStream::read(void * buff, uint32_t length) {
+  if (_position >= _length) {
+    if (!fill()) {
+      return -1;
+    }
+  }
+  uint32_t rd = std::min(length, _length - _position);
+  simple_memcpy(buff, _current + _position, rd);
+  _position += rd;
+  _offset += rd;
+  return rd;
+}
+
+void ReadAheadInputStream::close() {
+  cancel();
+  _stream->close();
+}
+
+void ReadAheadInputStream::submit() {
+  _pending = new ReadAheadTask(_stream, _spare, _bufferSize);
+  _ioThread->submit(_pending);
+}
+
+void ReadAheadInputStream::cancel() {
+  if (NULL != _pending) {
+    ReadAheadTask * task = _pending;
+    _pending = NULL;
+    try {
+      task->waitFinish();
+    } catch (...) {
+      delete task;
+      throw;
+    }
+    delete task;
+  }
+}
+
+bool ReadAheadInputStream::fill() {
+  if (NULL == _pending) {
+    if (_eof) {
+      return false;
+    }
+    submit();
+  }
+  ReadAheadTask * task = _pending;
+  _pending = NULL;
+  try {
+    task->waitFinish();
+  } catch (...) {
+    delete task;
+    throw;
+  }
+  int32_t length = task->length;
+  delete task;
+
+  std::swap(_current, _spare);
+  _position = 0;
+  if (length <= 0) {
+    _length = 0;
+    _eof = true;
+    return false;
+  }
+  _length = (uint32_t)length;
+  if (_length < _bufferSize) {
+    // readFully only returns short at the end of stream
+    _eof = true;
+  } else {
+    submit();
+  }
+  return true;
+}
+
+} // namespace NativeTask
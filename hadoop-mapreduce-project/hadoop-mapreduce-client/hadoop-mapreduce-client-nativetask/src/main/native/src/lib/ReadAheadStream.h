@@ -0,0 +1,82 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef READAHEADSTREAM_H_
+#define READAHEADSTREAM_H_
+
+#include "lib/Streams.h"
+#include "util/SyncUtils.h"
+
+namespace NativeTask {
+
+class ReadAheadTask;
+
+/**
+ * Double buffered InputStream: while one buffer is consumed, the next
+ * chunk of the wrapped stream is read into the other one on ioThread.
+ * At most one read per stream is in flight, so the wrapped stream is
+ * always read sequentially, whatever the size of ioThread.
+ */
+class ReadAheadInputStream : public FilterInputStream {
+private:
+  ThreadPool * _ioThread;
+  uint32_t _bufferSize;
+  bool _deleteSourceStream;
+  char * _current;
+  char * _spare;
+  uint32_t _length;
+  uint32_t _position;
+  uint64_t _offset;
+  bool _eof;
+  ReadAheadTask * _pending;
+
+public:
+  /**
+   * @param stream read from the start, or from the last seek()
+   */
+  ReadAheadInputStream(InputStream * stream, ThreadPool * ioThread, uint32_t bufferSize,
+      bool deleteSourceStream = false);
+
+  virtual ~ReadAheadInputStream();
+
+  virtual void seek(uint64_t position);
+
+  virtual uint64_t tell();
+
+  virtual int32_t read(void * buff, uint32_t length);
+
+  virtual void close();
+
+private:
+  void submit();
+
+  /**
+   * wait for the in-flight read, if any, and drop its data
+   */
+  void cancel();
+
+  /**
+   * make the next chunk current
+   * @return false on end of stream
+   */
+  bool fill();
+};
+
+} // namespace NativeTask
+
+#endif /* READAHEADSTREAM_H_ */
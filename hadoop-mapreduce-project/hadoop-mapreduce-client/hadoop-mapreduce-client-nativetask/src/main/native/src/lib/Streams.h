@@ -62,6 +62,13 @@ public:
   virtual void write(const void * buff, uint32_t length) {
   }
 
+  /**
+   * hint that about length bytes will be written, streams on files may
+   * reserve the space up front, ignored by default
+   */
+  virtual void preallocate(uint64_t length) {
+  }
+
   virtual void flush() {
   }
 
@@ -128,6 +135,10 @@ public:
     _stream->write(buff, length);
   }
 
+  virtual void preallocate(uint64_t length) {
+    _stream->preallocate(length);
+  }
+
   virtual void flush() {
     _stream->flush();
   }
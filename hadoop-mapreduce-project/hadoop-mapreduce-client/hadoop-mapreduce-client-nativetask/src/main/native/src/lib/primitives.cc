@@ -0,0 +1,245 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static inline int64_t byteDiff(const char * src, const char * dest, uint32_t pos) {
+  return (int64_t)((const uint8_t*)src)[pos] - (int64_t)((const uint8_t*)dest)[pos];
+}
+
+int64_t fmemcmp_scalar(const char * src, const char * dest, uint32_t len) {
+  if (len < 8) {
+    for (uint32_t i = 0; i < len; i++) {
+      if (src[i] != dest[i]) {
+        return byteDiff(src, dest, i);
+      }
+    }
+    return 0;
+  }
+  uint32_t cur = 0;
+  uint32_t end = len & (0xffffffffU << 3);
+  while (cur < end) {
+    uint64_t l = *(uint64_t*)(src + cur);
+    uint64_t r = *(uint64_t*)(dest + cur);
+    if (l != r) {
+      l = bswap64(l);
+      r = bswap64(r);
+      return l > r ? 1 : -1;
+    }
+    cur += 8;
+  }
+  uint64_t l = *(uint64_t*)(src + len - 8);
+  uint64_t r = *(uint64_t*)(dest + len - 8);
+  if (l != r) {
+    l = bswap64(l);
+    r = bswap64(r);
+    return l > r ? 1 : -1;
+  }
+  return 0;
+}
+
+#if defined(__x86_64__)
+
+/**
+ * Compare 16 bytes, return the position of the first mismatch or 16
+ */
+static inline uint32_t mismatch16(const char * src, const char * dest) {
+  __m128i l = _mm_loadu_si128((const __m128i *)src);
+  __m128i r = _mm_loadu_si128((const __m128i *)dest);
+  uint32_t diff = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) ^ 0xffffU;
+  return diff ? __builtin_ctz(diff) : 16;
+}
+
+/**
+ * 16 <= len <= 32, two possibly overlapping chunks
+ */
+static inline int64_t fmemcmp16to32(const char * src, const char * dest, uint32_t len) {
+  uint32_t pos = mismatch16(src, dest);
+  if (pos < 16) {
+    return byteDiff(src, dest, pos);
+  }
+  uint32_t tail = len - 16;
+  pos = mismatch16(src + tail, dest + tail);
+  return pos < 16 ? byteDiff(src, dest, tail + pos) : 0;
+}
+
+int64_t fmemcmp_sse2(const char * src, const char * dest, uint32_t len) {
+  if (len < 16) {
+    return fmemcmp_scalar(src, dest, len);
+  }
+  uint32_t cur = 0;
+  // one movemask per 64 bytes while the keys are equal
+  for (; cur + 64 <= len; cur += 64) {
+    __m128i eq0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(src + cur)),
+        _mm_loadu_si128((const __m128i *)(dest + cur)));
+    __m128i eq1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(src + cur + 16)),
+        _mm_loadu_si128((const __m128i *)(dest + cur + 16)));
+    __m128i eq2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(src + cur + 32)),
+        _mm_loadu_si128((const __m128i *)(dest + cur + 32)));
+    __m128i eq3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(src + cur + 48)),
+        _mm_loadu_si128((const __m128i *)(dest + cur + 48)));
+    __m128i all = _mm_and_si128(_mm_and_si128(eq0, eq1), _mm_and_si128(eq2, eq3));
+    if (_mm_movemask_epi8(all) != 0xffff) {
+      break;
+    }
+  }
+  for (; cur + 16 <= len; cur += 16) {
+    uint32_t pos = mismatch16(src + cur, dest + cur);
+    if (pos < 16) {
+      return byteDiff(src, dest, cur + pos);
+    }
+  }
+  if (cur < len) {
+    // the last chunk overlaps bytes already known equal
+    uint32_t tail = len - 16;
+    uint32_t pos = mismatch16(src + tail, dest + tail);
+    if (pos < 16) {
+      return byteDiff(src, dest, tail + pos);
+    }
+  }
+  return 0;
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t mismatch32(const char * src, const char * dest) {
+  __m256i l = _mm256_loadu_si256((const __m256i *)src);
+  __m256i r = _mm256_loadu_si256((const __m256i *)dest);
+  uint32_t diff = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(l, r));
+  return diff ? __builtin_ctz(diff) : 32;
+}
+
+__attribute__((target("avx2")))
+int64_t fmemcmp_avx2(const char * src, const char * dest, uint32_t len) {
+  if (len <= 32) {
+    return len < 16 ? fmemcmp_scalar(src, dest, len) : fmemcmp16to32(src, dest, len);
+  }
+  uint32_t cur = 0;
+  for (; cur + 128 <= len; cur += 128) {
+    __m256i eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(src + cur)),
+        _mm256_loadu_si256((const __m256i *)(dest + cur)));
+    __m256i eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(src + cur + 32)),
+        _mm256_loadu_si256((const __m256i *)(dest + cur + 32)));
+    __m256i eq2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(src + cur + 64)),
+        _mm256_loadu_si256((const __m256i *)(dest + cur + 64)));
+    __m256i eq3 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(src + cur + 96)),
+        _mm256_loadu_si256((const __m256i *)(dest + cur + 96)));
+    __m256i all = _mm256_and_si256(_mm256_and_si256(eq0, eq1), _mm256_and_si256(eq2, eq3));
+    if ((uint32_t)_mm256_movemask_epi8(all) != 0xffffffffU) {
+      break;
+    }
+  }
+  for (; cur + 32 <= len; cur += 32) {
+    uint32_t pos = mismatch32(src + cur, dest + cur);
+    if (pos < 32) {
+      return byteDiff(src, dest, cur + pos);
+    }
+  }
+  if (cur < len) {
+    uint32_t tail = len - 32;
+    uint32_t pos = mismatch32(src + tail, dest + tail);
+    if (pos < 32) {
+      return byteDiff(src, dest, tail + pos);
+    }
+  }
+  return 0;
+}
+
+#define CPUID_AVX_BIT (1 << 28)
+#define CPUID_OSXSAVE_BIT (1 << 27)
+#define CPUID_AVX2_BIT (1 << 5)
+#define XCR0_YMM_STATE 0x6
+
+/**
+ * AVX2 needs both the cpu flag and the OS saving ymm state
+ */
+static bool cpuSupportsAvx2() {
+  uint32_t eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  if ((ecx & (CPUID_AVX_BIT | CPUID_OSXSAVE_BIT)) != (CPUID_AVX_BIT | CPUID_OSXSAVE_BIT)) {
+    return false;
+  }
+  uint32_t xcr0Low, xcr0High;
+  asm("xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0));
+  if ((xcr0Low & XCR0_YMM_STATE) != XCR0_YMM_STATE) {
+    return false;
+  }
+  if (__get_cpuid_max(0, NULL) < 7) {
+    return false;
+  }
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & CPUID_AVX2_BIT) != 0;
+}
+
+// SSE2 is part of x86-64, so it is the baseline until the check below
+int64_t (*fmemcmp_long)(const char * src, const char * dest, uint32_t len) = fmemcmp_sse2;
+const char * fmemcmp_long_name = "sse2";
+
+/**
+ * On library load pick the widest comparator the cpu supports
+ */
+void __attribute__ ((constructor)) init_fmemcmp_long(void) {
+  if (cpuSupportsAvx2()) {
+    fmemcmp_long = fmemcmp_avx2;
+    fmemcmp_long_name = "avx2";
+  }
+}
+
+#elif defined(__aarch64__)
+
+int64_t fmemcmp_neon(const char * src, const char * dest, uint32_t len) {
+  if (len < 16) {
+    return fmemcmp_scalar(src, dest, len);
+  }
+  const uint32_t last = len - 16;
+  for (uint32_t cur = 0;; cur += 16) {
+    if (cur > last) {
+      cur = last;
+    }
+    uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t *)(src + cur)),
+        vld1q_u8((const uint8_t *)(dest + cur)));
+    // narrow to 4 bits per byte so the mask fits in 64 bits
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    uint64_t diff = ~vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    if (diff) {
+      return byteDiff(src, dest, cur + (__builtin_ctzll(diff) >> 2));
+    }
+    if (cur == last) {
+      return 0;
+    }
+  }
+}
+
+// NEON is mandatory on aarch64, no runtime check needed
+int64_t (*fmemcmp_long)(const char * src, const char * dest, uint32_t len) = fmemcmp_neon;
+const char * fmemcmp_long_name = "neon";
+
+#else
+
+int64_t (*fmemcmp_long)(const char * src, const char * dest, uint32_t len) = fmemcmp_scalar;
+const char * fmemcmp_long_name = "scalar";
+
+#endif
@@ -126,6 +126,26 @@ inline uint64_t bswap64(uint64_t val) {
   return val;
 }
 
+/**
+ * Vectorized memcmp kernels, they return the difference of the first
+ * mismatching bytes (or a value of the same sign), for any len
+ */
+int64_t fmemcmp_scalar(const char * src, const char * dest, uint32_t len);
+#if defined(__x86_64__)
+int64_t fmemcmp_sse2(const char * src, const char * dest, uint32_t len);
+int64_t fmemcmp_avx2(const char * src, const char * dest, uint32_t len);
+#elif defined(__aarch64__)
+int64_t fmemcmp_neon(const char * src, const char * dest, uint32_t len);
+#endif
+
+/**
+ * The widest kernel supported by the cpu, chosen once on library load
+ */
+extern int64_t (*fmemcmp_long)(const char * src, const char * dest, uint32_t len);
+extern const char * fmemcmp_long_name;
+
+#define FMEMCMP_VECTOR_THRESHOLD 16
+
 /**
  * Fast memcmp
  */
@@ -135,6 +155,9 @@ inline int64_t fmemcmp(const char * src, const char * dest, uint32_t len) {
   return memcmp(src, dest, len);
 #else
 
+  if (len >= FMEMCMP_VECTOR_THRESHOLD) {
+    return fmemcmp_long(src, dest, len);
+  }
   const uint8_t * src8 = (const uint8_t*)src;
   const uint8_t * dest8 = (const uint8_t*)dest;
   switch (len) {
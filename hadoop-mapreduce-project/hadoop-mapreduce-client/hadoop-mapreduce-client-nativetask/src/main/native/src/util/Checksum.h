@@ -24,8 +24,14 @@
 
 namespace NativeTask {
 
+/**
+ * crc32_sb8/crc32c_sb8 use the fastest implementation the cpu supports,
+ * the *_software versions are the portable slicing-by-8 ones
+ */
 extern uint32_t crc32_sb8(uint32_t, const uint8_t *, size_t);
 extern uint32_t crc32c_sb8(uint32_t, const uint8_t *, size_t);
+extern uint32_t crc32_sb8_software(uint32_t, const uint8_t *, size_t);
+extern uint32_t crc32c_sb8_software(uint32_t, const uint8_t *, size_t);
 
 enum ChecksumType {
   CHECKSUM_NONE,
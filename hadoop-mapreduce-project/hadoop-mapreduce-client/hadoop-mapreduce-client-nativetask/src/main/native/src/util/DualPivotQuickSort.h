@@ -25,15 +25,15 @@
 namespace NativeTask {
 
 // TODO: definitely needs refactoring..
-template<typename _Compare>
-void DualPivotQuicksort(std::vector<uint32_t> & elements, int left, int right, int div,
+template<typename _Tp, typename _Compare>
+void DualPivotQuicksort(std::vector<_Tp> & elements, int left, int right, int div,
     _Compare compare) {
 
   if (left >= right) {
     return;
   }
 
-  uint32_t * e = &(elements[0]);
+  _Tp * e = &(elements[0]);
   int len = right - left;
 
   if (len < 27) { // insertion sort for tiny array
@@ -127,8 +127,8 @@ void DualPivotQuicksort(std::vector<uint32_t> & elements, int left, int right, i
   }
 }
 
-template<typename _Compare>
-void DualPivotQuicksort(std::vector<uint32_t> & elements, _Compare compare) {
+template<typename _Tp, typename _Compare>
+void DualPivotQuicksort(std::vector<_Tp> & elements, _Compare compare) {
   DualPivotQuicksort(elements, 0, elements.size() - 1, 3, compare);
 }
 
@@ -52,4 +52,158 @@ void Lock::unlock() {
   PthreadCall("unlock", pthread_mutex_unlock(&_mutex));
 }
 
+Condition::Condition(Lock & lock)
+    : _lock(&lock) {
+  PthreadCall("init condition", pthread_cond_init(&_cond, NULL));
+}
+
+Condition::~Condition() {
+  PthreadCall("destroy condition", pthread_cond_destroy(&_cond));
+}
+
+void Condition::wait() {
+  PthreadCall("wait condition", pthread_cond_wait(&_cond, &_lock->_mutex));
+}
+
+void Condition::signal() {
+  PthreadCall("signal condition", pthread_cond_signal(&_cond));
+}
+
+void Condition::signalAll() {
+  PthreadCall("broadcast condition", pthread_cond_broadcast(&_cond));
+}
+
+Thread::Thread()
+    : _thread((pthread_t)0), _runable(NULL) {
+}
+
+Thread::Thread(Runnable * runnable)
+    : _thread((pthread_t)0), _runable(runnable) {
+}
+
+Thread::~Thread() {
+}
+
+void Thread::start() {
+  PthreadCall("pthread_create", pthread_create(&_thread, NULL, ThreadRunner, this));
+}
+
+void Thread::join() {
+  PthreadCall("pthread_join", pthread_join(_thread, NULL));
+}
+
+void Thread::run() {
+  if (NULL != _runable) {
+    _runable->run();
+  }
+}
+
+void * Thread::ThreadRunner(void * pthis) {
+  try {
+    ((Thread*)pthis)->run();
+  } catch (std::exception & e) {
+    LOG("Thread: uncaught exception: %s", e.what());
+  }
+  return NULL;
+}
+
+AsyncTask::AsyncTask()
+    : _finishCond(_lock), _finished(false), _failed(false) {
+}
+
+AsyncTask::~AsyncTask() {
+}
+
+void AsyncTask::run() {
+  bool failed = false;
+  std::string error;
+  try {
+    execute();
+  } catch (std::exception & e) {
+    failed = true;
+    error = e.what();
+  } catch (...) {
+    failed = true;
+    error = "unknown exception";
+  }
+  ScopeLock<Lock> autolock(_lock);
+  _failed = failed;
+  _error = error;
+  _finished = true;
+  _finishCond.signalAll();
+}
+
+void AsyncTask::waitFinish() {
+  {
+    ScopeLock<Lock> autolock(_lock);
+    while (!_finished) {
+      _finishCond.wait();
+    }
+  }
+  if (_failed) {
+    THROW_EXCEPTION_EX(IOException, "async task failed: %s", _error.c_str());
+  }
+}
+
+bool AsyncTask::isFinished() {
+  ScopeLock<Lock> autolock(_lock);
+  return _finished;
+}
+
+void AsyncTask::reset() {
+  ScopeLock<Lock> autolock(_lock);
+  _finished = false;
+  _failed = false;
+  _error.clear();
+}
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+    : _notEmpty(_lock), _shutdown(false) {
+  for (uint32_t i = 0; i < numThreads; i++) {
+    Thread * worker = new Worker(this);
+    worker->start();
+    _workers.push_back(worker);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    ScopeLock<Lock> autolock(_lock);
+    _shutdown = true;
+    _notEmpty.signalAll();
+  }
+  for (size_t i = 0; i < _workers.size(); i++) {
+    _workers[i]->join();
+    delete _workers[i];
+  }
+  _workers.clear();
+}
+
+void ThreadPool::submit(Runnable * task) {
+  ScopeLock<Lock> autolock(_lock);
+  if (_shutdown) {
+    THROW_EXCEPTION(IOException, "ThreadPool already shutdown");
+  }
+  _tasks.push_back(task);
+  _notEmpty.signal();
+}
+
+void ThreadPool::workLoop() {
+  while (true) {
+    Runnable * task = NULL;
+    {
+      ScopeLock<Lock> autolock(_lock);
+      while (_tasks.empty() && !_shutdown) {
+        _notEmpty.wait();
+      }
+      if (_tasks.empty()) {
+        return;
+      }
+      task = _tasks.front();
+      _tasks.pop_front();
+    }
+    task->run();
+  }
+}
+
 } // namespace NativeTask
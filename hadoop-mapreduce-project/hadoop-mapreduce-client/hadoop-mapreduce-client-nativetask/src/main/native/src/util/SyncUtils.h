@@ -25,6 +25,10 @@
 #include <libkern/OSAtomic.h>
 #endif
 #include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
 
 namespace NativeTask {
 
@@ -65,6 +69,141 @@ private:
   void operator=(const ScopeLock&);
 };
 
+class Condition {
+public:
+  Condition(Lock & lock);
+  ~Condition();
+
+  /**
+   * Wait until signaled, the associated lock must be held
+   * by the caller
+   */
+  void wait();
+  void signal();
+  void signalAll();
+
+private:
+  pthread_cond_t _cond;
+  Lock * _lock;
+
+  // No copying
+  Condition(const Condition&);
+  void operator=(const Condition&);
+};
+
+class Runnable {
+public:
+  virtual ~Runnable() {
+  }
+
+  virtual void run() = 0;
+};
+
+class Thread : public Runnable {
+protected:
+  pthread_t _thread;
+  Runnable * _runable;
+public:
+  Thread();
+  Thread(Runnable * runnable);
+  virtual ~Thread();
+
+  void setTask(Runnable * runnable) {
+    _runable = runnable;
+  }
+
+  void start();
+  void join();
+
+  virtual void run();
+
+private:
+  static void * ThreadRunner(void * pthis);
+};
+
+/**
+ * Runnable whose completion can be waited for. Exceptions thrown
+ * from execute() are caught on the worker thread and rethrown as
+ * IOException by waitFinish() on the waiting thread.
+ */
+class AsyncTask : public Runnable {
+private:
+  Lock _lock;
+  Condition _finishCond;
+  bool _finished;
+  bool _failed;
+  std::string _error;
+
+public:
+  AsyncTask();
+  virtual ~AsyncTask();
+
+  virtual void run();
+
+  /**
+   * Block until execute() returns, rethrow its failure if any
+   */
+  void waitFinish();
+
+  bool isFinished();
+
+  /**
+   * Make a finished task submittable again
+   */
+  void reset();
+
+protected:
+  virtual void execute() = 0;
+};
+
+/**
+ * Fixed size pool of worker threads executing Runnables in
+ * submission order; the pool never owns the submitted tasks
+ */
+class ThreadPool {
+private:
+  Lock _lock;
+  Condition _notEmpty;
+  std::deque<Runnable *> _tasks;
+  std::vector<Thread *> _workers;
+  bool _shutdown;
+
+public:
+  ThreadPool(uint32_t numThreads);
+
+  /**
+   * Remaining queued tasks are still executed before the
+   * workers exit
+   */
+  ~ThreadPool();
+
+  void submit(Runnable * task);
+
+  uint32_t getThreadCount() {
+    return _workers.size();
+  }
+
+private:
+  class Worker : public Thread {
+  private:
+    ThreadPool * _pool;
+  public:
+    Worker(ThreadPool * pool)
+        : _pool(pool) {
+    }
+
+    virtual void run() {
+      _pool->workLoop();
+    }
+  };
+
+  void workLoop();
+
+  // No copying
+  ThreadPool(const ThreadPool&);
+  void operator=(const ThreadPool&);
+};
+
 
 } // namespace NativeTask
 
@@ -23,6 +23,7 @@
 #include "lib/BufferStream.h"
 #include "lib/FileSystem.h"
 #include "lib/Compressions.h"
+#include "lib/NativeObjectFactory.h"
 #include "test_commons.h"
 
 #if defined HADOOP_SNAPPY_LIBRARY
@@ -225,6 +226,97 @@ TEST(Perf, Lz4Codec) {
   TestCodec("org.apache.hadoop.io.compress.Lz4Codec");
 }
 
+static string BlockCompress(const string & codec, const string & data, uint32_t buffhint,
+    uint32_t & compressed, double & seconds) {
+  string dest;
+  dest.resize(data.length() / 2 * 3 + 1024);
+  OutputBuffer outputBuffer = OutputBuffer((char*)dest.data(), dest.length());
+  CompressStream * compressor = Compressions::getCompressionStream(codec, &outputBuffer, buffhint);
+  Timer timer;
+  for (size_t i = 0; i < data.length(); i += 64 * 1024) {
+    compressor->write(data.c_str() + i, std::min(data.length() - i, (size_t)(64 * 1024)));
+  }
+  compressor->flush();
+  seconds = (timer.now() - timer.last()) / 1000000000.0;
+  delete compressor;
+  compressed = outputBuffer.tell();
+  dest.resize(compressed);
+  return dest;
+}
+
+static string BlockDecompress(const string & codec, const string & compressed,
+    uint32_t buffhint, uint32_t readSize) {
+  string dest;
+  InputBuffer inputBuffer = InputBuffer(compressed);
+  DecompressStream * decompressor = Compressions::getDecompressionStream(codec, &inputBuffer,
+      buffhint);
+  char * buff = new char[readSize];
+  while (true) {
+    int32_t rd = decompressor->read(buff, readSize);
+    if (rd <= 0) {
+      break;
+    }
+    dest.append(buff, rd);
+  }
+  delete[] buff;
+  delete decompressor;
+  return dest;
+}
+
+static void TestPipelinedBlockCodec(const string & codec, size_t length, uint32_t threads) {
+  string data;
+  GenerateKVTextLength(data, length, "word");
+  uint32_t buffhint = 64 * 1024;
+  uint32_t compressedSize;
+  double syncTime;
+  double pipelinedTime;
+
+  NativeObjectFactory::GetConfig().setInt(NATIVE_COMPRESS_THREADS, 0);
+  string expect = BlockCompress(codec, data, buffhint, compressedSize, syncTime);
+  NativeObjectFactory::GetConfig().setInt(NATIVE_COMPRESS_THREADS, threads);
+  string actual = BlockCompress(codec, data, buffhint, compressedSize, pipelinedTime);
+  LOG("%s compress %lluM, sync: %.3lfs, %u threads: %.3lfs", codec.c_str(),
+      (unsigned long long)(length >> 20), syncTime, threads, pipelinedTime);
+
+  // same block boundaries, so the stream must be byte identical
+  ASSERT_EQ(expect.length(), actual.length());
+  ASSERT_TRUE(expect == actual);
+  // odd read size to make reads straddle decompressed blocks
+  string decompressed = BlockDecompress(codec, actual, buffhint, 12345);
+  NativeObjectFactory::GetConfig().setInt(NATIVE_COMPRESS_THREADS, 0);
+  ASSERT_EQ(data.length(), decompressed.length());
+  ASSERT_TRUE(data == decompressed);
+}
+
+TEST(Compressions, support) {
+  ASSERT_TRUE(Compressions::support("org.apache.hadoop.io.compress.GzipCodec"));
+  ASSERT_TRUE(Compressions::support("org.apache.hadoop.io.compress.Lz4Codec"));
+  // only advertised if it can be built
+#if defined HADOOP_ZSTD_LIBRARY
+  ASSERT_TRUE(Compressions::support("org.apache.hadoop.io.compress.ZStandardCodec"));
+  ASSERT_EQ("org.apache.hadoop.io.compress.ZStandardCodec", Compressions::getCodec(".zst"));
+#else
+  ASSERT_FALSE(Compressions::support("org.apache.hadoop.io.compress.ZStandardCodec"));
+  ASSERT_EQ("", Compressions::getCodec(".zst"));
+#endif
+}
+
+TEST(Compressions, PipelinedBlockCodec) {
+  TestPipelinedBlockCodec("org.apache.hadoop.io.compress.Lz4Codec", 8 * 1024 * 1024, 4);
+#if defined HADOOP_SNAPPY_LIBRARY
+  TestPipelinedBlockCodec("org.apache.hadoop.io.compress.SnappyCodec", 8 * 1024 * 1024, 4);
+#endif
+}
+
+TEST(Perf, PipelinedBlockCodec) {
+  size_t length = TestConfig.getInt("compression.input.length", 100 * 1024 * 1024);
+  uint32_t threads = TestConfig.getInt(NATIVE_COMPRESS_THREADS, 4);
+  TestPipelinedBlockCodec("org.apache.hadoop.io.compress.Lz4Codec", length, threads);
+#if defined HADOOP_SNAPPY_LIBRARY
+  TestPipelinedBlockCodec("org.apache.hadoop.io.compress.SnappyCodec", length, threads);
+#endif
+}
+
 #if defined HADOOP_SNAPPY_LIBRARY
 
 void MeasureSingleFileSnappy(const string & path, CompressResult & total, size_t blockSize,
@@ -284,3 +376,11 @@ TEST(Perf, SnappyCodec) {
 }
 
 #endif // define HADOOP_SNAPPY_LIBRARY
+
+#if defined HADOOP_ZSTD_LIBRARY
+
+TEST(Perf, ZStandardCodec) {
+  TestCodec("org.apache.hadoop.io.compress.ZStandardCodec");
+}
+
+#endif // define HADOOP_ZSTD_LIBRARY
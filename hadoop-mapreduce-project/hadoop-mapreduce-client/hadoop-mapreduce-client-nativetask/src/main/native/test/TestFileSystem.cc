@@ -17,6 +17,8 @@
  */
 
 #include "lib/FileSystem.h"
+#include "lib/ReadAheadStream.h"
+#include "lib/DirectFileStream.h"
 #include "test_commons.h"
 
 TEST(FileSystem, RawFileSystem) {
@@ -48,3 +50,104 @@ TEST(FileSystem, RawFileSystem) {
   ASSERT_FALSE(fs.exists(temppath));
 }
 
+TEST(FileSystem, ReadAheadInputStream) {
+  FileSystem & fs = FileSystem::getLocal();
+  string temppath = "readahead_data";
+  string content;
+  GenerateKVTextLength(content, 1000000, "word");
+  OutputStream * output = fs.create(temppath, true);
+  output->write(content.data(), content.length());
+  output->close();
+  delete output;
+
+  ThreadPool ioThread(2);
+  const uint32_t BUFFER_SIZES[] = {1, 4096, 65536, 1000000, 4 * 1024 * 1024};
+  for (size_t i = 0; i < sizeof(BUFFER_SIZES) / sizeof(BUFFER_SIZES[0]); i++) {
+    ReadAheadInputStream input(fs.open(temppath), &ioThread, BUFFER_SIZES[i], true);
+    string actual;
+    char buff[1000];
+    int32_t rd;
+    while ((rd = input.read(buff, 1000)) > 0) {
+      actual.append(buff, rd);
+    }
+    ASSERT_EQ(content, actual);
+    ASSERT_EQ(content.length(), input.tell());
+
+    input.seek(12345);
+    ASSERT_EQ(100, input.readFully(buff, 100));
+    ASSERT_EQ(content.substr(12345, 100), string(buff, 100));
+    ASSERT_EQ(12445, input.tell());
+    input.seek(content.length() - 10);
+    ASSERT_EQ(10, input.readFully(buff, 100));
+    ASSERT_EQ(-1, input.read(buff, 100));
+  }
+  fs.remove(temppath);
+}
+
+TEST(FileSystem, DirectFileOutputStream) {
+  FileSystem & fs = FileSystem::getLocal();
+  string temppath = "direct_data";
+  string content;
+  GenerateKVTextLength(content, 3333333, "word");
+  const uint32_t WRITE_SIZES[] = {1, 4095, 65536, 1048577};
+  for (size_t i = 0; i < sizeof(WRITE_SIZES) / sizeof(WRITE_SIZES[0]); i++) {
+    DirectFileOutputStream * output = new DirectFileOutputStream(temppath, true);
+    output->preallocate(content.length() * 2);
+    for (size_t pos = 0; pos < content.length(); pos += WRITE_SIZES[i]) {
+      uint32_t len = std::min((size_t)WRITE_SIZES[i], content.length() - pos);
+      output->write(content.data() + pos, len);
+    }
+    ASSERT_EQ(content.length(), output->tell());
+    output->close();
+    delete output;
+    ASSERT_EQ(content.length(), fs.getLength(temppath));
+    string actual;
+    ReadFile(actual, temppath);
+    ASSERT_EQ(content, actual);
+  }
+
+  // closed by the destructor
+  OutputStream * output = new DirectFileOutputStream(temppath, true);
+  output->write(content.data(), 100);
+  delete output;
+  ASSERT_EQ(100, fs.getLength(temppath));
+  fs.remove(temppath);
+
+  // without overwrite the file is created once, also when the file
+  // system refuses O_DIRECT and the stream reopens it buffered
+  output = fs.createDirect(temppath, false);
+  output->write(content.data(), 100);
+  delete output;
+  ASSERT_EQ(100, fs.getLength(temppath));
+  ASSERT_THROW(fs.createDirect(temppath, false), IOException);
+  fs.remove(temppath);
+}
+
+TEST(FileSystem, DirectFileOutputStreamSharedBuffers) {
+  FileSystem & fs = FileSystem::getLocal();
+  string content;
+  GenerateKVTextLength(content, 3333333, "word");
+  // the pool runs out of spares, the last streams write in place
+  const uint32_t numStreams = DirectFileOutputStream::MAX_BUFFERS / 2;
+  vector<OutputStream *> outputs;
+  for (uint32_t i = 0; i < numStreams; i++) {
+    outputs.push_back(fs.createDirect(StringUtil::Format("direct_shared_%u", i), true));
+  }
+  for (size_t pos = 0; pos < content.length(); pos += 65536) {
+    uint32_t len = std::min((size_t)65536, content.length() - pos);
+    for (uint32_t i = 0; i < numStreams; i++) {
+      outputs[i]->write(content.data() + pos, len);
+    }
+  }
+  for (uint32_t i = 0; i < numStreams; i++) {
+    outputs[i]->close();
+    delete outputs[i];
+  }
+  for (uint32_t i = 0; i < numStreams; i++) {
+    string path = StringUtil::Format("direct_shared_%u", i);
+    string actual;
+    ReadFile(actual, path);
+    ASSERT_EQ(content, actual);
+    fs.remove(path);
+  }
+}
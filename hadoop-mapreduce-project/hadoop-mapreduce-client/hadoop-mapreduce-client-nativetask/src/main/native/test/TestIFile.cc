@@ -22,6 +22,7 @@
 #include "lib/BufferStream.h"
 #include "lib/FileSystem.h"
 #include "lib/IFile.h"
+#include "lib/NativeObjectFactory.h"
 #include "test_commons.h"
 
 SingleSpillInfo * writeIFile(int partition, vector<pair<string, string> > & kvs,
@@ -94,6 +95,77 @@ TEST(IFile, WriteRead) {
 #if defined HADOOP_SNAPPY_LIBRARY
   TestIFileReadWrite(TextType, partition, size, kvs, "org.apache.hadoop.io.compress.SnappyCodec");
 #endif
+#if defined HADOOP_ZSTD_LIBRARY
+  TestIFileReadWrite(TextType, partition, size, kvs, "org.apache.hadoop.io.compress.ZStandardCodec");
+#endif
+}
+
+static void ReadMappedIFile(vector<pair<string, string> > & kvs, const string & path,
+    SingleSpillInfo * info, uint32_t startPartition, uint32_t endPartition) {
+  IFileReader * ir = new IFileReader(new MappedFile(path), info, startPartition, endPartition);
+  while (ir->nextPartition()) {
+    const char * key, *value;
+    uint32_t keyLen, valueLen;
+    while (NULL != (key = ir->nextKey(keyLen))) {
+      value = ir->value(valueLen);
+      kvs.push_back(std::make_pair(string(key, keyLen), string(value, valueLen)));
+    }
+  }
+  delete ir;
+}
+
+TEST(IFile, MappedRead) {
+  const int partition = 7;
+  vector<pair<string, string> > kvs;
+  Generate(kvs, 20000, "bytes");
+  KeyValueType types[] = {TextType, BytesType, UnknownType};
+  for (size_t t = 0; t < sizeof(types) / sizeof(KeyValueType); t++) {
+    SingleSpillInfo * info = writeIFile(partition, kvs, "ifilemapped", types[t], "");
+    ASSERT_TRUE(IFileReader::canMap(info));
+
+    vector<pair<string, string> > expect;
+    vector<pair<string, string> > actual;
+    readIFile(expect, "ifilemapped", types[t], info, "");
+    ReadMappedIFile(actual, "ifilemapped", info, 0, UINT32_MAX);
+    ASSERT_EQ(kvs.size() * partition, actual.size());
+    ASSERT_TRUE(expect == actual);
+
+    actual.clear();
+    ReadMappedIFile(actual, "ifilemapped", info, 2, 5);
+    ASSERT_EQ(kvs.size() * 3, actual.size());
+    vector<pair<string, string> > range(expect.begin() + kvs.size() * 2,
+        expect.begin() + kvs.size() * 5);
+    ASSERT_TRUE(range == actual);
+    delete info;
+  }
+
+  // a corrupted segment fails its checksum before any record is returned
+  SingleSpillInfo * info = writeIFile(partition, kvs, "ifilemapped", TextType, "");
+  string content;
+  ReadFile(content, "ifilemapped");
+  content[info->segments[3].realEndOffset - 10] ^= 0x5a;
+  WriteFile(content, "ifilemapped");
+  vector<pair<string, string> > actual;
+  ASSERT_THROW(ReadMappedIFile(actual, "ifilemapped", info, 0, UINT32_MAX), IOException);
+  ASSERT_EQ(kvs.size() * 3, actual.size());
+
+  SingleSpillInfo * compressed = writeIFile(1, kvs, "ifilemapped", TextType,
+      "org.apache.hadoop.io.compress.Lz4Codec");
+  ASSERT_FALSE(IFileReader::canMap(compressed));
+  delete compressed;
+  delete info;
+  FileSystem::getLocal().remove("ifilemapped");
+}
+
+TEST(IFile, PipelinedBlockCodec) {
+  int partition = TestConfig.getInt("ifile.partition", 7);
+  int size = TestConfig.getInt("partition.size", 20000);
+  vector<pair<string, string> > kvs;
+  Generate(kvs, size, "bytes");
+  // blocks of every segment are read ahead up to the segment limit
+  NativeObjectFactory::GetConfig().setInt(NATIVE_COMPRESS_THREADS, 3);
+  TestIFileReadWrite(TextType, partition, size, kvs, "org.apache.hadoop.io.compress.Lz4Codec");
+  NativeObjectFactory::GetConfig().setInt(NATIVE_COMPRESS_THREADS, 0);
 }
 
 void TestIFileWriteRead2(vector<pair<string, string> > & kvs, char * buff, size_t buffsize,
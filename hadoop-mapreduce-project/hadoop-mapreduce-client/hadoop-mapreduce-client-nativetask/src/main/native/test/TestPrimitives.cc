@@ -42,6 +42,61 @@ TEST(Primitives, fmemcmp) {
   }
 }
 
+typedef int64_t (*MemcmpFunc)(const char * src, const char * dest, uint32_t len);
+
+static int64_t fmemcmp_inline(const char * src, const char * dest, uint32_t len) {
+  return fmemcmp(src, dest, len);
+}
+
+static int64_t memcmp_builtin(const char * src, const char * dest, uint32_t len) {
+  return memcmp(src, dest, len);
+}
+
+static vector<pair<string, MemcmpFunc> > & MemcmpFuncs(vector<pair<string, MemcmpFunc> > & dest) {
+  dest.push_back(std::make_pair(string("memcmp"), memcmp_builtin));
+  dest.push_back(std::make_pair(string("fmemcmp"), fmemcmp_inline));
+  dest.push_back(std::make_pair(string("scalar"), fmemcmp_scalar));
+#if defined(__x86_64__)
+  dest.push_back(std::make_pair(string("sse2"), fmemcmp_sse2));
+  if (string(fmemcmp_long_name) == "avx2") {
+    dest.push_back(std::make_pair(string("avx2"), fmemcmp_avx2));
+  }
+#elif defined(__aarch64__)
+  dest.push_back(std::make_pair(string("neon"), fmemcmp_neon));
+#endif
+  return dest;
+}
+
+static int Sign(int64_t v) {
+  return v > 0 ? 1 : (v < 0 ? -1 : 0);
+}
+
+TEST(Primitives, fmemcmpVector) {
+  vector<pair<string, MemcmpFunc> > funcs;
+  MemcmpFuncs(funcs);
+  LOG("fmemcmp long keys use %s", fmemcmp_long_name);
+  Random r(7);
+  char src[320];
+  char dest[320];
+  for (uint32_t len = 0; len <= 300; len++) {
+    for (uint32_t round = 0; round < 20; round++) {
+      // unaligned start, equal prefix, one or no differing byte
+      uint32_t offset = round % 8;
+      for (uint32_t i = 0; i < len; i++) {
+        src[offset + i] = dest[offset + i] = (char)r.next_int32(256);
+      }
+      if (len > 0 && round > 0) {
+        dest[offset + r.next_int32(len)] = (char)r.next_int32(256);
+      }
+      int expect = Sign(memcmp(src + offset, dest + offset, len));
+      for (size_t f = 0; f < funcs.size(); f++) {
+        ASSERT_EQ(expect, Sign(funcs[f].second(src + offset, dest + offset, len)))
+            << funcs[f].first << " len " << len;
+      }
+    }
+  }
+}
+
 static int test_memcmp() {
   uint8_t buff[2048];
   for (uint32_t i = 0; i < 2048; i++) {
@@ -95,6 +150,40 @@ TEST(Perf, fmemcmp) {
   TestConfig.setInt("tempvalue", a + b);
 }
 
+TEST(Perf, fmemcmpKeyLength) {
+  vector<pair<string, MemcmpFunc> > funcs;
+  MemcmpFuncs(funcs);
+  const uint32_t lengths[] = {4, 8, 12, 16, 24, 32, 48, 64, 100, 128, 200, 256};
+  const uint32_t numKeys = 1024;
+  const uint32_t maxLen = 256;
+  uint64_t times = TestConfig.getInt("fmemcmp.times", 20000000);
+  // keys share a prefix and differ near the end, the worst case for sort
+  char * keys = new char[numKeys * maxLen];
+  Random r(13);
+  int64_t sink = 0;
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(uint32_t); l++) {
+    uint32_t len = lengths[l];
+    memset(keys, 'a', numKeys * maxLen);
+    for (uint32_t i = 0; i < numKeys; i++) {
+      keys[i * maxLen + len - 1 - r.next_int32(std::min(len, 4U))] = 'a' + r.next_int32(3);
+    }
+    string line = StringUtil::Format("len %3u:", len);
+    for (size_t f = 0; f < funcs.size(); f++) {
+      MemcmpFunc func = funcs[f].second;
+      Timer t;
+      for (uint64_t i = 0; i < times; i++) {
+        sink += func(keys + (i % numKeys) * maxLen, keys + ((i * 7 + 1) % numKeys) * maxLen, len);
+      }
+      line.append(StringUtil::Format(" %s %.1fns", funcs[f].first.c_str(),
+          (t.now() - t.last()) / (double)times));
+    }
+    LOG("%s", line.c_str());
+  }
+  delete[] keys;
+  // prevent compiler optimization
+  TestConfig.setInt("tempvalue", sink);
+}
+
 static void test_memcpy_perf_len(char * src, char * dest, size_t len, size_t time) {
   for (size_t i = 0; i < time; i++) {
     memcpy(src, dest, len);
@@ -20,6 +20,10 @@
 #include "lib/Streams.h"
 #include "lib/Buffers.h"
 #include "util/DualPivotQuickSort.h"
+#include "lib/MapOutputSpec.h"
+#include "lib/MemoryBlock.h"
+#include "lib/MemoryPool.h"
+#include "lib/PartitionBucket.h"
 #include "test_commons.h"
 
 string gBuffer;
@@ -304,3 +308,193 @@ TEST(Perf, sortCacheMiss) {
     LOG("%s, MOD: %d", timer.getInterval("DualPivotQuicksort 2 partition sort").c_str(), MOD);
   }
 }
+
+/**
+ * fill a MemoryBlock with KVBuffers whose keys are of keyType
+ */
+static void makeMemoryBlock(MemoryBlock & block, KeyValueType keyType) {
+  Random r(keyType);
+  string k, v;
+  while (true) {
+    switch (keyType) {
+    case IntType: {
+      uint32_t key = bswap(r.next_uint32());
+      k.assign((const char *)&key, 4);
+    }
+      break;
+    case LongType: {
+      uint64_t key = bswap64(r.next_uint64());
+      k.assign((const char *)&key, 8);
+    }
+      break;
+    case FloatType: {
+      float f = (float)(int32_t)r.next_uint32() / 3;
+      uint32_t key;
+      memcpy(&key, &f, 4);
+      key = bswap(key);
+      k.assign((const char *)&key, 4);
+    }
+      break;
+    case DoubleType: {
+      double d = (double)(int64_t)r.next_uint64() / 3;
+      uint64_t key;
+      memcpy(&key, &d, 8);
+      key = bswap64(key);
+      k.assign((const char *)&key, 8);
+    }
+      break;
+    default:
+      k = r.nextWord();
+      k.append(r.nextWord());
+    }
+    v = r.nextWord();
+    uint32_t length = KVBuffer::headerLength() + k.length() + v.length();
+    if (block.remainSpace() < length) {
+      return;
+    }
+    KVBuffer * kv = block.allocateKVBuffer(length);
+    kv->fill(k.data(), k.length(), v.data(), v.length());
+  }
+}
+
+static void testKeyPrefixSort(KeyValueType keyType, SortAlgorithm sortType, const char * name) {
+  const uint32_t BLOCK_SIZE = 64 * 1024 * 1024;
+  char * buff = new char[BLOCK_SIZE];
+  ComparatorPtr comparator = get_comparator(keyType, NULL);
+  Timer timer;
+  {
+    MemoryBlock block(buff, BLOCK_SIZE);
+    makeMemoryBlock(block, keyType);
+    timer.reset();
+    block.sort(sortType, comparator);
+    LOG("%s", timer.getInterval(StringUtil::Format("%s, records: %u", name,
+        block.getKVCount()).c_str()).c_str());
+  }
+  {
+    MemoryBlock block(buff, BLOCK_SIZE);
+    makeMemoryBlock(block, keyType);
+    timer.reset();
+    block.sort(sortType, comparator, keyType);
+    LOG("%s", timer.getInterval(StringUtil::Format("%s with key prefix", name).c_str()).c_str());
+  }
+  delete [] buff;
+}
+
+TEST(Perf, sortKeyPrefix) {
+  testKeyPrefixSort(TextType, CPPSORT, "Text std::sort");
+  testKeyPrefixSort(TextType, DUALPIVOTSORT, "Text DualPivotQuicksort");
+  testKeyPrefixSort(IntType, DUALPIVOTSORT, "Int DualPivotQuicksort");
+  testKeyPrefixSort(LongType, DUALPIVOTSORT, "Long DualPivotQuicksort");
+}
+
+static void testRadixSort(KeyValueType keyType, const char * name) {
+  const uint32_t BLOCK_SIZE = 64 * 1024 * 1024;
+  char * buff = new char[BLOCK_SIZE];
+  ComparatorPtr comparator = get_comparator(keyType, NULL);
+  Timer timer;
+  {
+    MemoryBlock block(buff, BLOCK_SIZE);
+    makeMemoryBlock(block, keyType);
+    timer.reset();
+    block.sort(DUALPIVOTSORT, comparator, keyType);
+    LOG("%s", timer.getInterval(StringUtil::Format("%s DualPivotQuicksort with key prefix, "
+        "records: %u", name, block.getKVCount()).c_str()).c_str());
+  }
+  {
+    MemoryBlock block(buff, BLOCK_SIZE);
+    makeMemoryBlock(block, keyType);
+    timer.reset();
+    block.sort(RADIXSORT, comparator, keyType);
+    LOG("%s", timer.getInterval(StringUtil::Format("%s radix sort", name).c_str()).c_str());
+  }
+  delete [] buff;
+}
+
+TEST(Perf, radixSort) {
+  testRadixSort(TextType, "Text");
+  testRadixSort(IntType, "Int");
+  testRadixSort(LongType, "Long");
+  testRadixSort(FloatType, "Float");
+  testRadixSort(DoubleType, "Double");
+}
+
+static ComparatorPtr gWrappedComparator = NULL;
+
+/**
+ * not one of the built-in comparators, so sorts call it through
+ * the pointer like a comparator from a NativeLibrary
+ */
+static int WrappedComparator(const char * src, uint32_t srcLength, const char * dest,
+    uint32_t destLength) {
+  return (*gWrappedComparator)(src, srcLength, dest, destLength);
+}
+
+static void testStaticComparator(KeyValueType keyType, SortAlgorithm sortType,
+    const char * name) {
+  const uint32_t BLOCK_SIZE = 64 * 1024 * 1024;
+  char * buff = new char[BLOCK_SIZE];
+  gWrappedComparator = get_comparator(keyType, NULL);
+  Timer timer;
+  {
+    MemoryBlock block(buff, BLOCK_SIZE);
+    makeMemoryBlock(block, keyType);
+    timer.reset();
+    block.sort(sortType, &WrappedComparator);
+    LOG("%s", timer.getInterval(StringUtil::Format("%s through ComparatorPtr, records: %u", name,
+        block.getKVCount()).c_str()).c_str());
+  }
+  {
+    MemoryBlock block(buff, BLOCK_SIZE);
+    makeMemoryBlock(block, keyType);
+    timer.reset();
+    block.sort(sortType, gWrappedComparator);
+    LOG("%s", timer.getInterval(StringUtil::Format("%s inlined", name).c_str()).c_str());
+  }
+  delete [] buff;
+}
+
+TEST(Perf, sortStaticComparator) {
+  testStaticComparator(TextType, CPPSORT, "Text std::sort");
+  testStaticComparator(TextType, DUALPIVOTSORT, "Text DualPivotQuicksort");
+  testStaticComparator(IntType, DUALPIVOTSORT, "Int DualPivotQuicksort");
+  testStaticComparator(LongType, DUALPIVOTSORT, "Long DualPivotQuicksort");
+  testStaticComparator(DoubleType, DUALPIVOTSORT, "Double DualPivotQuicksort");
+}
+
+static void testWholePartitionSort(bool wholeSort, const char * name) {
+  const uint32_t POOL_SIZE = 64 * 1024 * 1024;
+  const uint32_t BLOCK_SIZE = 16 * 1024;
+  MemoryPool pool;
+  pool.init(POOL_SIZE);
+  ComparatorPtr comparator = get_comparator(TextType, NULL);
+  PartitionBucket bucket(&pool, 0, comparator, NULL, BLOCK_SIZE, TextType, wholeSort);
+  Random r(0);
+  string k, v;
+  while (true) {
+    k = r.nextWord();
+    k.append(r.nextWord());
+    v = r.nextWord();
+    KVBuffer * kv = bucket.allocateKVBuffer(KVBuffer::headerLength() + k.length() + v.length());
+    if (NULL == kv) {
+      break;
+    }
+    kv->fill(k.data(), k.length(), v.data(), v.length());
+  }
+  Timer timer;
+  bucket.sort(DUALPIVOTSORT);
+  KVIterator * iter = bucket.getIterator();
+  Buffer key;
+  Buffer value;
+  uint64_t count = 0;
+  while (iter->next(key, value)) {
+    count++;
+  }
+  delete iter;
+  LOG("%s", timer.getInterval(StringUtil::Format("%s, blocks: %u, records: %llu", name,
+      bucket.getMemoryBlockCount(), count).c_str()).c_str());
+}
+
+TEST(Perf, wholePartitionSort) {
+  testWholePartitionSort(false, "Sort blocks and merge");
+  testWholePartitionSort(true, "Sort whole partition");
+}
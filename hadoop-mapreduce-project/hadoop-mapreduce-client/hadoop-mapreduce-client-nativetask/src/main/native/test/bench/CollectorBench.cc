@@ -0,0 +1,492 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * ntbench: drives MapOutputCollector through collect, mid spills and the
+ * final spill & merge with synthetic records, and prints the results as
+ * JSON, so the whole native map output path can be measured without a JVM.
+ *
+ * usage: ntbench [key=value]...
+ *
+ * A bench.* key given more than once, or as a comma separated list, adds
+ * a dimension: every combination of the values is run as its own case.
+ * All other keys are passed to the collector as job configuration, e.g.
+ * mapreduce.task.io.sort.mb=50 or native.sort.spill.threads=4.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include "lib/commons.h"
+#include "util/Random.h"
+#include "util/StringUtil.h"
+#include "util/Timer.h"
+#include "lib/FileSystem.h"
+#include "lib/MapOutputCollector.h"
+#include "lib/NativeObjectFactory.h"
+#include "lib/TaskCounters.h"
+
+namespace NativeTask {
+
+#define BENCH_RECORDS "bench.records"
+#define BENCH_KEYS "bench.keys"
+#define BENCH_KEY_LENGTH "bench.key.length"
+#define BENCH_VALUE_LENGTH "bench.value.length"
+#define BENCH_PARTITIONS "bench.partitions"
+#define BENCH_CODEC "bench.codec"
+#define BENCH_SORT "bench.sort"
+#define BENCH_CARDINALITY "bench.zipf.cardinality"
+#define BENCH_ZIPF_EXPONENT "bench.zipf.exponent"
+#define BENCH_RUNS "bench.runs"
+#define BENCH_SEED "bench.seed"
+#define BENCH_DIR "bench.dir"
+#define BENCH_LABEL "bench.label"
+#define BENCH_OUTPUT "bench.output"
+
+static const uint32_t VALUE_POOL_SIZE = 1024 * 1024;
+
+struct BenchCase {
+  string keys;
+  uint32_t keyLength;
+  uint32_t valueLength;
+  uint32_t partitions;
+  string codec;
+  string sort;
+};
+
+struct BenchRun {
+  // collect() calls, mid spills excluded
+  uint64_t collectTime;
+  uint64_t midSpillTime;
+  uint64_t closeTime;
+  // collector phases, see CollectorTimes
+  uint64_t sortTime;
+  uint64_t spillTime;
+  uint64_t mergeTime;
+  uint32_t spills;
+  uint64_t outputBytes;
+  uint64_t spilledRecords;
+
+  uint64_t totalTime() const {
+    return collectTime + midSpillTime + closeTime;
+  }
+
+  bool operator<(const BenchRun & other) const {
+    return totalTime() < other.totalTime();
+  }
+};
+
+/**
+ * names spills like the task would, and removes them once the run is done
+ */
+class BenchSpillOutputService : public SpillOutputService {
+private:
+  string _prefix;
+  uint32_t _spillCount;
+
+public:
+  BenchSpillOutputService(const string & prefix)
+      : _prefix(prefix), _spillCount(0) {
+  }
+
+  virtual string * getSpillPath() {
+    return new string(StringUtil::Format("%s.spill%u", _prefix.c_str(), _spillCount++));
+  }
+
+  virtual string * getOutputPath() {
+    return new string(_prefix + ".out");
+  }
+
+  virtual string * getOutputIndexPath() {
+    return new string(_prefix + ".out.index");
+  }
+
+  virtual CombineHandler * getJavaCombineHandler() {
+    return NULL;
+  }
+
+  uint32_t getSpillCount() const {
+    return _spillCount;
+  }
+
+  void clean() {
+    FileSystem & fs = FileSystem::getLocal();
+    for (uint32_t i = 0; i < _spillCount; i++) {
+      string path = StringUtil::Format("%s.spill%u", _prefix.c_str(), i);
+      if (fs.exists(path)) {
+        fs.remove(path);
+      }
+    }
+    fs.remove(_prefix + ".out");
+    fs.remove(_prefix + ".out.index");
+  }
+};
+
+/**
+ * records generated up front, so only the collector is timed
+ * keys:
+ *   uniform  random keys, practically all distinct
+ *   zipf     keys drawn from bench.zipf.cardinality distinct keys with
+ *            a Zipf distribution, the first keys being the hottest
+ *   sorted   ascending keys, already in output order
+ */
+class Workload {
+private:
+  string _data;
+  vector<uint64_t> _offsets;
+  vector<uint32_t> _partitions;
+  uint32_t _keyLength;
+  uint32_t _valueLength;
+
+public:
+  Workload(const BenchCase & bench, uint64_t records, uint64_t cardinality, double exponent,
+      int64_t seed)
+      : _keyLength(bench.keyLength), _valueLength(bench.valueLength) {
+    if (bench.keys != "uniform" && bench.keys != "zipf" && bench.keys != "sorted") {
+      THROW_EXCEPTION_EX(UnsupportException, "unknown key distribution: %s", bench.keys.c_str());
+    }
+    Random r(seed);
+    string valuePool = r.nextBytes(VALUE_POOL_SIZE, "abcdefghijklmnopqrstuvwxyz0123456789");
+    vector<double> cdf;
+    if (bench.keys == "zipf") {
+      zipfDistribution(cdf, cardinality, exponent);
+    }
+
+    const uint32_t recordLength = _keyLength + _valueLength;
+    _data.resize(records * recordLength);
+    _offsets.reserve(records);
+    _partitions.reserve(records);
+    char * dest = (char *)_data.data();
+    for (uint64_t i = 0; i < records; i++) {
+      uint64_t offset = i * recordLength;
+      char * key = dest + offset;
+      if (bench.keys == "uniform") {
+        hexKey(key, r.next_uint64());
+      } else if (bench.keys == "zipf") {
+        uint64_t rank = std::upper_bound(cdf.begin(), cdf.end(), r.nextDouble()) - cdf.begin();
+        // scramble the rank so that hot keys don't cluster in sort order
+        hexKey(key, std::min(rank, cardinality - 1) * 0x9E3779B97F4A7C15ULL);
+      } else {
+        sortedKey(key, i);
+      }
+      char * value = key + _keyLength;
+      for (uint32_t filled = 0; filled < _valueLength;) {
+        uint32_t start = r.next_int32(VALUE_POOL_SIZE);
+        uint32_t len = std::min(_valueLength - filled, VALUE_POOL_SIZE - start);
+        memcpy(value + filled, valuePool.data() + start, len);
+        filled += len;
+      }
+      _offsets.push_back(offset);
+      _partitions.push_back(hash(key, _keyLength) % bench.partitions);
+    }
+  }
+
+  uint64_t size() const {
+    return _offsets.size();
+  }
+
+  uint64_t bytes() const {
+    return _data.length();
+  }
+
+  void collect(MapOutputCollector * collector) {
+    const char * data = _data.data();
+    for (size_t i = 0; i < _offsets.size(); i++) {
+      const char * key = data + _offsets[i];
+      collector->collect(key, _keyLength, key + _keyLength, _valueLength, _partitions[i]);
+    }
+  }
+
+private:
+  static void zipfDistribution(vector<double> & cdf, uint64_t cardinality, double exponent) {
+    cdf.resize(cardinality);
+    double sum = 0;
+    for (uint64_t k = 0; k < cardinality; k++) {
+      sum += 1.0 / pow((double)(k + 1), exponent);
+      cdf[k] = sum;
+    }
+    for (uint64_t k = 0; k < cardinality; k++) {
+      cdf[k] /= sum;
+    }
+  }
+
+  void hexKey(char * dest, uint64_t id) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016" PRIx64, id);
+    for (uint32_t i = 0; i < _keyLength; i++) {
+      dest[i] = hex[i % 16];
+    }
+  }
+
+  void sortedKey(char * dest, uint64_t id) {
+    // zero padded decimal, ascending as long as the key is wide enough
+    for (uint32_t i = _keyLength; i > 0; i--) {
+      dest[i - 1] = '0' + (char)(id % 10);
+      id /= 10;
+    }
+  }
+
+  static uint32_t hash(const char * data, uint32_t length) {
+    uint32_t h = 2166136261U;
+    for (uint32_t i = 0; i < length; i++) {
+      h = (h ^ (uint8_t)data[i]) * 16777619U;
+    }
+    return h;
+  }
+};
+
+static string CodecClass(const string & codec) {
+  if (codec == "gzip") {
+    return "org.apache.hadoop.io.compress.GzipCodec";
+  } else if (codec == "snappy") {
+    return "org.apache.hadoop.io.compress.SnappyCodec";
+  } else if (codec == "lz4") {
+    return "org.apache.hadoop.io.compress.Lz4Codec";
+  } else if (codec == "zstd") {
+    return "org.apache.hadoop.io.compress.ZStandardCodec";
+  }
+  return codec;
+}
+
+static string JsonString(const string & str) {
+  string ret = "\"";
+  for (size_t i = 0; i < str.length(); i++) {
+    char c = str[i];
+    if (c == '"' || c == '\\') {
+      ret.append(1, '\\');
+      ret.append(1, c);
+    } else if ((uint8_t)c < 0x20) {
+      ret.append(StringUtil::Format("\\u%04x", (uint32_t)(uint8_t)c));
+    } else {
+      ret.append(1, c);
+    }
+  }
+  ret.append("\"");
+  return ret;
+}
+
+static void GetStrings(Config & config, const string & name, const string & defaultValue,
+    vector<string> & dest) {
+  config.getStrings(name, dest);
+  if (dest.empty()) {
+    StringUtil::Split(defaultValue, ",", dest, true);
+  }
+}
+
+static void GetInts(Config & config, const string & name, int64_t defaultValue,
+    vector<uint32_t> & dest) {
+  vector<int64_t> values;
+  config.getInts(name, values);
+  if (values.empty()) {
+    values.push_back(defaultValue);
+  }
+  for (size_t i = 0; i < values.size(); i++) {
+    if (values[i] <= 0) {
+      THROW_EXCEPTION_EX(IOException, "%s must be positive", name.c_str());
+    }
+    dest.push_back((uint32_t)values[i]);
+  }
+}
+
+static BenchRun RunOnce(Config & jobConfig, const BenchCase & bench, Workload & workload,
+    const string & prefix) {
+  Config config = jobConfig;
+  config.set(MAPRED_MAPOUTPUT_KEY_CLASS, "org.apache.hadoop.io.Text");
+  config.set(MAPRED_MAPOUTPUT_VALUE_CLASS, "org.apache.hadoop.io.Text");
+  config.set(NATIVE_SORT_TYPE, bench.sort);
+  if (bench.codec != "none") {
+    config.setBool(MAPRED_COMPRESS_MAP_OUTPUT, true);
+    config.set(MAPRED_MAP_OUTPUT_COMPRESSION_CODEC, CodecClass(bench.codec));
+  }
+  Counter * spilledRecords = NativeObjectFactory::GetCounter(TaskCounters::TASK_COUNTER_GROUP,
+      TaskCounters::SPILLED_RECORDS);
+  uint64_t spilledBefore = spilledRecords->get();
+
+  BenchRun run;
+  BenchSpillOutputService service(prefix);
+  MapOutputCollector * collector = new MapOutputCollector(bench.partitions, &service);
+  try {
+    collector->configure(&config);
+    Timer timer;
+    workload.collect(collector);
+    run.collectTime = timer.now() - timer.last();
+    timer.reset();
+    collector->close();
+    run.closeTime = timer.now() - timer.last();
+
+    const CollectorTimes & times = collector->getTimes();
+    run.midSpillTime = std::min(times.midSpillTime, run.collectTime);
+    run.collectTime -= run.midSpillTime;
+    run.sortTime = times.sortTime;
+    run.spillTime = times.spillTime;
+    run.mergeTime = times.mergeTime;
+  } catch (...) {
+    delete collector;
+    service.clean();
+    throw;
+  }
+  delete collector;
+  run.spills = service.getSpillCount();
+  run.outputBytes = FileSystem::getLocal().getLength(prefix + ".out");
+  run.spilledRecords = spilledRecords->get() - spilledBefore;
+  service.clean();
+  return run;
+}
+
+static string RunCase(Config & config, const BenchCase & bench) {
+  int64_t records = config.getInt(BENCH_RECORDS, 1000000);
+  int64_t cardinality = config.getInt(BENCH_CARDINALITY, 100000);
+  float exponent = config.getFloat(BENCH_ZIPF_EXPONENT, 1.0);
+  int64_t runs = config.getInt(BENCH_RUNS, 3);
+  int64_t seed = config.getInt(BENCH_SEED, 0);
+  string prefix = config.get(BENCH_DIR, ".") + "/ntbench";
+
+  string json = StringUtil::Format("{\"keys\": %s, \"key_length\": %u, \"value_length\": %u, "
+      "\"partitions\": %u, \"codec\": %s, \"sort\": %s, ",
+      JsonString(bench.keys).c_str(), bench.keyLength, bench.valueLength, bench.partitions,
+      JsonString(bench.codec).c_str(), JsonString(bench.sort).c_str());
+  try {
+    if (records <= 0 || cardinality <= 0 || runs <= 0) {
+      THROW_EXCEPTION(IOException, "records, cardinality and runs must be positive");
+    }
+    Workload workload(bench, records, cardinality, exponent, seed);
+    vector<BenchRun> results;
+    for (int64_t i = 0; i < runs; i++) {
+      results.push_back(RunOnce(config, bench, workload, prefix));
+    }
+    std::sort(results.begin(), results.end());
+    const BenchRun & median = results[results.size() / 2];
+
+    const double seconds = median.totalTime() / 1e9;
+    const double M = 1000000; // million
+    json.append(StringUtil::Format("\"records\": %" PRIu64 ", \"bytes\": %" PRIu64 ", "
+        "\"runs\": %" PRId64 ", \"spills\": %u, \"spilled_records\": %" PRIu64 ", "
+        "\"output_bytes\": %" PRIu64 ", \"collect_ms\": %.3f, \"mid_spill_ms\": %.3f, "
+        "\"close_ms\": %.3f, \"sort_ms\": %.3f, \"spill_ms\": %.3f, \"merge_ms\": %.3f, "
+        "\"total_ms\": %.3f, \"min_total_ms\": %.3f, \"max_total_ms\": %.3f, "
+        "\"records_per_sec\": %.0f, \"mb_per_sec\": %.2f}",
+        workload.size(), workload.bytes(), runs, median.spills, median.spilledRecords,
+        median.outputBytes, median.collectTime / M, median.midSpillTime / M,
+        median.closeTime / M, median.sortTime / M, median.spillTime / M, median.mergeTime / M,
+        median.totalTime() / M, results.front().totalTime() / M,
+        results.back().totalTime() / M, workload.size() / seconds,
+        workload.bytes() / seconds / (1024 * 1024)));
+  } catch (std::exception & e) {
+    LOG("[ntbench] case failed: %s", e.what());
+    // without the stack trace
+    string error = e.what();
+    error = error.substr(0, error.find('\n'));
+    json.append(StringUtil::Format("\"error\": %s}", JsonString(error).c_str()));
+  }
+  return json;
+}
+
+int BenchMain(int argc, const char ** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      fprintf(stdout, "usage: %s [key=value]...\n"
+          "  " BENCH_RECORDS "=1000000\n"
+          "  " BENCH_KEYS "=uniform,zipf,sorted\n"
+          "  " BENCH_KEY_LENGTH "=10\n"
+          "  " BENCH_VALUE_LENGTH "=90\n"
+          "  " BENCH_PARTITIONS "=100\n"
+          "  " BENCH_CODEC "=none (or gzip, snappy, lz4, zstd, a codec class)\n"
+          "  " BENCH_SORT "=DUALPIVOTSORT (or RADIXSORT, CPPSORT)\n"
+          "  " BENCH_CARDINALITY "=100000\n"
+          "  " BENCH_ZIPF_EXPONENT "=1.0\n"
+          "  " BENCH_RUNS "=3, the run with the median total time is reported\n"
+          "  " BENCH_SEED "=0\n"
+          "  " BENCH_DIR "=. where spills are written\n"
+          "  " BENCH_LABEL "= e.g. a commit id, copied to the report\n"
+          "  " BENCH_OUTPUT "= report file, stdout if empty\n"
+          "other keys are passed to the collector, e.g. " MAPRED_IO_SORT_MB "=100\n", argv[0]);
+      return 0;
+    }
+  }
+  Config config;
+  config.parse(argc - 1, argv + 1);
+  if (NULL == config.get(MAPRED_IO_SORT_MB)) {
+    config.setInt(MAPRED_IO_SORT_MB, 100);
+  }
+
+  vector<string> keys;
+  vector<uint32_t> keyLengths;
+  vector<uint32_t> valueLengths;
+  vector<uint32_t> partitions;
+  vector<string> codecs;
+  vector<string> sorts;
+  try {
+    GetStrings(config, BENCH_KEYS, "uniform,zipf,sorted", keys);
+    GetInts(config, BENCH_KEY_LENGTH, 10, keyLengths);
+    GetInts(config, BENCH_VALUE_LENGTH, 90, valueLengths);
+    GetInts(config, BENCH_PARTITIONS, 100, partitions);
+    GetStrings(config, BENCH_CODEC, "none", codecs);
+    GetStrings(config, BENCH_SORT, "DUALPIVOTSORT", sorts);
+  } catch (std::exception & e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  FILE * out = stdout;
+  string output = config.get(BENCH_OUTPUT, "");
+  if (output.length() > 0) {
+    out = fopen(output.c_str(), "w");
+    if (NULL == out) {
+      fprintf(stderr, "can't open %s: %s\n", output.c_str(), strerror(errno));
+      return 1;
+    }
+  }
+  fprintf(out, "{\"label\": %s, \"results\": [", JsonString(config.get(BENCH_LABEL, "")).c_str());
+  bool first = true;
+  bool failed = false;
+  BenchCase bench;
+  for (size_t k = 0; k < keys.size(); k++) {
+    for (size_t kl = 0; kl < keyLengths.size(); kl++) {
+      for (size_t vl = 0; vl < valueLengths.size(); vl++) {
+        for (size_t p = 0; p < partitions.size(); p++) {
+          for (size_t c = 0; c < codecs.size(); c++) {
+            for (size_t s = 0; s < sorts.size(); s++) {
+              bench.keys = keys[k];
+              bench.keyLength = keyLengths[kl];
+              bench.valueLength = valueLengths[vl];
+              bench.partitions = partitions[p];
+              bench.codec = codecs[c];
+              bench.sort = sorts[s];
+              string result = RunCase(config, bench);
+              failed |= result.find("\"error\"") != string::npos;
+              fprintf(out, "%s\n  %s", first ? "" : ",", result.c_str());
+              fflush(out);
+              first = false;
+            }
+          }
+        }
+      }
+    }
+  }
+  fprintf(out, "\n]}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  NativeObjectFactory::Release();
+  return failed ? 1 : 0;
+}
+
+} // namespace NativeTask
+
+int main(int argc, char ** argv) {
+  return NativeTask::BenchMain(argc, (const char **)argv);
+}
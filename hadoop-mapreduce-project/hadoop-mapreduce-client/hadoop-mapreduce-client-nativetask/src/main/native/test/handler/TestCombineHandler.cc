@@ -0,0 +1,242 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "lib/commons.h"
+#include "test_commons.h"
+#include "util/WritableUtils.h"
+#include "lib/NativeObjectFactory.h"
+#include "handler/CombineHandler.h"
+
+namespace NativeTask {
+
+class PairIterator : public KVIterator {
+private:
+  vector<pair<string, string> > & _kvs;
+  size_t _index;
+
+public:
+  PairIterator(vector<pair<string, string> > & kvs)
+      : _kvs(kvs), _index(0) {
+  }
+
+  virtual bool next(Buffer & key, Buffer & value) {
+    if (_index >= _kvs.size()) {
+      return false;
+    }
+    pair<string, string> & p = _kvs[_index++];
+    key.reset(p.first.c_str(), p.first.length());
+    value.reset(p.second.c_str(), p.second.length());
+    return true;
+  }
+};
+
+/**
+ * CombineHandler keeping the batches it would flush to java
+ */
+class TestCombineHandler : public CombineHandler {
+private:
+  char * _outputBuffer;
+  PairIterator * _iterator;
+
+public:
+  string output;
+
+  TestCombineHandler(KeyValueType keyType, KeyValueType valueType, uint32_t outputSize)
+      : _iterator(NULL) {
+    _kType = keyType;
+    _vType = valueType;
+    _outputBuffer = new char[outputSize];
+    _out.reset(_outputBuffer, outputSize);
+    _out.rewind(0, outputSize);
+  }
+
+  ~TestCombineHandler() {
+    delete _iterator;
+    delete[] _outputBuffer;
+  }
+
+  void setInput(vector<pair<string, string> > & kvs) {
+    delete _iterator;
+    _iterator = new PairIterator(kvs);
+    _kvIterator = _iterator;
+  }
+
+  /**
+   * serialize the next record with the in-place path if it fits the
+   * output buffer, or else with the per field path
+   */
+  bool serializeNext(bool inPlace) {
+    if (!nextKeyValue(_key, _value)) {
+      return false;
+    }
+    uint32_t kvLength = _key.outerLength + _value.outerLength + KVBuffer::headerLength();
+    if (inPlace) {
+      EXPECT_LE(kvLength, _out.remain());
+      outputKeyValue(kvLength);
+    } else {
+      outputInt(bswap(_key.outerLength));
+      outputInt(bswap(_value.outerLength));
+      outputKeyOrValue(_key, _kType);
+      outputKeyOrValue(_value, _vType);
+    }
+    return true;
+  }
+
+  void flushOutput() {
+    output.append(_out.base(), _out.position());
+    _out.position(0);
+  }
+
+  void runCombine() {
+    CombineContext context(CONTINUOUS_MEMORY_BUFFER);
+    combine(context, _iterator, NULL);
+  }
+
+  uint32_t getLoadCount() {
+    return _combineLoadCount;
+  }
+
+protected:
+  /**
+   * java side of a combine: load batches until there is nothing left
+   */
+  virtual ResultBuffer * call(const Command & cmd, ParameterBuffer * param) {
+    size_t length;
+    do {
+      length = output.length();
+      onLoadData();
+    } while (output.length() > length);
+    return NULL;
+  }
+};
+
+/**
+ * writable serialization of a key or value as java reads it
+ */
+static void AppendWritable(string & dest, const string & data, KeyValueType type) {
+  char varBytes[8];
+  uint32_t varLength = 0;
+  uint32_t length = bswap((uint32_t)data.length());
+  switch (type) {
+  case TextType:
+    WritableUtils::WriteVInt(data.length(), varBytes, varLength);
+    dest.append(varBytes, varLength);
+    break;
+  case BytesType:
+    dest.append((const char *)&length, 4);
+    break;
+  default:
+    break;
+  }
+  dest.append(data);
+}
+
+static void Generate(vector<pair<string, string> > & kvs, KeyValueType type,
+    size_t count) {
+  Random r;
+  for (size_t i = 0; i < count; i++) {
+    string key;
+    string value;
+    switch (type) {
+    case IntType:
+      key = r.nextBytes(4, "0123456789");
+      value = r.nextBytes(4, "0123456789");
+      break;
+    case LongType:
+      key = r.nextBytes(8, "0123456789");
+      value = r.nextBytes(8, "0123456789");
+      break;
+    default:
+      // 1 and 3 byte VInt lengths, some keys larger than a small batch
+      key = r.nextBytes(r.next_int32(i % 50 == 0 ? 3000 : 300), "abcdefghijklmnopqrstuvwxyz");
+      value = r.nextBytes(r.next_int32(50), "abcdefghijklmnopqrstuvwxyz");
+      break;
+    }
+    kvs.push_back(std::make_pair(key, value));
+  }
+}
+
+static void TestSerialize(KeyValueType type) {
+  vector<pair<string, string> > kvs;
+  Generate(kvs, type, 1000);
+
+  string expect;
+  for (size_t i = 0; i < kvs.size(); i++) {
+    string key;
+    string value;
+    AppendWritable(key, kvs[i].first, type);
+    AppendWritable(value, kvs[i].second, type);
+    uint32_t header[2] = {bswap((uint32_t)key.length()), bswap((uint32_t)value.length())};
+    expect.append((const char *)header, sizeof(header));
+    expect.append(key).append(value);
+  }
+
+  // large enough to hold every record in place
+  TestCombineHandler inPlace(type, type, expect.length() + 1);
+  inPlace.setInput(kvs);
+  while (inPlace.serializeNext(true)) {
+  }
+  inPlace.flushOutput();
+
+  TestCombineHandler perField(type, type, 1025);
+  perField.setInput(kvs);
+  while (perField.serializeNext(false)) {
+  }
+  perField.flushOutput();
+
+  ASSERT_EQ(expect.length(), inPlace.output.length());
+  ASSERT_TRUE(expect == inPlace.output);
+  ASSERT_EQ(expect.length(), perField.output.length());
+  ASSERT_TRUE(expect == perField.output);
+
+  // a small buffer mixes both paths, records not fitting are split
+  TestCombineHandler mixed(type, type, 1025);
+  mixed.setInput(kvs);
+  mixed.runCombine();
+  ASSERT_EQ(expect.length(), mixed.output.length());
+  ASSERT_TRUE(expect == mixed.output);
+}
+
+TEST(CombineHandler, serialize) {
+  TestSerialize(TextType);
+  TestSerialize(BytesType);
+  TestSerialize(IntType);
+  TestSerialize(LongType);
+  TestSerialize(UnknownType);
+}
+
+TEST(CombineHandler, counters) {
+  Counter * loadCalls = NativeObjectFactory::GetCounter(CombineHandler::COUNTER_GROUP,
+      CombineHandler::LOAD_CALLS);
+  Counter * bytes = NativeObjectFactory::GetCounter(CombineHandler::COUNTER_GROUP,
+      CombineHandler::BYTES);
+  uint64_t before = loadCalls->get();
+  uint64_t bytesBefore = bytes->get();
+
+  vector<pair<string, string> > kvs;
+  Generate(kvs, TextType, 1000);
+  TestCombineHandler handler(TextType, TextType, 64 * 1024);
+  handler.setInput(kvs);
+  handler.runCombine();
+
+  // at least one load per batch, and a last one returning nothing
+  ASSERT_GT(handler.getLoadCount(), handler.output.length() / (64 * 1024) + 1);
+  ASSERT_EQ(before + handler.getLoadCount(), loadCalls->get());
+  ASSERT_EQ(bytesBefore + handler.output.length(), bytes->get());
+}
+
+} // namespace NativeTask
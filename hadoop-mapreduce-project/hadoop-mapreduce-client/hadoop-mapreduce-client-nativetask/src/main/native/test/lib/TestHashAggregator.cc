@@ -0,0 +1,149 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "test_commons.h"
+#include "lib/HashAggregator.h"
+
+namespace NativeTask {
+
+/**
+ * sums the uint32_t values of each key
+ */
+class SumCombiner : public ICombineRunner {
+public:
+  uint32_t calls;
+
+  SumCombiner()
+      : calls(0) {
+  }
+
+  virtual void combine(CombineContext type, KVIterator * kvIterator, Collector * writer) {
+    calls++;
+    Buffer key;
+    Buffer value;
+    string current;
+    uint32_t sum = 0;
+    bool first = true;
+    while (kvIterator->next(key, value)) {
+      string k(key.data(), key.length());
+      if (!first && k != current) {
+        writer->collect(current.data(), current.length(), &sum, sizeof(sum));
+        sum = 0;
+      }
+      first = false;
+      current = k;
+      sum += *(const uint32_t *)value.data();
+    }
+    if (!first) {
+      writer->collect(current.data(), current.length(), &sum, sizeof(sum));
+    }
+  }
+};
+
+static void ReadOutput(const string & output, vector<pair<string, uint32_t> > & records,
+    vector<uint32_t> & partitions) {
+  const char * pos = output.data();
+  const char * end = pos + output.length();
+  while (pos < end) {
+    KVBufferWithParititionId * record = (KVBufferWithParititionId *)pos;
+    partitions.push_back(record->partitionId);
+    records.push_back(std::make_pair(
+        string(record->buffer.getKey(), record->buffer.keyLength),
+        *(uint32_t *)record->buffer.getValue()));
+    pos += record->length();
+  }
+}
+
+static void Collect(HashAggregator & aggregator, uint32_t partition, const string & key,
+    uint32_t value, string & output) {
+  uint32_t length = KVBuffer::headerLength() + key.length() + sizeof(value);
+  KVBuffer * kv = aggregator.allocateKVBuffer(partition, length);
+  if (NULL == kv) {
+    aggregator.flush(output);
+    kv = aggregator.allocateKVBuffer(partition, length);
+  }
+  ASSERT_NE((void *)NULL, kv);
+  kv->fill(key.data(), key.length(), &value, sizeof(value));
+}
+
+TEST(HashAggregator, combine) {
+  SumCombiner combiner;
+  HashAggregator aggregator(1024 * 1024, get_comparator(TextType, NULL), &combiner);
+  ASSERT_TRUE(aggregator.empty());
+
+  string output;
+  const char * keys[] = {"b", "a", "c", "a", "bb", "b", "a"};
+  for (uint32_t i = 0; i < 7; i++) {
+    Collect(aggregator, i % 2, keys[i], i + 1, output);
+  }
+  ASSERT_FALSE(aggregator.empty());
+  ASSERT_EQ(0, output.length());
+  aggregator.flush(output);
+  ASSERT_TRUE(aggregator.empty());
+  ASSERT_EQ(2, combiner.calls);
+
+  vector<pair<string, uint32_t> > records;
+  vector<uint32_t> partitions;
+  ReadOutput(output, records, partitions);
+  // partition 0: b(1), c(3), bb(5), a(7); partition 1: a(2 + 4), b(6)
+  ASSERT_EQ(6, records.size());
+  uint32_t expectPartitions[] = {0, 0, 0, 0, 1, 1};
+  const char * expectKeys[] = {"a", "b", "bb", "c", "a", "b"};
+  uint32_t expectSums[] = {7, 1, 5, 3, 6, 6};
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(expectPartitions[i], partitions[i]);
+    ASSERT_EQ(string(expectKeys[i]), records[i].first);
+    ASSERT_EQ(expectSums[i], records[i].second);
+  }
+}
+
+TEST(HashAggregator, flushWhenFull) {
+  SumCombiner combiner;
+  // small enough to flush many times
+  HashAggregator aggregator(256 * 1024, get_comparator(TextType, NULL), &combiner);
+
+  const uint32_t NUM_KEYS = 1000;
+  const uint32_t NUM_RECORDS = 200000;
+  const uint32_t NUM_PARTITIONS = 3;
+  Random r(1);
+  map<string, uint32_t> expect;
+  string output;
+  for (uint32_t i = 0; i < NUM_RECORDS; i++) {
+    uint32_t id = r.next_uint32() % NUM_KEYS;
+    string key = StringUtil::ToString(id);
+    uint32_t partition = id % NUM_PARTITIONS;
+    Collect(aggregator, partition, key, 1, output);
+    expect[StringUtil::Format("%u:", partition) + key]++;
+  }
+  aggregator.flush(output);
+  ASSERT_GT(aggregator.getFlushCount(), 1);
+  ASSERT_EQ(NUM_RECORDS, aggregator.getRecordCount());
+
+  vector<pair<string, uint32_t> > records;
+  vector<uint32_t> partitions;
+  ReadOutput(output, records, partitions);
+  ASSERT_LT(records.size(), NUM_RECORDS / 4);
+  map<string, uint32_t> actual;
+  for (size_t i = 0; i < records.size(); i++) {
+    actual[StringUtil::Format("%u:", partitions[i]) + records[i].first] += records[i].second;
+  }
+  ASSERT_EQ(expect, actual);
+}
+
+} // namespace NativeTask
@@ -0,0 +1,57 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "lib/NativeObjectFactory.h"
+#include "lib/Histogram.h"
+#include "test_commons.h"
+
+namespace NativeTask {
+
+static uint64_t CounterValue(const string & name) {
+  return NativeObjectFactory::GetCounter("histogram_test", name)->get();
+}
+
+TEST(Histogram, buckets) {
+  const uint64_t bounds[] = {10, 100, 1000};
+  Histogram histogram("histogram_test", "TIME", bounds, 3);
+  const uint64_t values[] = {0, 10, 11, 100, 999, 1000, 1001, 123456};
+  uint64_t sum = 0;
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    histogram.add(values[i]);
+    sum += values[i];
+  }
+  ASSERT_EQ(8, CounterValue("TIME_COUNT"));
+  ASSERT_EQ(sum, CounterValue("TIME_SUM"));
+  ASSERT_EQ(2, CounterValue("TIME_LE_10"));
+  ASSERT_EQ(2, CounterValue("TIME_LE_100"));
+  ASSERT_EQ(2, CounterValue("TIME_LE_1000"));
+  ASSERT_EQ(2, CounterValue("TIME_GT_1000"));
+}
+
+TEST(Histogram, formatBound) {
+  ASSERT_EQ("0", Histogram::FormatBound(0));
+  ASSERT_EQ("1000", Histogram::FormatBound(1000));
+  ASSERT_EQ("1K", Histogram::FormatBound(1024));
+  ASSERT_EQ("1025", Histogram::FormatBound(1025));
+  ASSERT_EQ("3M", Histogram::FormatBound(3 << 20));
+  ASSERT_EQ("4G", Histogram::FormatBound(4ULL << 30));
+  ASSERT_EQ("1536K", Histogram::FormatBound(1536 * 1024));
+}
+
+} // namespace NativeTask
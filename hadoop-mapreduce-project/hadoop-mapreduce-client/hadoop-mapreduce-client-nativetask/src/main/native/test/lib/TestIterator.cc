@@ -110,5 +110,61 @@ TEST(Iterator, keyGroupIterator) {
   TestKeyGroupIterator();
 }
 
+class MockStringIterator : public KVIterator {
+  const std::vector<std::pair<string, string> > & kvs;
+  uint32_t index;
+
+ public:
+  MockStringIterator(const std::vector<std::pair<string, string> > & kvs)
+      : kvs(kvs), index(0) {
+  }
+
+  bool next(Buffer & key, Buffer & outValue) {
+    if (index < kvs.size()) {
+      key.reset(kvs[index].first.data(), kvs[index].first.length());
+      outValue.reset(kvs[index].second.data(), kvs[index].second.length());
+      index++;
+      return true;
+    }
+    return false;
+  }
+};
+
+TEST(Iterator, keyGroupIteratorGroupLength) {
+  std::vector<std::pair<string, string> > kvs;
+  kvs.push_back(std::make_pair("s1:a", "1"));
+  kvs.push_back(std::make_pair("s1:b", "2"));
+  // shorter than the group field, compared whole
+  kvs.push_back(std::make_pair("s1", "3"));
+  kvs.push_back(std::make_pair("s2:a", "4"));
+  kvs.push_back(std::make_pair("s2:c", "5"));
+  kvs.push_back(std::make_pair("s3", "6"));
+
+  MockStringIterator iter(kvs);
+  KeyGroupIteratorImpl groupIterator(&iter, 3);
+  std::vector<string> keys;
+  std::vector<string> values;
+  while (groupIterator.nextKey()) {
+    uint32_t length = 0;
+    const char * key = groupIterator.getKey(length);
+    keys.push_back(string(key, length));
+    string group;
+    const char * value = NULL;
+    while (NULL != (value = groupIterator.nextValue(length))) {
+      group.append(value, length);
+    }
+    values.push_back(group);
+  }
+  ASSERT_EQ(4, keys.size());
+  ASSERT_EQ("s1:a", keys[0]);
+  ASSERT_EQ("12", values[0]);
+  ASSERT_EQ("s1", keys[1]);
+  ASSERT_EQ("3", values[1]);
+  ASSERT_EQ("s2:a", keys[2]);
+  ASSERT_EQ("45", values[2]);
+  ASSERT_EQ("s3", keys[3]);
+  ASSERT_EQ("6", values[3]);
+}
+
 } /* namespace NativeTask */
 
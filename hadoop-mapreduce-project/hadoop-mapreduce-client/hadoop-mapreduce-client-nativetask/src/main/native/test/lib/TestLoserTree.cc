@@ -0,0 +1,156 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "test_commons.h"
+#include "lib/LoserTree.h"
+#include "lib/MinHeap.h"
+
+namespace NativeTask {
+
+/**
+ * a sorted run of ints, positioned at its current value
+ */
+class IntRun {
+public:
+  const uint32_t * current;
+  const uint32_t * end;
+
+  bool next() {
+    return ++current < end;
+  }
+};
+
+typedef IntRun * IntRunPtr;
+
+class IntRunComparator {
+public:
+  uint64_t * count;
+
+  IntRunComparator(uint64_t * compareCount)
+      : count(compareCount) {
+  }
+
+  bool operator()(const IntRunPtr lhs, const IntRunPtr rhs) {
+    (*count)++;
+    return *lhs->current < *rhs->current;
+  }
+};
+
+static void MakeRuns(vector<vector<uint32_t> > & data, uint32_t numRuns, uint32_t maxLength,
+    Random & random) {
+  data.resize(numRuns);
+  for (uint32_t i = 0; i < numRuns; i++) {
+    uint32_t length = random.next_int32(maxLength) + 1;
+    data[i].resize(length);
+    for (uint32_t j = 0; j < length; j++) {
+      data[i][j] = random.next_int32(1000000);
+    }
+    std::sort(data[i].begin(), data[i].end());
+  }
+}
+
+static void StartRuns(vector<vector<uint32_t> > & data, vector<IntRun> & runs,
+    vector<IntRunPtr> & sources) {
+  runs.resize(data.size());
+  sources.clear();
+  for (size_t i = 0; i < data.size(); i++) {
+    runs[i].current = &(data[i][0]);
+    runs[i].end = &(data[i][0]) + data[i].size();
+    sources.push_back(&(runs[i]));
+  }
+}
+
+static uint64_t LoserTreeMerge(vector<vector<uint32_t> > & data, vector<uint32_t> & output) {
+  vector<IntRun> runs;
+  vector<IntRunPtr> sources;
+  StartRuns(data, runs, sources);
+  uint64_t compareCount = 0;
+  LoserTree<IntRunPtr, IntRunComparator> tree((IntRunComparator(&compareCount)));
+  tree.init(&(sources[0]), &(sources[0]) + sources.size());
+  while (!tree.empty()) {
+    IntRunPtr top = tree.top();
+    output.push_back(*top->current);
+    tree.replaceTop(top->next());
+  }
+  return compareCount;
+}
+
+static uint64_t HeapMerge(vector<vector<uint32_t> > & data, vector<uint32_t> & output) {
+  vector<IntRun> runs;
+  vector<IntRunPtr> heap;
+  StartRuns(data, runs, heap);
+  uint64_t compareCount = 0;
+  IntRunComparator comparator(&compareCount);
+  makeHeap(&(heap[0]), &(heap[0]) + heap.size(), comparator);
+  while (heap.size() > 0) {
+    output.push_back(*heap[0]->current);
+    if (heap[0]->next()) {
+      heapify(&(heap[0]), 1, heap.size(), comparator);
+    } else {
+      popHeap(&(heap[0]), &(heap[0]) + heap.size(), comparator);
+      heap.pop_back();
+    }
+  }
+  return compareCount;
+}
+
+TEST(LoserTree, merge) {
+  Random random(0);
+  const uint32_t RUNS[] = {1, 2, 3, 7, 8, 9, 100, 213};
+  for (size_t i = 0; i < sizeof(RUNS) / sizeof(RUNS[0]); i++) {
+    vector<vector<uint32_t> > data;
+    MakeRuns(data, RUNS[i], 200, random);
+    vector<uint32_t> expect;
+    for (size_t j = 0; j < data.size(); j++) {
+      expect.insert(expect.end(), data[j].begin(), data[j].end());
+    }
+    std::sort(expect.begin(), expect.end());
+
+    vector<uint32_t> actual;
+    LoserTreeMerge(data, actual);
+    ASSERT_TRUE(expect == actual);
+  }
+}
+
+TEST(LoserTree, empty) {
+  uint64_t compareCount = 0;
+  LoserTree<IntRunPtr, IntRunComparator> tree((IntRunComparator(&compareCount)));
+  IntRunPtr * none = NULL;
+  tree.init(none, none);
+  ASSERT_TRUE(tree.empty());
+}
+
+TEST(Perf, loserTreeMerge) {
+  Random random(1);
+  vector<vector<uint32_t> > data;
+  MakeRuns(data, 128, 100000, random);
+  Timer timer;
+  vector<uint32_t> heapOutput;
+  uint64_t heapCompares = HeapMerge(data, heapOutput);
+  LOG("%s", timer.getInterval(StringUtil::Format("heap merge, records: %llu, compares: %llu",
+      (unsigned long long)heapOutput.size(), (unsigned long long)heapCompares).c_str()).c_str());
+  timer.reset();
+  vector<uint32_t> treeOutput;
+  uint64_t treeCompares = LoserTreeMerge(data, treeOutput);
+  LOG("%s", timer.getInterval(StringUtil::Format("loser tree merge, records: %llu, compares: %llu",
+      (unsigned long long)treeOutput.size(), (unsigned long long)treeCompares).c_str()).c_str());
+  ASSERT_TRUE(heapOutput == treeOutput);
+}
+
+} // namespace NativeTask
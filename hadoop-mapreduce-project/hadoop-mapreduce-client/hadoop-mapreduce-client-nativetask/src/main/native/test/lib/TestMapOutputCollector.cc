@@ -0,0 +1,853 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "test_commons.h"
+#include "lib/FileSystem.h"
+#include "lib/IFile.h"
+#include "lib/MapOutputCollector.h"
+#include "lib/NativeObjectFactory.h"
+#include "handler/MCollectorOutputHandler.h"
+
+namespace NativeTask {
+
+class MockSpillOutputService : public SpillOutputService {
+private:
+  string _prefix;
+  uint32_t _spillCount;
+
+public:
+  MockSpillOutputService(const string & prefix)
+      : _prefix(prefix), _spillCount(0) {
+  }
+
+  virtual string * getSpillPath() {
+    return new string(StringUtil::Format("%s.spill%u", _prefix.c_str(), _spillCount++));
+  }
+
+  virtual string * getOutputPath() {
+    return new string(_prefix + ".out");
+  }
+
+  virtual string * getOutputIndexPath() {
+    return new string(_prefix + ".out.index");
+  }
+
+  virtual CombineHandler * getJavaCombineHandler() {
+    return NULL;
+  }
+};
+
+static void RunCollector(Config & config, vector<pair<string, string> > & kvs,
+    uint32_t numPartitions, const string & prefix) {
+  MockSpillOutputService service(prefix);
+  MapOutputCollector * collector = new MapOutputCollector(numPartitions, &service);
+  collector->configure(&config);
+  for (size_t i = 0; i < kvs.size(); i++) {
+    pair<string, string> & p = kvs[i];
+    uint32_t partition = (uint32_t)(i * 7 % numPartitions);
+    collector->collect(p.first.c_str(), p.first.length(), p.second.c_str(), p.second.length(),
+        partition);
+  }
+  collector->close();
+  delete collector;
+}
+
+/**
+ * read map output back through its index file, verify each partition
+ * is sorted, and return the records as (partition:key, value)
+ */
+static void ReadOutput(const string & prefix, uint32_t numPartitions, const string & codec,
+    vector<pair<string, string> > & records, KeyValueType valueType = TextType) {
+  string index;
+  ReadFile(index, prefix + ".out.index");
+  EXPECT_EQ(numPartitions * 24 + 8, index.length());
+
+  IFileSegment * segments = new IFileSegment[numPartitions];
+  const uint64_t * entries = (const uint64_t *)index.data();
+  for (uint32_t i = 0; i < numPartitions; i++) {
+    uint64_t start = bswap64(entries[i * 3]);
+    uint64_t rawLength = bswap64(entries[i * 3 + 1]);
+    uint64_t partLength = bswap64(entries[i * 3 + 2]);
+    segments[i].realEndOffset = start + partLength;
+    segments[i].uncompressedEndOffset = (i > 0 ? segments[i - 1].uncompressedEndOffset : 0)
+        + rawLength;
+  }
+  SingleSpillInfo info(segments, numPartitions, prefix + ".out", CHECKSUM_CRC32, TextType,
+      valueType, codec);
+
+  InputStream * fin = FileSystem::getLocal().open(prefix + ".out");
+  IFileReader * reader = new IFileReader(fin, &info);
+  uint32_t partition = 0;
+  while (reader->nextPartition()) {
+    string last;
+    bool first = true;
+    const char * key;
+    uint32_t keyLen;
+    while (NULL != (key = reader->nextKey(keyLen))) {
+      string current(key, keyLen);
+      if (!first) {
+        EXPECT_LE(last, current);
+      }
+      last = current;
+      first = false;
+      uint32_t valueLen;
+      const char * value = reader->value(valueLen);
+      records.push_back(std::make_pair(StringUtil::Format("%u:", partition) + current,
+          string(value, valueLen)));
+    }
+    partition++;
+  }
+  delete reader;
+  delete fin;
+}
+
+static void CleanOutput(const string & prefix) {
+  FileSystem::getLocal().remove(prefix + ".out");
+  FileSystem::getLocal().remove(prefix + ".out.index");
+}
+
+static void SetupConfig(Config & config, const string & codec) {
+  config.set(MAPRED_MAPOUTPUT_KEY_CLASS, "org.apache.hadoop.io.Text");
+  config.set(MAPRED_MAPOUTPUT_VALUE_CLASS, "org.apache.hadoop.io.Text");
+  config.setInt(MAPRED_IO_SORT_MB, 1);
+  if (codec.length() > 0) {
+    config.setBool(MAPRED_COMPRESS_MAP_OUTPUT, true);
+    config.set(MAPRED_MAP_OUTPUT_COMPRESSION_CODEC, codec);
+  }
+}
+
+static void TestParallelSpill(uint64_t length, const string & codec) {
+  const uint32_t numPartitions = 13;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, length, "word");
+
+  Config serial;
+  SetupConfig(serial, codec);
+  RunCollector(serial, kvs, numPartitions, "collector_serial");
+
+  Config parallel;
+  SetupConfig(parallel, codec);
+  parallel.setInt(NATIVE_SORT_SPILL_THREADS, 4);
+  RunCollector(parallel, kvs, numPartitions, "collector_parallel");
+
+  ASSERT_TRUE(FileEqual("collector_serial.out", "collector_parallel.out"));
+  ASSERT_TRUE(FileEqual("collector_serial.out.index", "collector_parallel.out.index"));
+  vector<pair<string, string> > records;
+  ReadOutput("collector_parallel", numPartitions, codec, records);
+  ASSERT_EQ(kvs.size(), records.size());
+
+  CleanOutput("collector_serial");
+  CleanOutput("collector_parallel");
+}
+
+TEST(MapOutputCollector, parallelSpill) {
+  TestParallelSpill(200 * 1024, "");
+}
+
+TEST(MapOutputCollector, parallelSpillCompressed) {
+  TestParallelSpill(200 * 1024, "org.apache.hadoop.io.compress.Lz4Codec");
+}
+
+TEST(MapOutputCollector, parallelSpillAndMerge) {
+  TestParallelSpill(3 * 1024 * 1024, "");
+}
+
+static void TestAsyncSpill(uint64_t length, const string & spillPercent) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, length, "word");
+
+  Config sync;
+  SetupConfig(sync, "");
+  RunCollector(sync, kvs, numPartitions, "collector_sync");
+
+  Config async;
+  SetupConfig(async, "");
+  async.setBool(NATIVE_SPILL_ASYNC, true);
+  async.set(MAPRED_SORT_SPILL_PERCENT, spillPercent);
+  RunCollector(async, kvs, numPartitions, "collector_async");
+
+  // spill boundaries differ, so equal keys may be merged in another order
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_sync", numPartitions, "", expect);
+  ReadOutput("collector_async", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_sync");
+  CleanOutput("collector_async");
+}
+
+TEST(MapOutputCollector, asyncSpill) {
+  TestAsyncSpill(100 * 1024, "0.8");
+  TestAsyncSpill(4 * 1024 * 1024, "0.5");
+  TestAsyncSpill(4 * 1024 * 1024, "0.8");
+}
+
+TEST(MapOutputCollector, memoryPolicy) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config malloced;
+  SetupConfig(malloced, "");
+  RunCollector(malloced, kvs, numPartitions, "collector_malloc");
+
+  const char * policies[] = {"HUGEPAGE", "HUGETLB"};
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    Config mapped;
+    SetupConfig(mapped, "");
+    mapped.set(NATIVE_SORT_MEMORY_POLICY, policies[i]);
+    mapped.setBool(NATIVE_SORT_MEMORY_NUMA_LOCAL, true);
+    mapped.setBool(NATIVE_SORT_MEMORY_PREFAULT, true);
+    RunCollector(mapped, kvs, numPartitions, "collector_mapped");
+    ASSERT_TRUE(FileEqual("collector_malloc.out", "collector_mapped.out"));
+    ASSERT_TRUE(FileEqual("collector_malloc.out.index", "collector_mapped.out.index"));
+  }
+
+  CleanOutput("collector_malloc");
+  CleanOutput("collector_mapped");
+}
+
+static void TestNativeCombiner(uint32_t hashMB, bool asyncSpill = false) {
+  const uint32_t numPartitions = 5;
+  vector<pair<string, string> > words;
+  GenerateLength(words, 2 * 1024 * 1024, "word");
+  vector<pair<string, string> > kvs;
+  map<string, int64_t> expect;
+  for (size_t i = 0; i < words.size(); i++) {
+    int64_t count = (int64_t)(i % 3) + 1;
+    uint64_t value = bswap64((uint64_t)count);
+    kvs.push_back(std::make_pair(words[i].first, string((const char *)&value, 8)));
+    uint32_t partition = (uint32_t)(i * 7 % numPartitions);
+    expect[StringUtil::Format("%u:", partition) + words[i].first] += count;
+  }
+
+  Config config;
+  SetupConfig(config, "");
+  config.set(MAPRED_MAPOUTPUT_VALUE_CLASS, "org.apache.hadoop.io.LongWritable");
+  config.set(NATIVE_COMBINER, "NativeTask.LongSumCombiner");
+  config.setInt(NATIVE_COMBINE_HASH_MB, hashMB);
+  // native combiners keep async spill
+  config.setBool(NATIVE_SPILL_ASYNC, asyncSpill);
+  RunCollector(config, kvs, numPartitions, "collector_combine");
+
+  vector<pair<string, string> > records;
+  ReadOutput("collector_combine", numPartitions, "", records, LongType);
+  map<string, int64_t> actual;
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(8, records[i].second.length());
+    // the final merge combines, so each key is written once
+    ASSERT_EQ(0, actual.count(records[i].first));
+    actual[records[i].first] = (int64_t)bswap64(*(const uint64_t *)records[i].second.data());
+  }
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_combine");
+}
+
+TEST(MapOutputCollector, nativeCombiner) {
+  TestNativeCombiner(0);
+}
+
+TEST(MapOutputCollector, hashAggregation) {
+  TestNativeCombiner(1);
+}
+
+TEST(MapOutputCollector, nativeCombinerAsyncSpill) {
+  TestNativeCombiner(0, true);
+  TestNativeCombiner(1, true);
+}
+
+TEST(MapOutputCollector, wholePartitionSort) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config blockSort;
+  SetupConfig(blockSort, "");
+  RunCollector(blockSort, kvs, numPartitions, "collector_block");
+
+  Config wholeSort;
+  SetupConfig(wholeSort, "");
+  wholeSort.setBool(NATIVE_SORT_WHOLE_PARTITION, true);
+  RunCollector(wholeSort, kvs, numPartitions, "collector_whole");
+
+  // neither sort is stable, so equal keys may come in another order
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_block", numPartitions, "", expect);
+  ReadOutput("collector_whole", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_block");
+  CleanOutput("collector_whole");
+}
+
+static void TestGroupBy(const string & sortType, bool keyPrefix) {
+  const uint32_t numPartitions = 3;
+  const uint32_t groupFieldLength = 6;
+  vector<pair<string, string> > words;
+  GenerateLength(words, 2 * 1024 * 1024, "word");
+
+  // secondary sort keys: fixed length session id, then the event word
+  Random r(97);
+  vector<pair<string, string> > kvs;
+  map<string, int64_t> expect;
+  map<string, string> firstKeys;
+  for (size_t i = 0; i < words.size(); i++) {
+    string group = StringUtil::Format("s%05u", (uint32_t)r.next_int32(500));
+    string key = group + words[i].first;
+    int64_t count = (int64_t)(i % 3) + 1;
+    uint64_t value = bswap64((uint64_t)count);
+    kvs.push_back(std::make_pair(key, string((const char *)&value, 8)));
+    uint32_t partition = (uint32_t)(i * 7 % numPartitions);
+    string partitionGroup = StringUtil::Format("%u:", partition) + group;
+    expect[partitionGroup] += count;
+    if (firstKeys.count(partitionGroup) == 0 || key < firstKeys[partitionGroup]) {
+      firstKeys[partitionGroup] = key;
+    }
+  }
+
+  Config config;
+  SetupConfig(config, "");
+  config.set(MAPRED_MAPOUTPUT_VALUE_CLASS, "org.apache.hadoop.io.LongWritable");
+  config.set(NATIVE_COMBINER, "NativeTask.LongSumCombiner");
+  config.setInt(NATIVE_SORT_GROUP_FIELD_LENGTH, groupFieldLength);
+  config.set(NATIVE_SORT_TYPE, sortType);
+  config.setBool(NATIVE_SORT_KEY_PREFIX, keyPrefix);
+  RunCollector(config, kvs, numPartitions, "collector_groupby");
+
+  // one record per group, with the smallest key of the group and the sum
+  vector<pair<string, string> > records;
+  ReadOutput("collector_groupby", numPartitions, "", records, LongType);
+  ASSERT_EQ(expect.size(), records.size());
+  map<string, int64_t> actual;
+  for (size_t i = 0; i < records.size(); i++) {
+    const string & record = records[i].first;
+    size_t colon = record.find(':');
+    string partitionGroup = record.substr(0, colon + 1 + groupFieldLength);
+    ASSERT_EQ(0, actual.count(partitionGroup));
+    ASSERT_EQ(firstKeys[partitionGroup], record.substr(colon + 1));
+    ASSERT_EQ(8, records[i].second.length());
+    actual[partitionGroup] = (int64_t)bswap64(*(const uint64_t *)records[i].second.data());
+  }
+  ASSERT_TRUE(expect == actual);
+  CleanOutput("collector_groupby");
+}
+
+TEST(MapOutputCollector, groupBy) {
+  TestGroupBy("DUALPIVOTSORT", false);
+  TestGroupBy("DUALPIVOTSORT", true);
+  TestGroupBy("RADIXSORT", false);
+
+  // the group field needs keys compared by their bytes
+  const uint32_t numPartitions = 3;
+  Config unsupported;
+  SetupConfig(unsupported, "");
+  unsupported.set(MAPRED_MAPOUTPUT_KEY_CLASS, "org.apache.hadoop.io.LongWritable");
+  unsupported.setInt(NATIVE_SORT_GROUP_FIELD_LENGTH, 6);
+  MockSpillOutputService service("collector_groupby");
+  MapOutputCollector collector(numPartitions, &service);
+  ASSERT_THROW(collector.configure(&unsupported), UnsupportException);
+}
+
+TEST(MapOutputCollector, mergeType) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config heap;
+  SetupConfig(heap, "");
+  heap.set(NATIVE_MERGE_TYPE, "HEAP");
+  RunCollector(heap, kvs, numPartitions, "collector_heap");
+
+  Config loserTree;
+  SetupConfig(loserTree, "");
+  loserTree.set(NATIVE_MERGE_TYPE, "LOSERTREE");
+  RunCollector(loserTree, kvs, numPartitions, "collector_losertree");
+
+  // equal keys from different blocks or spills may come in another order
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_heap", numPartitions, "", expect);
+  ReadOutput("collector_losertree", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_heap");
+  CleanOutput("collector_losertree");
+}
+
+static void TestMergeFactor(uint32_t factor, uint32_t threads, uint32_t sortMB) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 8 * 1024 * 1024, "word");
+
+  Config onePass;
+  SetupConfig(onePass, "");
+  onePass.setInt(MAPRED_IO_SORT_MB, sortMB);
+  onePass.setInt(MAPRED_IO_SORT_FACTOR, 1000);
+  RunCollector(onePass, kvs, numPartitions, "collector_onepass");
+
+  Config multiPass;
+  SetupConfig(multiPass, "");
+  multiPass.setInt(MAPRED_IO_SORT_MB, sortMB);
+  multiPass.setInt(MAPRED_IO_SORT_FACTOR, factor);
+  multiPass.setInt(NATIVE_MERGE_THREADS, threads);
+  RunCollector(multiPass, kvs, numPartitions, "collector_multipass");
+
+  // equal keys from different spills may come in another order
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_onepass", numPartitions, "", expect);
+  ReadOutput("collector_multipass", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  // intermediate spills are removed as soon as they are merged
+  for (uint32_t i = 0; i < 100; i++) {
+    ASSERT_FALSE(FileSystem::getLocal().exists(
+        StringUtil::Format("collector_multipass.spill%u", i)));
+  }
+
+  CleanOutput("collector_onepass");
+  CleanOutput("collector_multipass");
+}
+
+TEST(MapOutputCollector, multiPassMerge) {
+  TestMergeFactor(2, 1, 1);
+  TestMergeFactor(3, 1, 1);
+  // room for merges in parallel
+  TestMergeFactor(2, 4, 2);
+}
+
+static void TestParallelFinalMerge(uint32_t numPartitions, uint32_t threads,
+    const string & codec) {
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config serial;
+  SetupConfig(serial, codec);
+  RunCollector(serial, kvs, numPartitions, "collector_serial");
+
+  Config parallel;
+  SetupConfig(parallel, codec);
+  parallel.setInt(NATIVE_MERGE_THREADS, threads);
+  RunCollector(parallel, kvs, numPartitions, "collector_parallel");
+
+  // the same merge per partition, so the output is identical
+  ASSERT_TRUE(FileEqual("collector_serial.out", "collector_parallel.out"));
+  ASSERT_TRUE(FileEqual("collector_serial.out.index", "collector_parallel.out.index"));
+  vector<pair<string, string> > records;
+  ReadOutput("collector_parallel", numPartitions, codec, records);
+  ASSERT_EQ(kvs.size(), records.size());
+
+  CleanOutput("collector_serial");
+  CleanOutput("collector_parallel");
+}
+
+TEST(MapOutputCollector, parallelFinalMerge) {
+  TestParallelFinalMerge(13, 4, "");
+  TestParallelFinalMerge(13, 4, "org.apache.hadoop.io.compress.Lz4Codec");
+  TestParallelFinalMerge(3, 8, "");
+}
+
+TEST(MapOutputCollector, mergeReadAhead) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config direct;
+  SetupConfig(direct, "org.apache.hadoop.io.compress.Lz4Codec");
+  RunCollector(direct, kvs, numPartitions, "collector_direct");
+
+  Config readAhead;
+  SetupConfig(readAhead, "org.apache.hadoop.io.compress.Lz4Codec");
+  readAhead.setInt(NATIVE_MERGE_READ_AHEAD, 64 * 1024);
+  readAhead.setInt(NATIVE_MERGE_THREADS, 3);
+  readAhead.setInt(MAPRED_IO_SORT_FACTOR, 3);
+  RunCollector(readAhead, kvs, numPartitions, "collector_readahead");
+
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_direct", numPartitions, "org.apache.hadoop.io.compress.Lz4Codec",
+      expect);
+  ReadOutput("collector_readahead", numPartitions, "org.apache.hadoop.io.compress.Lz4Codec",
+      actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_direct");
+  CleanOutput("collector_readahead");
+}
+
+TEST(MapOutputCollector, mergeMmap) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config direct;
+  SetupConfig(direct, "");
+  RunCollector(direct, kvs, numPartitions, "collector_direct");
+
+  Config mapped;
+  SetupConfig(mapped, "");
+  mapped.setBool(NATIVE_MERGE_MMAP, true);
+  mapped.setInt(NATIVE_MERGE_THREADS, 3);
+  mapped.setInt(MAPRED_IO_SORT_FACTOR, 3);
+  RunCollector(mapped, kvs, numPartitions, "collector_mmap");
+
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_direct", numPartitions, "", expect);
+  ReadOutput("collector_mmap", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_direct");
+  CleanOutput("collector_mmap");
+}
+
+TEST(MapOutputCollector, spillDirectIO) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config config;
+  SetupConfig(config, "");
+  RunCollector(config, kvs, numPartitions, "collector_buffered");
+  config.setBool(NATIVE_SPILL_DIRECT_IO, true);
+  RunCollector(config, kvs, numPartitions, "collector_odirect");
+
+  ASSERT_TRUE(FileEqual("collector_buffered.out", "collector_odirect.out"));
+  ASSERT_TRUE(FileEqual("collector_buffered.out.index", "collector_odirect.out.index"));
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_odirect", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+
+  CleanOutput("collector_buffered");
+  CleanOutput("collector_odirect");
+}
+
+static uint64_t MetricsCounter(const string & name) {
+  return NativeObjectFactory::GetCounter(CollectorMetrics::GROUP, name)->get();
+}
+
+TEST(MapOutputCollector, metrics) {
+  const uint32_t numPartitions = 7;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  const char * names[] = {"SPILL_MS_COUNT", "SPILL_BYTES_COUNT", "SPILL_BYTES_SUM",
+      "PARTITION_SORT_US_COUNT", "ALLOCATE_BLOCKED_MS_COUNT", "MERGE_FAN_IN_COUNT",
+      "MERGE_FAN_IN_SUM", "COMPRESS_RATIO_PCT_LZ4_COUNT", "COMPRESS_MS_LZ4_COUNT"};
+  const size_t numNames = sizeof(names) / sizeof(names[0]);
+  vector<uint64_t> before;
+  for (size_t i = 0; i < numNames; i++) {
+    before.push_back(MetricsCounter(names[i]));
+  }
+
+  Config config;
+  SetupConfig(config, "org.apache.hadoop.io.compress.Lz4Codec");
+  config.setBool(NATIVE_COLLECTOR_METRICS, true);
+  config.setInt(MAPRED_IO_SORT_FACTOR, 3);
+  RunCollector(config, kvs, numPartitions, "collector_metrics");
+  CleanOutput("collector_metrics");
+
+  map<string, uint64_t> delta;
+  for (size_t i = 0; i < numNames; i++) {
+    delta[names[i]] = MetricsCounter(names[i]) - before[i];
+  }
+  const uint64_t spills = delta["SPILL_MS_COUNT"];
+  ASSERT_GT(spills, 2);
+  ASSERT_EQ(spills, delta["SPILL_BYTES_COUNT"]);
+  ASSERT_GT(delta["SPILL_BYTES_SUM"], 0);
+  // every spill but the final merge was forced by a full buffer
+  ASSERT_EQ(spills, delta["ALLOCATE_BLOCKED_MS_COUNT"]);
+  // RunCollector fills partition 0 only, sorted by every spill and once
+  // more for the final merge
+  ASSERT_EQ(spills + 1, delta["PARTITION_SORT_US_COUNT"]);
+  // every spill and every intermediate merge output is merged once, and
+  // the in-memory records are one more input of the final merge
+  const uint64_t merges = delta["MERGE_FAN_IN_COUNT"];
+  ASSERT_GT(merges, 1);
+  ASSERT_EQ(spills + merges, delta["MERGE_FAN_IN_SUM"]);
+  ASSERT_EQ(spills + merges, delta["COMPRESS_RATIO_PCT_LZ4_COUNT"]);
+  ASSERT_EQ(spills + merges, delta["COMPRESS_MS_LZ4_COUNT"]);
+}
+
+/**
+ * collect kvs like RunCollector does, serialized into shared buffers of
+ * bufferSize bytes instead of copied
+ */
+static void RunSharedCollector(Config & config, vector<pair<string, string> > & kvs,
+    uint32_t numPartitions, const string & prefix, uint32_t bufferSize) {
+  MockSpillOutputService service(prefix);
+  MapOutputCollector * collector = new MapOutputCollector(numPartitions, &service);
+  collector->configure(&config);
+  char * buffer = NULL;
+  uint32_t allocated = 0;
+  uint32_t length = 0;
+  for (size_t i = 0; i < kvs.size(); i++) {
+    pair<string, string> & p = kvs[i];
+    uint32_t recordLength = KVBufferWithParititionId::minLength() + p.first.length()
+        + p.second.length();
+    if (NULL == buffer || allocated - length < recordLength) {
+      if (NULL != buffer) {
+        collector->commitSharedBuffer(buffer, allocated, length);
+      }
+      buffer = collector->allocateSharedBuffer(recordLength, bufferSize, allocated);
+      ASSERT_TRUE(NULL != buffer);
+      ASSERT_GE(allocated, recordLength);
+      length = 0;
+    }
+    KVBufferWithParititionId * record = (KVBufferWithParititionId *)(buffer + length);
+    record->partitionId = (uint32_t)(i * 7 % numPartitions);
+    record->buffer.fill(p.first.c_str(), p.first.length(), p.second.c_str(), p.second.length());
+    length += recordLength;
+  }
+  if (NULL != buffer) {
+    collector->commitSharedBuffer(buffer, allocated, length);
+  }
+  collector->close();
+  delete collector;
+}
+
+static void TestSharedBuffer(bool asyncSpill, uint32_t bufferSize) {
+  const uint32_t numPartitions = 13;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+
+  Config copied;
+  SetupConfig(copied, "");
+  RunCollector(copied, kvs, numPartitions, "collector_copied");
+
+  Config shared;
+  SetupConfig(shared, "");
+  shared.setBool(NATIVE_SPILL_ASYNC, asyncSpill);
+  RunSharedCollector(shared, kvs, numPartitions, "collector_shared", bufferSize);
+
+  // spill boundaries differ, so equal keys may be merged in another order
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput("collector_copied", numPartitions, "", expect);
+  ReadOutput("collector_shared", numPartitions, "", actual);
+  ASSERT_EQ(kvs.size(), actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  ASSERT_TRUE(expect == actual);
+
+  CleanOutput("collector_copied");
+  CleanOutput("collector_shared");
+}
+
+TEST(MapOutputCollector, sharedBuffer) {
+  TestSharedBuffer(false, 64 * 1024);
+  // as large as the whole pool, every buffer ends with a spill
+  TestSharedBuffer(false, 1024 * 1024);
+  TestSharedBuffer(true, 64 * 1024);
+
+  // hash aggregation needs the records copied
+  MockSpillOutputService service("collector_aggregated");
+  Config config;
+  SetupConfig(config, "");
+  config.set(MAPRED_MAPOUTPUT_VALUE_CLASS, "org.apache.hadoop.io.LongWritable");
+  config.set(NATIVE_COMBINER, "NativeTask.LongSumCombiner");
+  config.setInt(NATIVE_COMBINE_HASH_MB, 1);
+  MapOutputCollector collector(1, &service);
+  collector.configure(&config);
+  uint32_t allocated = 0;
+  ASSERT_TRUE(NULL == collector.allocateSharedBuffer(16, 64 * 1024, allocated));
+}
+
+/**
+ * MCollectorOutputHandler answering the path commands itself instead of
+ * calling java
+ */
+class LocalCollectorOutputHandler : public MCollectorOutputHandler {
+private:
+  MockSpillOutputService _service;
+
+public:
+  LocalCollectorOutputHandler(const string & prefix)
+      : _service(prefix) {
+  }
+
+protected:
+  virtual ResultBuffer * call(const Command & cmd, ParameterBuffer * param) {
+    string * path = NULL;
+    if (cmd.id() == GET_OUTPUT_PATH.id()) {
+      path = _service.getOutputPath();
+    } else if (cmd.id() == GET_OUTPUT_INDEX_PATH.id()) {
+      path = _service.getOutputIndexPath();
+    } else if (cmd.id() == GET_SPILL_PATH.id()) {
+      path = _service.getSpillPath();
+    } else {
+      return NULL;
+    }
+    ResultBuffer * result = new ResultBuffer();
+    result->writeString(path);
+    delete path;
+    return result;
+  }
+};
+
+static Config * CreateHandlerConfig(uint32_t numPartitions, bool nativeEndian) {
+  Config * config = new Config();
+  SetupConfig(*config, "");
+  config->setInt(MAPRED_NUM_REDUCES, numPartitions);
+  config->setBool(NATIVE_COLLECTOR_NATIVE_ENDIAN, nativeEndian);
+  return config;
+}
+
+/**
+ * feed kvs through MCollectorOutputHandler::handleInput the way the java
+ * collector does: batches of whole records, except a record larger than
+ * the input buffer, which spans batches
+ */
+static void RunHandler(vector<pair<string, string> > & kvs, uint32_t numPartitions,
+    const string & prefix, bool nativeEndian, uint32_t inputSize) {
+  char * input = new char[inputSize];
+  LocalCollectorOutputHandler * handler = new LocalCollectorOutputHandler(prefix);
+  handler->onSetup(CreateHandlerConfig(numPartitions, nativeEndian), input, inputSize, NULL, 0);
+
+  uint32_t used = 0;
+  for (size_t i = 0; i < kvs.size(); i++) {
+    pair<string, string> & p = kvs[i];
+    uint32_t header[3] = {(uint32_t)(i * 7 % numPartitions), (uint32_t)p.first.length(),
+        (uint32_t)p.second.length()};
+    if (!nativeEndian) {
+      for (int j = 0; j < 3; j++) {
+        header[j] = bswap(header[j]);
+      }
+    }
+    string record((const char *)header, sizeof(header));
+    record.append(p.first).append(p.second);
+    if (used > 0 && inputSize - used < record.length()) {
+      handler->onInputData(used);
+      used = 0;
+    }
+    for (size_t pos = 0; pos < record.length();) {
+      uint32_t length = std::min((size_t)(inputSize - used), record.length() - pos);
+      memcpy(input + used, record.data() + pos, length);
+      pos += length;
+      used += length;
+      if (used == inputSize) {
+        handler->onInputData(used);
+        used = 0;
+      }
+    }
+  }
+  if (used > 0) {
+    handler->onInputData(used);
+  }
+  handler->onFinish();
+  delete handler;
+  delete[] input;
+}
+
+/**
+ * the same through shared buffers of MCollectorOutputHandler
+ */
+static void RunSharedHandler(vector<pair<string, string> > & kvs, uint32_t numPartitions,
+    const string & prefix, uint32_t bufferKB) {
+  LocalCollectorOutputHandler * handler = new LocalCollectorOutputHandler(prefix);
+  Config * config = CreateHandlerConfig(numPartitions, true);
+  config->setInt(NATIVE_PROCESSOR_BUFFER_KB, bufferKB);
+  handler->onSetup(config, NULL, 0, NULL, 0);
+
+  uint32_t capacity = 0;
+  char * buffer = handler->onSwapSharedBuffer(0, 1, capacity);
+  ASSERT_TRUE(NULL != buffer);
+  ASSERT_EQ(bufferKB * 1024, capacity);
+  uint32_t used = 0;
+  for (size_t i = 0; i < kvs.size(); i++) {
+    pair<string, string> & p = kvs[i];
+    uint32_t recordLength = KVBufferWithParititionId::minLength() + p.first.length()
+        + p.second.length();
+    if (capacity - used < recordLength) {
+      buffer = handler->onSwapSharedBuffer(used, recordLength, capacity);
+      ASSERT_TRUE(NULL != buffer);
+      ASSERT_GE(capacity, recordLength);
+      used = 0;
+    }
+    KVBufferWithParititionId * record = (KVBufferWithParititionId *)(buffer + used);
+    record->partitionId = (uint32_t)(i * 7 % numPartitions);
+    record->buffer.fill(p.first.c_str(), p.first.length(), p.second.c_str(), p.second.length());
+    used += recordLength;
+  }
+  ASSERT_TRUE(NULL == handler->onSwapSharedBuffer(used, 0, capacity));
+  handler->onFinish();
+  delete handler;
+}
+
+static void ExpectHandlerOutput(const string & expectPrefix, const string & prefix,
+    uint32_t numPartitions, size_t numRecords) {
+  vector<pair<string, string> > expect;
+  vector<pair<string, string> > actual;
+  ReadOutput(expectPrefix, numPartitions, "", expect);
+  ReadOutput(prefix, numPartitions, "", actual);
+  ASSERT_EQ(numRecords, actual.size());
+  std::sort(expect.begin(), expect.end());
+  std::sort(actual.begin(), actual.end());
+  for (size_t i = 0; i < expect.size(); i++) {
+    ASSERT_EQ(expect[i].first.length(), actual[i].first.length());
+    ASSERT_EQ(expect[i].second.length(), actual[i].second.length());
+    ASSERT_EQ(expect[i], actual[i]);
+  }
+  CleanOutput(prefix);
+}
+
+TEST(MCollectorOutputHandler, handleInput) {
+  const uint32_t numPartitions = 13;
+  vector<pair<string, string> > kvs;
+  GenerateLength(kvs, 4 * 1024 * 1024, "word");
+  Config config;
+  SetupConfig(config, "");
+  RunCollector(config, kvs, numPartitions, "handler_expect");
+
+  RunHandler(kvs, numPartitions, "handler_bigendian", false, 64 * 1024);
+  ExpectHandlerOutput("handler_expect", "handler_bigendian", numPartitions, kvs.size());
+  RunHandler(kvs, numPartitions, "handler_nativeendian", true, 64 * 1024);
+  ExpectHandlerOutput("handler_expect", "handler_nativeendian", numPartitions, kvs.size());
+  // most records span batches, headers included
+  RunHandler(kvs, numPartitions, "handler_nativeendian", true, 16);
+  ExpectHandlerOutput("handler_expect", "handler_nativeendian", numPartitions, kvs.size());
+  RunSharedHandler(kvs, numPartitions, "handler_shared", 64);
+  ExpectHandlerOutput("handler_expect", "handler_shared", numPartitions, kvs.size());
+
+  CleanOutput("handler_expect");
+}
+
+} // namespace NativeTask
@@ -106,4 +106,89 @@ TEST(MemoryBlock, sort) {
   delete [] bytes;
 }
 
+/**
+ * fill block with random keys of keyType, with many duplicates and
+ * shared byte prefixes
+ */
+static void FillRandomKeys(MemoryBlock & block, KeyValueType keyType, Random & random,
+    uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    string key;
+    switch (keyType) {
+    case IntType: {
+      uint32_t v = bswap((uint32_t)(random.next_int32(2000) - 1000));
+      key.assign((const char *)&v, 4);
+    }
+      break;
+    case LongType: {
+      uint64_t v = bswap64((uint64_t)((int64_t)random.next_int32(2000) - 1000) * 3000000000LL);
+      key.assign((const char *)&v, 8);
+    }
+      break;
+    case FloatType: {
+      float f = ((float)random.next_int32(2000) - 1000) / 7;
+      uint32_t v;
+      memcpy(&v, &f, 4);
+      v = bswap(v);
+      key.assign((const char *)&v, 4);
+    }
+      break;
+    case DoubleType: {
+      double d = ((double)random.next_int32(2000) - 1000) * 1e10 / 7;
+      uint64_t v;
+      memcpy(&v, &d, 8);
+      v = bswap64(v);
+      key.assign((const char *)&v, 8);
+    }
+      break;
+    default:
+      key = random.nextBytes(random.next_int32(20), string("ab\0", 3));
+    }
+    KVBuffer * kv = block.allocateKVBuffer(KVBuffer::headerLength() + key.length() + 1);
+    kv->fill(key.data(), key.length(), "v", 1);
+  }
+}
+
+static void TestKeyPrefixSort(KeyValueType keyType, SortAlgorithm sortType) {
+  const uint32_t COUNT = 10000;
+  const uint32_t BUFFER_LENGTH = COUNT * 40;
+  char * bytes = new char[BUFFER_LENGTH];
+  MemoryBlock block(bytes, BUFFER_LENGTH);
+  Random random(keyType);
+  FillRandomKeys(block, keyType, random, COUNT);
+
+  ComparatorPtr comparator = NativeTask::get_comparator(keyType, NULL);
+  block.sort(sortType, comparator, keyType);
+
+  ASSERT_EQ(COUNT, block.getKVCount());
+  for (uint32_t i = 1; i < COUNT; i++) {
+    KVBuffer * prev = block.getKVBuffer(i - 1);
+    KVBuffer * current = block.getKVBuffer(i);
+    ASSERT_LE(comparator(prev->getKey(), prev->keyLength, current->getKey(),
+        current->keyLength), 0);
+  }
+  delete [] bytes;
+}
+
+TEST(MemoryBlock, keyPrefixSort) {
+  TestKeyPrefixSort(BytesType, CPPSORT);
+  TestKeyPrefixSort(BytesType, DUALPIVOTSORT);
+  TestKeyPrefixSort(TextType, DUALPIVOTSORT);
+  TestKeyPrefixSort(IntType, CPPSORT);
+  TestKeyPrefixSort(IntType, DUALPIVOTSORT);
+  TestKeyPrefixSort(LongType, CPPSORT);
+  TestKeyPrefixSort(LongType, DUALPIVOTSORT);
+  TestKeyPrefixSort(FloatType, DUALPIVOTSORT);
+  TestKeyPrefixSort(DoubleType, DUALPIVOTSORT);
+}
+
+TEST(MemoryBlock, radixSort) {
+  TestKeyPrefixSort(BytesType, RADIXSORT);
+  TestKeyPrefixSort(TextType, RADIXSORT);
+  TestKeyPrefixSort(IntType, RADIXSORT);
+  TestKeyPrefixSort(LongType, RADIXSORT);
+  TestKeyPrefixSort(FloatType, RADIXSORT);
+  TestKeyPrefixSort(DoubleType, RADIXSORT);
+}
+
 } // namespace NativeTask
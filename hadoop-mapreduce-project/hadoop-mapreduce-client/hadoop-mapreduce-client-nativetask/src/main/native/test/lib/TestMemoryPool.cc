@@ -45,4 +45,114 @@ TEST(MemoryPool, general) {
 
   delete pool;
 }
+
+TEST(MemoryPool, release) {
+  MemoryPool * pool = new MemoryPool();
+  const uint32_t POOL_SIZE = 1024;
+  pool->init(POOL_SIZE);
+
+  uint32_t allocated = 0;
+  char * first = pool->allocate(400, 400, allocated);
+  ASSERT_NE((void *)NULL, first);
+  char * second = pool->allocate(400, 400, allocated);
+  ASSERT_EQ(first + 400, second);
+  uint32_t spilling = pool->getUsed();
+  ASSERT_EQ(800, spilling);
+
+  // still allocated while the first 800 bytes are in use
+  char * third = pool->allocate(200, 400, allocated);
+  ASSERT_EQ(first + 800, third);
+  ASSERT_EQ(200, allocated);
+  ASSERT_EQ(NULL, pool->allocate(100, 100, allocated));
+
+  // wraps to the start of the pool once released
+  pool->release(spilling);
+  ASSERT_EQ(200, pool->getUsed());
+  char * fourth = pool->allocate(500, 1000, allocated);
+  ASSERT_EQ(first, fourth);
+  ASSERT_EQ(500, allocated);
+  ASSERT_EQ(1024 - 300, pool->getUsed());
+  ASSERT_EQ(NULL, pool->allocate(400, 400, allocated));
+  char * fifth = pool->allocate(300, 300, allocated);
+  ASSERT_EQ(first + 500, fifth);
+  ASSERT_EQ(POOL_SIZE, pool->getUsed());
+
+  pool->release(pool->getUsed());
+  ASSERT_EQ(0, pool->getUsed());
+  ASSERT_EQ(first, pool->allocate(1024, 1024, allocated));
+
+  delete pool;
+}
+
+TEST(MemoryPool, above4GB) {
+  if (sizeof(size_t) < 8) {
+    return;
+  }
+  MemoryPool * pool = new MemoryPool();
+  const uint64_t POOL_SIZE = 5ULL * 1024 * 1024 * 1024;
+  const uint32_t BLOCK_SIZE = 1024 * 1024 * 1024;
+  try {
+    pool->init(POOL_SIZE);
+  } catch (OutOfMemoryException & e) {
+    // pages are not touched, but the address space may still be limited
+    LOG("skip MemoryPool.above4GB: %s", e.what());
+    delete pool;
+    return;
+  }
+  ASSERT_EQ(POOL_SIZE, pool->getCapacity());
+
+  uint32_t allocated = 0;
+  char * first = pool->allocate(BLOCK_SIZE, BLOCK_SIZE, allocated);
+  ASSERT_NE((void *)NULL, first);
+  for (uint32_t i = 1; i < 5; i++) {
+    char * buff = pool->allocate(BLOCK_SIZE, BLOCK_SIZE, allocated);
+    ASSERT_EQ(first + (uint64_t)i * BLOCK_SIZE, buff);
+  }
+  ASSERT_EQ(POOL_SIZE, pool->getUsed());
+  ASSERT_EQ(NULL, pool->allocate(1, 1, allocated));
+
+  pool->release(2ULL * BLOCK_SIZE);
+  ASSERT_EQ(3ULL * BLOCK_SIZE, pool->getUsed());
+  ASSERT_EQ(first, pool->allocate(BLOCK_SIZE, BLOCK_SIZE, allocated));
+
+  delete pool;
+}
+
+TEST(MemoryPool, policy) {
+  const uint64_t POOL_SIZE = 16 * 1024 * 1024 + 100;
+  const MemoryPolicy policies[] = {MALLOC_MEMORY, HUGEPAGE_MEMORY, HUGETLB_MEMORY};
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    MemoryPool * pool = new MemoryPool();
+    pool->setPolicy(policies[i], true, true);
+    pool->init(POOL_SIZE);
+    ASSERT_EQ(POOL_SIZE, pool->getCapacity());
+
+    // records written while the pool is prefaulted must survive it
+    uint32_t allocated = 0;
+    char * buff = pool->allocate(POOL_SIZE, POOL_SIZE, allocated);
+    ASSERT_NE((void *)NULL, buff);
+    for (uint64_t j = 0; j < POOL_SIZE; j += 1000) {
+      buff[j] = (char)(j / 1000);
+    }
+    for (uint64_t j = 0; j < POOL_SIZE; j += 1000) {
+      ASSERT_EQ((char)(j / 1000), buff[j]);
+    }
+    delete pool;
+
+    pool = new MemoryPool();
+    pool->setPolicy(policies[i], false, true);
+    pool->init(POOL_SIZE);
+    buff = pool->allocate(POOL_SIZE, POOL_SIZE, allocated);
+    for (uint64_t j = 0; j < POOL_SIZE; j += 1000) {
+      buff[j] = (char)(j / 1000);
+    }
+    // re-init with a smaller capacity keeps the memory and its content
+    pool->init(POOL_SIZE / 2);
+    ASSERT_EQ(buff, pool->allocate(100, 100, allocated));
+    for (uint64_t j = 0; j < POOL_SIZE; j += 1000) {
+      ASSERT_EQ((char)(j / 1000), buff[j]);
+    }
+    delete pool;
+  }
+}
 } // namespace NativeTask
@@ -0,0 +1,120 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lib/commons.h"
+#include "test_commons.h"
+#include "lib/NativeObjectFactory.h"
+#include "lib/NativeCombiners.h"
+
+namespace NativeTask {
+
+class VectorKVIterator : public KVIterator {
+private:
+  vector<pair<string, string> > & _kvs;
+  size_t _index;
+public:
+  VectorKVIterator(vector<pair<string, string> > & kvs)
+      : _kvs(kvs), _index(0) {
+  }
+
+  virtual bool next(Buffer & key, Buffer & value) {
+    if (_index >= _kvs.size()) {
+      return false;
+    }
+    key.reset(_kvs[_index].first.data(), _kvs[_index].first.length());
+    value.reset(_kvs[_index].second.data(), _kvs[_index].second.length());
+    _index++;
+    return true;
+  }
+};
+
+class VectorCollector : public Collector {
+public:
+  vector<pair<string, string> > kvs;
+
+  virtual void collect(const void * key, uint32_t keyLen, const void * value,
+      uint32_t valueLen) {
+    kvs.push_back(std::make_pair(string((const char *)key, keyLen),
+        string((const char *)value, valueLen)));
+  }
+};
+
+template<typename _Value>
+static void Combine(const string & combinerClass, const char ** keys, const _Value * values,
+    size_t count, vector<pair<string, _Value> > & result) {
+  vector<pair<string, string> > input;
+  for (size_t i = 0; i < count; i++) {
+    char value[sizeof(_Value)];
+    NumberValue<_Value>::write(values[i], value);
+    input.push_back(std::make_pair(string(keys[i]), string(value, sizeof(_Value))));
+  }
+  NativeObject * obj = NativeObjectFactory::CreateObject(combinerClass);
+  NativeCombiner * combiner = dynamic_cast<NativeCombiner *>(obj);
+  ASSERT_NE((void *)NULL, combiner);
+  ASSERT_EQ(CombinerType, combiner->type());
+  VectorKVIterator iterator(input);
+  VectorCollector output;
+  combiner->combine(CombineContext(UNKNOWN), &iterator, &output);
+  delete combiner;
+  for (size_t i = 0; i < output.kvs.size(); i++) {
+    ASSERT_EQ(sizeof(_Value), output.kvs[i].second.length());
+    result.push_back(std::make_pair(output.kvs[i].first,
+        NumberValue<_Value>::read(output.kvs[i].second.data())));
+  }
+}
+
+TEST(NativeCombiners, number) {
+  const char * keys[] = {"a", "a", "b", "c", "c", "c"};
+
+  const int32_t ints[] = {1, 2, 3, INT32_MAX, 1, 5};
+  vector<pair<string, int32_t> > intResult;
+  Combine("NativeTask.IntSumCombiner", keys, ints, 6, intResult);
+  ASSERT_EQ(3, intResult.size());
+  ASSERT_EQ(string("a"), intResult[0].first);
+  ASSERT_EQ(3, intResult[0].second);
+  ASSERT_EQ(3, intResult[1].second);
+  // wraps around like java
+  ASSERT_EQ(INT32_MIN + 5, intResult[2].second);
+
+  const int64_t longs[] = {5, -7, 3, 2, 9, 4};
+  vector<pair<string, int64_t> > minResult;
+  Combine("NativeTask.LongMinCombiner", keys, longs, 6, minResult);
+  ASSERT_EQ(3, minResult.size());
+  ASSERT_EQ(-7, minResult[0].second);
+  ASSERT_EQ(3, minResult[1].second);
+  ASSERT_EQ(2, minResult[2].second);
+
+  const double doubles[] = {0.5, 1.5, -2, 3.25, -1, 3.5};
+  vector<pair<string, double> > maxResult;
+  Combine("NativeTask.DoubleMaxCombiner", keys, doubles, 6, maxResult);
+  ASSERT_EQ(3, maxResult.size());
+  ASSERT_EQ(1.5, maxResult[0].second);
+  ASSERT_EQ(-2, maxResult[1].second);
+  ASSERT_EQ(3.5, maxResult[2].second);
+
+  vector<pair<string, double> > sumResult;
+  Combine("NativeTask.DoubleSumCombiner", keys, doubles, 6, sumResult);
+  ASSERT_EQ(2.0, sumResult[0].second);
+  ASSERT_EQ(5.75, sumResult[2].second);
+}
+
+TEST(NativeCombiners, unknownClass) {
+  ASSERT_EQ(NULL, NativeObjectFactory::CreateObject("NativeTask.NoSuchCombiner"));
+}
+
+} // namespace NativeTask
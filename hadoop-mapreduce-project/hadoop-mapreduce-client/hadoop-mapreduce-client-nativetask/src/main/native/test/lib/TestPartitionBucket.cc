@@ -219,4 +219,49 @@ TEST(PartitionBucket, spill) {
   delete bucket;
   delete pool;
 }
+static void TestWholeSort(SortAlgorithm sortType, KeyValueType sortKeyType) {
+  MemoryPool * pool = new MemoryPool();
+  const uint32_t POOL_SIZE = 1024 * 1024; // 1MB
+  const uint32_t BLOCK_SIZE = 1024; // 1KB
+  const uint32_t COUNT = 10000;
+  pool->init(POOL_SIZE);
+  ComparatorPtr comparator = NativeTask::get_comparator(BytesType, NULL);
+  PartitionBucket * bucket = new PartitionBucket(pool, 0, comparator, NULL, BLOCK_SIZE,
+      sortKeyType, true);
+
+  Random random(sortType);
+  vector<string> keys;
+  for (uint32_t i = 0; i < COUNT; i++) {
+    string key = random.nextBytes(random.next_int32(20), string("ab ", 3));
+    KVBuffer * kv = bucket->allocateKVBuffer(KVBuffer::headerLength() + key.length() + 1);
+    kv->fill(key.data(), key.length(), "v", 1);
+    keys.push_back(key);
+  }
+  ASSERT_GT(bucket->getMemoryBlockCount(), 1);
+
+  bucket->sort(sortType);
+  std::sort(keys.begin(), keys.end());
+
+  KVIterator * iter = bucket->getIterator();
+  Buffer key;
+  Buffer value;
+  for (uint32_t i = 0; i < COUNT; i++) {
+    ASSERT_TRUE(iter->next(key, value));
+    ASSERT_EQ(keys[i], string(key.data(), key.length()));
+  }
+  ASSERT_FALSE(iter->next(key, value));
+
+  delete iter;
+  delete bucket;
+  delete pool;
+}
+
+TEST(PartitionBucket, wholeSort) {
+  TestWholeSort(CPPSORT, UnknownType);
+  TestWholeSort(DUALPIVOTSORT, UnknownType);
+  TestWholeSort(CPPSORT, BytesType);
+  TestWholeSort(DUALPIVOTSORT, BytesType);
+  TestWholeSort(RADIXSORT, BytesType);
+}
+
 } // namespace NativeTask
@@ -24,6 +24,46 @@ void TestChecksum(ChecksumType type, void * buff, uint32_t len) {
   Checksum::update(type, chm, buff, len);
 }
 
+TEST(Checksum, knownValues) {
+  const char * check = "123456789";
+  uint32_t crc32 = Checksum::init(CHECKSUM_CRC32);
+  Checksum::update(CHECKSUM_CRC32, crc32, check, 9);
+  ASSERT_EQ(0xCBF43926U, Checksum::getValue(CHECKSUM_CRC32, crc32));
+  uint32_t crc32c = Checksum::init(CHECKSUM_CRC32C);
+  Checksum::update(CHECKSUM_CRC32C, crc32c, check, 9);
+  ASSERT_EQ(0xE3069283U, Checksum::getValue(CHECKSUM_CRC32C, crc32c));
+}
+
+TEST(Checksum, matchSoftware) {
+  // cover the pipelined CRC32C block sizes and the CRC32 folding tails,
+  // at every alignment and with a running crc carried between updates
+  const size_t maxLength = 3 * 8192 * 2 + 3 * 256 + 100;
+  uint8_t * buff = new uint8_t[maxLength + 8];
+  Random r(31);
+  for (size_t i = 0; i < maxLength + 8; i++) {
+    buff[i] = (uint8_t)r.next_int32();
+  }
+  size_t lengths[] = {0, 1, 7, 15, 16, 63, 64, 65, 79, 80, 127, 1000, 767, 768, 769,
+      3 * 8192 - 1, 3 * 8192, 3 * 8192 + 3 * 256 + 17, maxLength};
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(size_t); i++) {
+    for (size_t offset = 0; offset < 8; offset++) {
+      const uint8_t * data = buff + offset;
+      size_t length = lengths[i];
+      ASSERT_EQ(crc32_sb8_software(0xffffffff, data, length),
+          crc32_sb8(0xffffffff, data, length));
+      ASSERT_EQ(crc32c_sb8_software(0xffffffff, data, length),
+          crc32c_sb8(0xffffffff, data, length));
+      uint32_t split = crc32_sb8(crc32_sb8(0x12345678, data, length / 3), data + length / 3,
+          length - length / 3);
+      ASSERT_EQ(crc32_sb8_software(0x12345678, data, length), split);
+      split = crc32c_sb8(crc32c_sb8(0x12345678, data, length / 3), data + length / 3,
+          length - length / 3);
+      ASSERT_EQ(crc32c_sb8_software(0x12345678, data, length), split);
+    }
+  }
+  delete[] buff;
+}
+
 TEST(Perf, CRC) {
   uint32_t len = TestConfig.getInt("checksum.perf.size", 1024 * 1024 * 50);
   int testTime = TestConfig.getInt("checksum.perf.time", 2);
@@ -0,0 +1,65 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package org.apache.hadoop.mapred.nativetask;
+
+import org.apache.hadoop.io.Text;
+import org.apache.hadoop.io.WritableComparator;
+import org.apache.hadoop.mapred.InvalidJobConfException;
+import org.apache.hadoop.mapred.JobConf;
+import org.apache.hadoop.mapred.MapOutputCollector;
+import org.apache.hadoop.mapreduce.MRJobConfig;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+public class TestNativeMapOutputCollectorDelegator {
+
+  /**
+   * sort comparator that can not be loaded natively
+   */
+  public static class ReverseTextComparator extends WritableComparator {
+    public ReverseTextComparator() {
+      super(Text.class);
+    }
+
+    @Override
+    public int compare(byte[] b1, int s1, int l1, byte[] b2, int s2, int l2) {
+      return -super.compare(b1, s1, l1, b2, s2, l2);
+    }
+  }
+
+  @Test
+  public void testCustomizedComparatorRejected() throws Exception {
+    final JobConf job = new JobConf();
+    job.setNumReduceTasks(1);
+    job.setMapOutputKeyClass(Text.class);
+    job.setMapOutputValueClass(Text.class);
+    job.setClass(MRJobConfig.KEY_COMPARATOR, ReverseTextComparator.class,
+        WritableComparator.class);
+
+    final NativeMapOutputCollectorDelegator<Text, Text> delegator =
+        new NativeMapOutputCollectorDelegator<Text, Text>();
+    try {
+      delegator.init(new MapOutputCollector.Context(null, job, null));
+      Assert.fail("customized comparator should be rejected");
+    } catch (InvalidJobConfException e) {
+      Assert.assertTrue(e.getMessage(),
+          e.getMessage().contains(ReverseTextComparator.class.getName()));
+    }
+  }
+}
@@ -0,0 +1,140 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package org.apache.hadoop.mapred.nativetask.buffer;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Random;
+
+import org.apache.hadoop.io.BytesWritable;
+import org.apache.hadoop.mapred.nativetask.INativeHandler;
+import org.apache.hadoop.mapred.nativetask.serde.KVSerializer;
+import org.apache.hadoop.mapred.nativetask.util.SizedWritable;
+import org.junit.Assert;
+import org.junit.Before;
+import org.junit.Test;
+import org.mockito.Mockito;
+import org.mockito.invocation.InvocationOnMock;
+import org.mockito.stubbing.Answer;
+
+import static org.mockito.ArgumentMatchers.anyInt;
+
+@SuppressWarnings({ "rawtypes", "unchecked" })
+public class TestSharedBufferDataWriter {
+
+  private static final int BUFFER_SIZE = 64;
+
+  private INativeHandler handler;
+  // buffers handed back by the writer, trimmed to the committed length
+  private final List<byte[]> committed = new ArrayList<byte[]>();
+  private ByteBuffer current;
+
+  @Before
+  public void setUp() throws IOException {
+    handler = Mockito.mock(INativeHandler.class);
+    Mockito.when(handler.swapSharedBuffer(anyInt(), anyInt())).thenAnswer(
+        new Answer<ByteBuffer>() {
+          @Override
+          public ByteBuffer answer(InvocationOnMock invocation) {
+            final int length = invocation.getArgument(0);
+            final int minLength = invocation.getArgument(1);
+            if (null != current) {
+              final byte[] data = new byte[length];
+              final ByteBuffer filled = current.duplicate();
+              filled.position(0);
+              filled.get(data);
+              committed.add(data);
+            }
+            current = minLength == 0 ? null
+                : ByteBuffer.allocateDirect(Math.max(BUFFER_SIZE, minLength));
+            return current;
+          }
+        });
+  }
+
+  @Test
+  public void testRecordsInWholeBuffers() throws IOException {
+    final SharedBufferDataWriter writer = SharedBufferDataWriter.create(handler);
+    Assert.assertNotNull(writer);
+
+    final KVSerializer serializer = new KVSerializer(BytesWritable.class, BytesWritable.class);
+    serializer.setNativeEndianHeader(true);
+    final SizedWritable key = new SizedWritable(BytesWritable.class);
+    final SizedWritable value = new SizedWritable(BytesWritable.class);
+
+    final Random random = new Random(0);
+    final List<byte[]> keys = new ArrayList<byte[]>();
+    final List<byte[]> values = new ArrayList<byte[]>();
+    for (int i = 0; i < 100; i++) {
+      // some records are larger than a default buffer
+      final byte[] k = new byte[random.nextInt(i % 10 == 0 ? 100 : 20)];
+      final byte[] v = new byte[random.nextInt(30)];
+      random.nextBytes(k);
+      random.nextBytes(v);
+      keys.add(k);
+      values.add(v);
+      key.reset(new BytesWritable(k));
+      value.reset(new BytesWritable(v));
+      serializer.serializePartitionKV(writer, i % 7, key, value);
+    }
+    writer.close();
+    Mockito.verify(handler, Mockito.times(1)).finishSendData();
+    Assert.assertNull(current);
+
+    int record = 0;
+    for (byte[] data : committed) {
+      // each buffer holds whole records, headers in native order
+      final ByteBuffer in = ByteBuffer.wrap(data).order(ByteOrder.nativeOrder());
+      while (in.hasRemaining()) {
+        Assert.assertEquals(record % 7, in.getInt());
+        final byte[] k = new byte[in.getInt()];
+        final byte[] v = new byte[in.getInt()];
+        in.get(k);
+        in.get(v);
+        Assert.assertTrue(Arrays.equals(keys.get(record), k));
+        Assert.assertTrue(Arrays.equals(values.get(record), v));
+        record++;
+      }
+    }
+    Assert.assertEquals(100, record);
+  }
+
+  @Test
+  public void testNoSharedBuffer() throws IOException {
+    final INativeHandler copying = Mockito.mock(INativeHandler.class);
+    Assert.assertNull(SharedBufferDataWriter.create(copying));
+  }
+
+  @Test
+  public void testWriteBeyondReserved() throws IOException {
+    final SharedBufferDataWriter writer = SharedBufferDataWriter.create(handler);
+    writer.reserve(BUFFER_SIZE);
+    writer.write(new byte[BUFFER_SIZE - 4], 0, BUFFER_SIZE - 4);
+    boolean thrown = false;
+    try {
+      writer.writeLong(1);
+    } catch (final IOException e) {
+      thrown = true;
+    }
+    Assert.assertTrue("exception thrown", thrown);
+  }
+}
@@ -19,10 +19,13 @@
 
 import static org.assertj.core.api.Assertions.assertThat;
 
+import com.google.common.base.Charsets;
+
 import org.apache.hadoop.conf.Configuration;
 import org.apache.hadoop.fs.FileSystem;
 import org.apache.hadoop.fs.Path;
 import org.apache.hadoop.io.Text;
+import org.apache.hadoop.io.compress.ZStandardCodec;
 import org.apache.hadoop.mapred.nativetask.NativeRuntime;
 import org.apache.hadoop.mapred.nativetask.kvtest.TestInputFile;
 import org.apache.hadoop.mapred.nativetask.testutil.ResultVerifier;
@@ -125,6 +128,36 @@ public void testLz4Compress() throws Exception {
     ResultVerifier.verifyCounters(hadoopJob, nativeJob);
   }
 
+  @Test
+  public void testZstdCompress() throws Exception {
+    Assume.assumeTrue(ZStandardCodec.isNativeCodeLoaded());
+    final String zstdCodec = "org.apache.hadoop.io.compress.ZStandardCodec";
+    // the codec check NativeMapOutputCollectorDelegator runs before it
+    // takes over a job
+    assertThat(NativeRuntime.supportsCompressionCodec(
+        zstdCodec.getBytes(Charsets.UTF_8))).isTrue();
+
+    nativeConf.set(MRJobConfig.MAP_OUTPUT_COMPRESS_CODEC, zstdCodec);
+    final String nativeOutputPath =
+      TestConstants.NATIVETASK_COMPRESS_TEST_NATIVE_OUTPUTDIR + "/zstd";
+    final Job nativeJob = CompressMapper.getCompressJob("nativezstd", nativeConf,
+      TestConstants.NATIVETASK_COMPRESS_TEST_INPUTDIR, nativeOutputPath);
+    assertThat(nativeJob.waitForCompletion(true)).isTrue();
+
+    hadoopConf.set(MRJobConfig.MAP_OUTPUT_COMPRESS_CODEC, zstdCodec);
+    final String hadoopOutputPath =
+      TestConstants.NATIVETASK_COMPRESS_TEST_NORMAL_OUTPUTDIR + "/zstd";
+    final Job hadoopJob = CompressMapper.getCompressJob("hadoopzstd", hadoopConf,
+      TestConstants.NATIVETASK_COMPRESS_TEST_INPUTDIR, hadoopOutputPath);
+    assertThat(hadoopJob.waitForCompletion(true)).isTrue();
+    final boolean compareRet = ResultVerifier.verify(nativeOutputPath, hadoopOutputPath);
+    assertThat(compareRet)
+        .withFailMessage(
+            "file compare result: if they are the same ,then return true")
+        .isTrue();
+    ResultVerifier.verifyCounters(hadoopJob, nativeJob);
+  }
+
   @Before
   public void startUp() throws Exception {
     Assume.assumeTrue(NativeCodeLoader.isNativeCodeLoaded());
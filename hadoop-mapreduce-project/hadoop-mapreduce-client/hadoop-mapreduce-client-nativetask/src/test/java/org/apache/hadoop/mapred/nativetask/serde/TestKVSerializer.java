@@ -19,6 +19,7 @@
 
 import java.io.ByteArrayOutputStream;
 import java.io.IOException;
+import java.nio.ByteOrder;
 
 import org.junit.Before;
 import org.junit.Test;
@@ -80,6 +81,7 @@ public void testUpdateLength() throws IOException {
   @Test
   public void testSerializeKV() throws IOException {
     final DataOutputStream dataOut = Mockito.mock(DataOutputStream.class);
+    Mockito.doCallRealMethod().when(dataOut).reserve(anyInt());
 
     Mockito.when(dataOut.hasUnFlushedData()).thenReturn(true);
     Mockito.when(dataOut.shortOfSpace(key.length + value.length +
@@ -98,6 +100,7 @@ public void testSerializeKV() throws IOException {
   @Test
   public void testSerializeNoFlush() throws IOException {
     final DataOutputStream dataOut = Mockito.mock(DataOutputStream.class);
+    Mockito.doCallRealMethod().when(dataOut).reserve(anyInt());
 
     // suppose there are enough space
     Mockito.when(dataOut.hasUnFlushedData()).thenReturn(true);
@@ -116,6 +119,7 @@ public void testSerializeNoFlush() throws IOException {
   @Test
   public void testSerializePartitionKV() throws IOException {
     final DataOutputStream dataOut = Mockito.mock(DataOutputStream.class);
+    Mockito.doCallRealMethod().when(dataOut).reserve(anyInt());
 
     Mockito.when(dataOut.hasUnFlushedData()).thenReturn(true);
     Mockito.when(
@@ -135,6 +139,23 @@ public void testSerializePartitionKV() throws IOException {
         + Constants.SIZEOF_PARTITION_LENGTH);
   }
 
+  @Test
+  public void testSerializeNativeEndianHeader() throws IOException {
+    final DataOutputStream dataOut = Mockito.mock(DataOutputStream.class);
+    final boolean swap = ByteOrder.nativeOrder() == ByteOrder.LITTLE_ENDIAN;
+
+    Mockito.when(dataOut.hasUnFlushedData()).thenReturn(false);
+    serializer.setNativeEndianHeader(true);
+    serializer.serializePartitionKV(dataOut, 100, key, value);
+
+    Mockito.verify(dataOut, Mockito.atLeastOnce()).writeInt(
+        swap ? Integer.reverseBytes(100) : 100);
+    Mockito.verify(dataOut, Mockito.atLeastOnce()).writeInt(
+        swap ? Integer.reverseBytes(key.length) : key.length);
+    Mockito.verify(dataOut, Mockito.atLeastOnce()).writeInt(
+        swap ? Integer.reverseBytes(value.length) : value.length);
+  }
+
   @Test
   public void testDeserializerNoData() throws IOException {
     final DataInputStream in = Mockito.mock(DataInputStream.class);